@@ -0,0 +1,280 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_BENCHMARK_H_
+#define MAPVIZ_BENCHMARK_H_
+
+// C++ standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mapviz
+{
+  /**
+   * Prevents the compiler from optimizing away a value that a benchmark
+   * computes but never uses.
+   */
+  template <class T>
+  inline void DoNotOptimize(const T& value)
+  {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+  /**
+   * A small harness for microbenchmarks of the inner loops of mapviz and its
+   * plugins, modeled on Google Benchmark so that the results read the same.
+   *
+   * Each case is run enough times in a row to fill --min_time seconds, and
+   * that is repeated --repetitions times.  The median and the best time per
+   * run are reported along with the number of items processed per second.
+   *
+   * Command line arguments:
+   *   --filter=<substring>  Only run cases whose name contains the substring
+   *   --min_time=<seconds>  Minimum duration of one repetition (default 0.1)
+   *   --repetitions=<n>     Number of repetitions (default 5)
+   *   --json=<file>         Also write the results to a JSON file
+   *
+   * Example:
+   *   mapviz::BenchmarkRunner runner(argc, argv);
+   *   runner.Run("TransformXYZ/1M", points.size(), [&]()
+   *   {
+   *     transformer.TransformXYZ(&points[0], points.size() / 3, &out[0]);
+   *   });
+   *   return runner.Finish();
+   */
+  class BenchmarkRunner
+  {
+  public:
+    struct Result
+    {
+      std::string name;
+      size_t iterations;
+      double median_ns;
+      double best_ns;
+      double items_per_second;
+    };
+
+    BenchmarkRunner(int argc, char** argv) :
+      min_time_(0.1),
+      repetitions_(5),
+      printed_header_(false)
+    {
+      for (int i = 1; i < argc; i++)
+      {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 9, "--filter=") == 0)
+        {
+          filter_ = arg.substr(9);
+        }
+        else if (arg.compare(0, 11, "--min_time=") == 0)
+        {
+          min_time_ = std::atof(arg.substr(11).c_str());
+        }
+        else if (arg.compare(0, 14, "--repetitions=") == 0)
+        {
+          repetitions_ = std::max(1, std::atoi(arg.substr(14).c_str()));
+        }
+        else if (arg.compare(0, 7, "--json=") == 0)
+        {
+          json_file_ = arg.substr(7);
+        }
+      }
+    }
+
+    /**
+     * Returns false if the case is excluded by --filter, so that callers can
+     * skip setting up data for it.
+     */
+    bool Enabled(const std::string& name) const
+    {
+      return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    /**
+     * Times run(), which processes items_per_run items each time it's called,
+     * and prints the result.
+     */
+    void Run(const std::string& name, size_t items_per_run, const std::function<void()>& run)
+    {
+      if (!Enabled(name))
+      {
+        return;
+      }
+
+      if (!printed_header_)
+      {
+        printf("%-48s %14s %14s %12s %14s\n", "Benchmark", "Time", "Best", "Iterations", "Items/s");
+        printf("%s\n", std::string(106, '-').c_str());
+        printed_header_ = true;
+      }
+
+      // Warm up the caches and estimate how many runs fill min_time.
+      size_t iterations = 1;
+      while (true)
+      {
+        double elapsed = Time(run, iterations);
+        if (elapsed >= min_time_ || iterations >= 1000000000)
+        {
+          break;
+        }
+        double scale = elapsed > 0.0 ? 1.4 * min_time_ / elapsed : 10.0;
+        iterations = static_cast<size_t>(iterations * std::min(10.0, std::max(scale, 2.0)));
+      }
+
+      std::vector<double> times;
+      for (int i = 0; i < repetitions_; i++)
+      {
+        times.push_back(Time(run, iterations) * 1e9 / iterations);
+      }
+      std::sort(times.begin(), times.end());
+
+      Result result;
+      result.name = name;
+      result.iterations = iterations;
+      result.median_ns = times[times.size() / 2];
+      result.best_ns = times.front();
+      result.items_per_second = items_per_run * 1e9 / result.median_ns;
+      results_.push_back(result);
+
+      printf("%-48s %14s %14s %12zu %14s\n",
+             name.c_str(),
+             FormatTime(result.median_ns).c_str(),
+             FormatTime(result.best_ns).c_str(),
+             iterations,
+             FormatRate(result.items_per_second).c_str());
+      fflush(stdout);
+    }
+
+    const std::vector<Result>& Results() const { return results_; }
+
+    /**
+     * Writes the JSON file if one was requested and returns the exit code of
+     * the benchmark program.
+     */
+    int Finish()
+    {
+      if (json_file_.empty())
+      {
+        return 0;
+      }
+
+      FILE* file = fopen(json_file_.c_str(), "w");
+      if (!file)
+      {
+        fprintf(stderr, "Failed to open %s\n", json_file_.c_str());
+        return 1;
+      }
+
+      fprintf(file, "{\n  \"min_time\": %g,\n  \"repetitions\": %d,\n  \"benchmarks\": [", min_time_, repetitions_);
+      for (size_t i = 0; i < results_.size(); i++)
+      {
+        const Result& result = results_[i];
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"median_ns\": %.1f, "
+                "\"best_ns\": %.1f, \"items_per_second\": %.1f}",
+                i == 0 ? "" : ",",
+                result.name.c_str(),
+                result.iterations,
+                result.median_ns,
+                result.best_ns,
+                result.items_per_second);
+      }
+      fprintf(file, "\n  ]\n}\n");
+      fclose(file);
+      return 0;
+    }
+
+  private:
+    static double Time(const std::function<void()>& run, size_t iterations)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < iterations; i++)
+      {
+        run();
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      return elapsed.count();
+    }
+
+    static std::string FormatTime(double ns)
+    {
+      char buffer[32];
+      if (ns >= 1e6)
+      {
+        snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1e6);
+      }
+      else if (ns >= 1e3)
+      {
+        snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1e3);
+      }
+      else
+      {
+        snprintf(buffer, sizeof(buffer), "%.1f ns", ns);
+      }
+      return buffer;
+    }
+
+    static std::string FormatRate(double rate)
+    {
+      char buffer[32];
+      if (rate >= 1e9)
+      {
+        snprintf(buffer, sizeof(buffer), "%.2fG/s", rate / 1e9);
+      }
+      else if (rate >= 1e6)
+      {
+        snprintf(buffer, sizeof(buffer), "%.2fM/s", rate / 1e6);
+      }
+      else if (rate >= 1e3)
+      {
+        snprintf(buffer, sizeof(buffer), "%.2fk/s", rate / 1e3);
+      }
+      else
+      {
+        snprintf(buffer, sizeof(buffer), "%.1f/s", rate);
+      }
+      return buffer;
+    }
+
+    std::string filter_;
+    double min_time_;
+    int repetitions_;
+    std::string json_file_;
+    bool printed_header_;
+    std::vector<Result> results_;
+  };
+}
+
+#endif  // MAPVIZ_BENCHMARK_H_
@@ -0,0 +1,165 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_BOUNDING_BOX_H_
+#define MAPVIZ_BOUNDING_BOX_H_
+
+// C++ standard libraries
+#include <algorithm>
+#include <limits>
+
+// ROS libraries
+#include <tf/transform_datatypes.h>
+
+namespace mapviz
+{
+  /**
+   * An axis-aligned box, used to check whether content is inside of the
+   * visible part of the map.  Only the x and y extents are used for
+   * intersection tests; the z extent is tracked so that boxes can be
+   * transformed into other frames without losing anything.
+   *
+   * A default constructed box is empty and doesn't intersect anything.
+   */
+  class BoundingBox
+  {
+  public:
+    BoundingBox() :
+      min_x_(std::numeric_limits<double>::max()),
+      min_y_(std::numeric_limits<double>::max()),
+      min_z_(std::numeric_limits<double>::max()),
+      max_x_(-std::numeric_limits<double>::max()),
+      max_y_(-std::numeric_limits<double>::max()),
+      max_z_(-std::numeric_limits<double>::max())
+    {
+    }
+
+    BoundingBox(double min_x, double min_y, double max_x, double max_y) :
+      min_x_(min_x),
+      min_y_(min_y),
+      min_z_(0.0),
+      max_x_(max_x),
+      max_y_(max_y),
+      max_z_(0.0)
+    {
+    }
+
+    /**
+     * Returns a box that contains everything.
+     */
+    static BoundingBox Infinite()
+    {
+      BoundingBox box;
+      std::swap(box.min_x_, box.max_x_);
+      std::swap(box.min_y_, box.max_y_);
+      std::swap(box.min_z_, box.max_z_);
+      return box;
+    }
+
+    bool Empty() const { return min_x_ > max_x_ || min_y_ > max_y_; }
+
+    double MinX() const { return min_x_; }
+    double MinY() const { return min_y_; }
+    double MinZ() const { return min_z_; }
+    double MaxX() const { return max_x_; }
+    double MaxY() const { return max_y_; }
+    double MaxZ() const { return max_z_; }
+
+    /**
+     * Grows the box to include the point.
+     */
+    void Add(double x, double y, double z = 0.0)
+    {
+      min_x_ = std::min(min_x_, x);
+      min_y_ = std::min(min_y_, y);
+      min_z_ = std::min(min_z_, z);
+      max_x_ = std::max(max_x_, x);
+      max_y_ = std::max(max_y_, y);
+      max_z_ = std::max(max_z_, z);
+    }
+
+    void Add(const tf::Point& point)
+    {
+      Add(point.x(), point.y(), point.z());
+    }
+
+    void Add(const BoundingBox& box)
+    {
+      if (!box.Empty())
+      {
+        Add(box.min_x_, box.min_y_, box.min_z_);
+        Add(box.max_x_, box.max_y_, box.max_z_);
+      }
+    }
+
+    /**
+     * Returns a copy of the box that is larger by margin on every side.
+     */
+    BoundingBox Expanded(double margin) const
+    {
+      BoundingBox box(*this);
+      if (!Empty())
+      {
+        box.min_x_ -= margin;
+        box.min_y_ -= margin;
+        box.max_x_ += margin;
+        box.max_y_ += margin;
+      }
+      return box;
+    }
+
+    bool Contains(double x, double y) const
+    {
+      return x >= min_x_ && x <= max_x_ && y >= min_y_ && y <= max_y_;
+    }
+
+    bool Contains(const tf::Point& point) const
+    {
+      return Contains(point.x(), point.y());
+    }
+
+    bool Intersects(const BoundingBox& box) const
+    {
+      return !Empty() && !box.Empty() &&
+          box.min_x_ <= max_x_ && box.max_x_ >= min_x_ &&
+          box.min_y_ <= max_y_ && box.max_y_ >= min_y_;
+    }
+
+  private:
+    double min_x_;
+    double min_y_;
+    double min_z_;
+    double max_x_;
+    double max_y_;
+    double max_z_;
+  };
+}
+
+#endif  // MAPVIZ_BOUNDING_BOX_H_
@@ -40,6 +40,8 @@
 #include <QMouseEvent>
 #include <QListWidgetItem>
 
+#include <mapviz/memory_stats.h>
+
 // Auto-generated UI files
 #include "ui_configitem.h"
 
@@ -56,6 +58,17 @@ namespace mapviz
     void SetName(QString name);
     void SetType(QString type);
     void SetWidget(QWidget* widget);
+
+    /**
+     * Only offers the option to process the latest messages for displays
+     * that support it.
+     */
+    void SetSupportsConflate(bool supported);
+
+    /**
+     * Shows the memory held by the display in the header.
+     */
+    void SetMemoryUsage(const MemoryStats& memory);
     
     void SetListItem(QListWidgetItem* item) { item_ = item; }
     bool Collapsed() const { return ui_.content->isHidden(); }
@@ -66,6 +79,7 @@ namespace mapviz
   Q_SIGNALS:
     void UpdateSizeHint();
     void ToggledDraw(QListWidgetItem* plugin, bool visible);
+    void ToggledConflate(QListWidgetItem* plugin, bool conflate);
     void RemoveRequest(QListWidgetItem* plugin);
 
   public Q_SLOTS:
@@ -73,6 +87,7 @@ namespace mapviz
     void EditName();
     void Remove();
     void ToggleDraw(bool toggled);
+    void ToggleConflate(bool toggled);
 
   private:
     virtual void contextMenuEvent(QContextMenuEvent *event) override;
@@ -83,6 +98,7 @@ namespace mapviz
     QString type_;
     QAction* edit_name_action_;
     QAction* remove_item_action_;
+    QAction* conflate_action_;
     bool visible_;
   };
 }
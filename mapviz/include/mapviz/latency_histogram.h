@@ -0,0 +1,175 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace mapviz
+{
+/* A histogram of durations that can be recorded from any thread without
+ * locking.
+ *
+ * Durations are counted in microseconds in log-linear buckets: every power
+ * of two is split into 16 buckets, so percentiles are accurate to within
+ * about 3% no matter how long the durations are.  Durations from 1us up to
+ * 2^32us (about 71 minutes) are tracked; longer ones are counted in the
+ * last bucket.
+ */
+class LatencyHistogram
+{
+ public:
+  static const int SUB_BUCKET_BITS = 4;
+  static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const int MAX_EXPONENT = 32;
+  static const int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  LatencyHistogram()
+  {
+    clear();
+  }
+
+  /* Adds a duration in microseconds. */
+  void record(uint64_t usec)
+  {
+    counts_[bucket(usec)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(usec, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (usec > max && !max_.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /* Resets the histogram.  Durations recorded by other threads while the
+   * histogram is being cleared may or may not be kept. */
+  void clear()
+  {
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+  uint64_t maxUsec() const { return max_.load(std::memory_order_relaxed); }
+
+  double avgUsec() const
+  {
+    uint64_t count = this->count();
+    return count ? static_cast<double>(total_.load(std::memory_order_relaxed)) / count : 0.0;
+  }
+
+  /* Returns the duration in microseconds that the given fraction (e.g. 0.99)
+   * of the recorded durations don't exceed, or 0 if nothing was recorded. */
+  double percentileUsec(double fraction) const
+  {
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+      total += counts_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+      return 0.0;
+    }
+
+    // Rank of the requested sample, counting from 1
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+      {
+        // Report the middle of the bucket, but never more than the longest
+        // duration that was actually recorded.
+        double value = bucketLower(i) + (bucketUpper(i) - bucketLower(i)) * 0.5;
+        return std::min(value, static_cast<double>(maxUsec()));
+      }
+    }
+    return static_cast<double>(maxUsec());
+  }
+
+ private:
+  static int bucket(uint64_t usec)
+  {
+    if (usec < SUB_BUCKETS)
+    {
+      return static_cast<int>(usec);
+    }
+
+    int exponent = 63 - __builtin_clzll(usec);
+    if (exponent >= MAX_EXPONENT)
+    {
+      return NUM_BUCKETS - 1;
+    }
+
+    int sub_bucket = static_cast<int>((usec >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+  }
+
+  static double bucketLower(int index)
+  {
+    if (index < SUB_BUCKETS)
+    {
+      return index;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int sub_bucket = index % SUB_BUCKETS;
+    return std::ldexp(static_cast<double>(SUB_BUCKETS + sub_bucket), exponent - SUB_BUCKET_BITS);
+  }
+
+  static double bucketUpper(int index)
+  {
+    if (index < SUB_BUCKETS)
+    {
+      return index + 1;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int sub_bucket = index % SUB_BUCKETS;
+    return std::ldexp(static_cast<double>(SUB_BUCKETS + sub_bucket + 1), exponent - SUB_BUCKET_BITS);
+  }
+
+  std::atomic<uint32_t> counts_[NUM_BUCKETS];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> max_;
+};  // class LatencyHistogram
+}  // namespace mapviz
@@ -31,18 +31,25 @@
 #define MAPVIZ_MAP_CANVAS_H_
 
 // C++ standard libraries
+#include <atomic>
 #include <cstring>
 #include <list>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
 // QT libraries
+#include <QGLFramebufferObject>
 #include <QGLWidget>
+#include <QImage>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QColor>
+#include <QStringList>
 #include <QTimer>
 
 // ROS libraries
@@ -51,6 +58,8 @@
 #include <tf/transform_listener.h>
 
 #include <mapviz/mapviz_plugin.h>
+#include <mapviz/render_cache.h>
+#include <mapviz/transform_cache.h>
 
 namespace mapviz
 {
@@ -63,6 +72,7 @@ namespace mapviz
     ~MapCanvas();
 
     void InitializeTf(boost::shared_ptr<tf::TransformListener> tf);
+    void SetTransformCache(TransformCachePtr transform_cache);
 
     void AddPlugin(MapvizPluginPtr plugin, int order);
     void RemovePlugin(MapvizPluginPtr plugin);
@@ -75,6 +85,60 @@ namespace mapviz
     void UpdateView();
     void ReorderDisplays();
     void ResetLocation();
+
+    /**
+     * Flags the canvas as needing to be repainted on the next frame.  The
+     * canvas is only repainted when something has changed, so anything that
+     * affects what is drawn without going through the plugins (or the view
+     * controls here) needs to call this.  This is safe to call from any thread.
+     */
+    void MarkDirty()
+    {
+      dirty_ = true;
+    }
+
+    /**
+     * Discards the cached output of all plugins that support render caching,
+     * e.g. because their configuration has changed.
+     */
+    void InvalidateRenderCaches();
+
+    /**
+     * Frame timings over one measurement window.
+     */
+    struct Measurements
+    {
+      StopwatchSummary frame;
+      StopwatchSummary transform;
+      // Totals since the canvas was created
+      uint64_t frames_drawn;
+      uint64_t frames_skipped;
+      // Video memory held by the render caches of all plugins
+      MemoryStats render_caches;
+    };
+
+    /**
+     * Ends the current measurement window and returns the timings in it.
+     */
+    Measurements CollectMeasurements();
+    void PrintMeasurements(const Measurements& measurements);
+
+    /**
+     * Shows or hides an overlay with frame times and the displays that take
+     * the most time to draw.
+     */
+    void ToggleShowHud(bool on);
+    bool ShowHud() const { return show_hud_; }
+
+    /**
+     * Updates the overlay with the measurements collected over the last
+     * elapsed seconds.
+     */
+    void UpdateHud(
+        double elapsed,
+        const Measurements& measurements,
+        const std::vector<std::pair<MapvizPluginPtr, MapvizPlugin::Measurements> >& plugins);
+
     QPointF MapGlCoordToFixedFrame(const QPointF& point);
     QPointF FixedFrameToMapGlCoord(const QPointF& point);
 
@@ -96,30 +160,33 @@ namespace mapviz
     {
       view_scale_ = scale;
       UpdateView();
+      MarkDirty();
     }
 
     void SetOffsetX(float x)
     {
       offset_x_ = x;
       UpdateView();
+      MarkDirty();
     }
 
     void SetOffsetY(float y)
     {
       offset_y_ = y;
       UpdateView();
+      MarkDirty();
     }
 
     void SetBackground(const QColor& color)
     {
       bg_color_ = color;
-      update();
+      MarkDirty();
     }
 
     void CaptureFrames(bool enabled)
     {
       capture_frames_ = enabled;
-      update();
+      MarkDirty();
     }
 
     /**
@@ -162,12 +229,24 @@ namespace mapviz
 
     void CaptureFrame(bool force = false);
 
+    /**
+     * Draws a frame into an offscreen buffer the size of the canvas and
+     * copies it into image.  This works while the canvas is hidden, as long
+     * as it has a native window to create an OpenGL context for, so it can be
+     * used on machines without a display, e.g. with a virtual X server and
+     * software rendering.  Returns false if the frame couldn't be drawn.
+     */
+    bool RenderOffscreen(QImage* image);
+
   Q_SIGNALS:
     void Hover(double x, double y, double scale);
 
   public Q_SLOTS:
     void setFrameRate(const double fps);
 
+  protected Q_SLOTS:
+    void RedrawIfDirty();
+
   protected:
     void initializeGL();
     void initGlBlending();
@@ -175,6 +254,7 @@ namespace mapviz
     void popGlMatrices();
     void resizeGL(int w, int h);
     void paintEvent(QPaintEvent* event);
+    void Paint(QPaintDevice* device);
     void wheelEvent(QWheelEvent* e);
     void mousePressEvent(QMouseEvent* e);
     void mouseReleaseEvent(QMouseEvent* e);
@@ -183,12 +263,17 @@ namespace mapviz
 
     void Recenter();
     void TransformTarget(QPainter* painter);
+    void UpdateVisibleBounds(bool transformed);
+    BoundingBox ViewBounds(double margin, bool transformed) const;
+    void DrawPlugin(const MapvizPluginPtr& plugin);
+    void DrawHud(QPainter* painter);
     void Zoom(float factor);
 
     void InitializePixelBuffers();
 
     bool canvas_able_to_move_ = true;
     bool has_pixel_buffers_;
+    bool has_render_cache_;
     int32_t pixel_buffer_size_;
     GLuint pixel_buffer_ids_[2];
     int32_t pixel_buffer_index_;
@@ -201,6 +286,20 @@ namespace mapviz
 
     QTimer frame_rate_timer_;
 
+    // Set whenever the scene changes; the frame rate timer only repaints the
+    // canvas while this is set or a plugin needs to be redrawn.
+    std::atomic<bool> dirty_;
+    boost::signals2::connection tf_changed_connection_;
+    uint64_t frames_drawn_;
+    uint64_t frames_skipped_;
+
+    Stopwatch meas_frame_;
+    Stopwatch meas_transform_;
+
+    bool show_hud_;
+    uint64_t hud_frames_drawn_;
+    QStringList hud_lines_;
+
     QColor bg_color_;
 
     Qt::MouseButton mouse_button_;
@@ -226,6 +325,11 @@ namespace mapviz
     float view_center_x_;
     float view_center_y_;
 
+    // The part of the target frame that is visible on the canvas, and the
+    // larger part that is rendered into the render caches
+    BoundingBox visible_bounds_;
+    BoundingBox cached_visible_bounds_;
+
     // View scale in meters per pixel
     float view_scale_;
 
@@ -245,11 +349,15 @@ namespace mapviz
     std::string target_frame_;
 
     boost::shared_ptr<tf::TransformListener> tf_;
+    TransformCachePtr transform_cache_;
     tf::StampedTransform transform_;
     QTransform qtransform_;
     std::list<MapvizPluginPtr> plugins_;
+    std::map<MapvizPlugin*, RenderCachePtr> render_caches_;
 
     std::vector<uint8_t> capture_buffer_;
+
+    boost::scoped_ptr<QGLFramebufferObject> offscreen_buffer_;
   };
 }
 
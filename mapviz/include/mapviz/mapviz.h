@@ -31,6 +31,7 @@
 #define MAPVIZ_MAPVIZ_H_
 
 // C++ standard libraries
+#include <fstream>
 #include <string>
 #include <vector>
 #include <map>
@@ -58,6 +59,8 @@
 #include <tf/transform_listener.h>
 #include <yaml-cpp/yaml.h>
 #include <std_srvs/Empty.h>
+#include <std_srvs/Trigger.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 // Auto-generated UI files
 #include "ui_mapviz.h"
@@ -67,6 +70,7 @@
 #include <mapviz/AddMapvizDisplay.h>
 #include <mapviz/mapviz_plugin.h>
 #include <mapviz/map_canvas.h>
+#include <mapviz/transform_cache.h>
 #include <mapviz/video_writer.h>
 
 #include "stopwatch.h"
@@ -83,6 +87,24 @@ namespace mapviz
 
     void Initialize();
 
+    /**
+     * Starts mapviz without showing its window.  The config is loaded as
+     * usual and frames are rendered offscreen at a fixed rate and written to
+     * PNG files or a video.  This is configured with private parameters:
+     *   headless_width, headless_height: Size of the frames (1280x720)
+     *   headless_rate: Frames per second to render (10)
+     *   headless_frames: Number of frames to render before exiting, or 0 to
+     *     keep rendering until ROS shuts down (0)
+     *   headless_output: Directory to write numbered PNG files to, or a file
+     *     ending in .avi to write a video to; nothing is written if empty
+     *   headless_timings: CSV file to write the time taken by every frame to
+     *
+     * Rendering still needs an X server to create an OpenGL context for, but
+     * a virtual one with software rendering, e.g. xvfb-run with llvmpipe, is
+     * enough.
+     */
+    void StartHeadless();
+
   public Q_SLOTS:
     void AutoSave();
     void OpenConfig();
@@ -105,7 +127,10 @@ namespace mapviz
     void ToggleFixOrientation(bool on);
     void ToggleRotate90(bool on);
     void ToggleEnableAntialiasing(bool on);
+    void ToggleShowHud(bool on);
+    void RenderHeadlessFrame();
     void ToggleShowPlugin(QListWidgetItem* item, bool visible);
+    void ToggleConflatePlugin(QListWidgetItem* item, bool conflate);
     void ToggleRecord(bool on);
     void SetImageTransport(QAction* transport_action);
     void UpdateImageTransportMenu();
@@ -120,7 +145,10 @@ namespace mapviz
     void Hover(double x, double y, double scale);
     void Recenter();
     void HandleProfileTimer();
+    void UpdateMemoryUsage();
     void ClearHistory();
+    void ToggleTracing(bool on);
+    void SaveTrace();
 
   Q_SIGNALS:
     /**
@@ -142,6 +170,8 @@ namespace mapviz
     QTimer save_timer_;
     QTimer record_timer_;
     QTimer profile_timer_;
+    QTimer memory_timer_;
+    QTimer headless_timer_;
 
     QLabel* xy_pos_label_;
     QLabel* lat_lon_pos_label_;
@@ -174,8 +204,10 @@ namespace mapviz
 
     ros::NodeHandle* node_;
     ros::ServiceServer add_display_srv_;
+    ros::ServiceServer save_trace_srv_;
     boost::shared_ptr<tf::TransformListener> tf_;
     swri_transform_util::TransformManagerPtr tf_manager_;
+    TransformCachePtr transform_cache_;
 
     pluginlib::ClassLoader<MapvizPlugin>* loader_;
     MapCanvas* canvas_;
@@ -183,6 +215,33 @@ namespace mapviz
 
     Stopwatch meas_spin_;
 
+    // Performance measurements are printed and/or published as telemetry
+    // every time the profile timer fires.
+    bool print_profile_data_;
+    ros::Publisher telemetry_pub_;
+    ros::WallTime last_profile_time_;
+    uint64_t last_frames_drawn_;
+
+    // Default file that traces are written to by the save_trace service
+    std::string trace_file_;
+
+    bool headless_;
+    int headless_frames_;
+    int headless_frame_count_;
+    std::string headless_output_;
+    bool headless_video_;
+    std::ofstream headless_timings_;
+    Stopwatch meas_headless_render_;
+    Stopwatch meas_headless_write_;
+
+    void StopHeadless();
+
+    void PublishTelemetry(
+        double elapsed,
+        const MapCanvas::Measurements& canvas,
+        const StopwatchSummary& spin,
+        const std::vector<std::pair<MapvizPluginPtr, MapvizPlugin::Measurements> >& plugins);
+
     void Open(const std::string& filename);
     void Save(const std::string& filename);
 
@@ -197,11 +256,16 @@ namespace mapviz
       AddMapvizDisplay::Request& req,
       AddMapvizDisplay::Response& resp);
 
+    bool SaveTraceService(
+      std_srvs::Trigger::Request& req,
+      std_srvs::Trigger::Response& resp);
+
     void ClearDisplays();
     void AdjustWindowSize();
 
     virtual void showEvent(QShowEvent* event);
     virtual void closeEvent(QCloseEvent* event);
+    virtual bool eventFilter(QObject* object, QEvent* event);
 
     static const QString ROS_WORKSPACE_VAR;
     static const QString MAPVIZ_CONFIG_FILE;
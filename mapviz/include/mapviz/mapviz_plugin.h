@@ -31,6 +31,7 @@
 #define MAPVIZ_MAPVIZ_PLUGIN_H_
 
 // C++ standard libraries
+#include <atomic>
 #include <string>
 
 #include <boost/make_shared.hpp>
@@ -40,6 +41,8 @@
 #include <QWidget>
 #include <QGLWidget>
 #include <QObject>
+#include <QThread>
+#include <QTimer>
 
 // ROS libraries
 #include <ros/ros.h>
@@ -48,6 +51,13 @@
 #include <swri_transform_util/transform_manager.h>
 #include <swri_yaml_util/yaml_util.h>
 
+#include <mapviz/bounding_box.h>
+#include <mapviz/memory_stats.h>
+#include <mapviz/message_delivery.h>
+#include <mapviz/plugin_callback_queue.h>
+#include <mapviz/point_transformer.h>
+#include <mapviz/trace.h>
+#include <mapviz/transform_cache.h>
 #include <mapviz/widgets.h>
 
 #include "stopwatch.h"
@@ -58,7 +68,10 @@ namespace mapviz
   {
     Q_OBJECT;
   public:
-    virtual ~MapvizPlugin() {}
+    virtual ~MapvizPlugin()
+    {
+      StopCallbacks();
+    }
 
     virtual bool Initialize(
         boost::shared_ptr<tf::TransformListener> tf_listener,
@@ -70,6 +83,15 @@ namespace mapviz
       return Initialize(canvas);
     }
 
+    /**
+     * Sets a cache that transform lookups made through GetTransform() are
+     * shared through while a frame is being drawn.
+     */
+    void SetTransformCache(TransformCachePtr transform_cache)
+    {
+      transform_cache_ = transform_cache;
+    }
+
     virtual void Shutdown() = 0;
 
     virtual void ClearHistory() {}
@@ -95,7 +117,11 @@ namespace mapviz
       }
     }
 
-    void SetName(const std::string& name) { name_ = name; }
+    void SetName(const std::string& name)
+    {
+      name_ = name;
+      callback_queue_.setTraceName(name);
+    }
 
     std::string Name() const { return name_; }
 
@@ -114,36 +140,151 @@ namespace mapviz
       }
     }
 
+    /**
+     * Sets the node handle used by the plugin.  Every plugin gets its own
+     * callback queue; plugins that support asynchronous callbacks also get a
+     * dedicated spinner thread to service it.  Plugins that override this
+     * must call the base implementation.  Subscriptions made with
+     * Subscribe() receive their messages on a separate thread; see
+     * Subscribe().
+     */
     virtual void SetNode(const ros::NodeHandle& node)
     {
       node_ = node;
+      node_.setCallbackQueue(&callback_queue_);
+
+      if (SupportsAsyncCallbacks() && !spinner_)
+      {
+        spinner_ = boost::make_shared<ros::AsyncSpinner>(1, &callback_queue_);
+        spinner_->start();
+      }
     }
 
-    void DrawPlugin(double x, double y, double scale)
+    /**
+     * Services the plugin's callback queue on the calling thread.  This does
+     * nothing for plugins that process their callbacks asynchronously.
+     */
+    void ProcessCallbacks()
+    {
+      if (!spinner_ && !callback_queue_.empty())
+      {
+        callback_queue_.callAvailable();
+
+        // Assume that anything the plugin received changes what it draws.
+        RequestRedraw();
+      }
+    }
+
+    /**
+     * Queues a message for the plugin as if it had been received on topic,
+     * without a ROS master; see MessageDelivery.  Returns false if the
+     * plugin didn't subscribe to topic with Subscribe() or expects another
+     * message type.
+     */
+    template <class M>
+    bool DeliverMessage(const std::string& topic, const boost::shared_ptr<M const>& message)
+    {
+      return message_delivery_.deliver(topic, message);
+    }
+
+    /**
+     * Marks the plugin as needing to be redrawn.  This is safe to call from
+     * any thread.
+     */
+    void RequestRedraw()
+    {
+      redraw_requested_ = true;
+    }
+
+    /**
+     * Returns true if the plugin's output has changed since it was last drawn.
+     * The canvas skips repainting while no plugin needs to be redrawn and the
+     * view hasn't changed, so plugins whose output changes without processing
+     * a callback on the GUI thread or calling RequestRedraw() (for example,
+     * because data is loaded in the background) should override this.
+     */
+    virtual bool NeedsRedraw()
+    {
+      return redraw_requested_;
+    }
+
+    /**
+     * Stops processing callbacks for this plugin.  This must be called before
+     * the plugin is shut down so that no callbacks are running while the
+     * derived class is destroyed.
+     */
+    void StopCallbacks()
+    {
+      if (receive_spinner_)
+      {
+        receive_spinner_->stop();
+        receive_spinner_.reset();
+      }
+      receive_queue_.disable();
+      receive_queue_.clear();
+
+      if (spinner_)
+      {
+        spinner_->stop();
+        spinner_.reset();
+      }
+      callback_queue_.disable();
+      callback_queue_.clear();
+    }
+
+    /**
+     * Runs the plugin's Transform() step for the current frame.  The canvas
+     * calls this for all plugins concurrently on a thread pool before drawing
+     * any of them, so Transform() must not make any OpenGL calls or modify
+     * widgets other than through the Print*Helper() functions.
+     */
+    void TransformPlugin()
     {
       if (visible_ && initialized_)
       {
+        TraceScope trace("plugin", name_, " Transform");
         meas_transform_.start();
         Transform();
         meas_transform_.stop();
+      }
+    }
 
+    void DrawPlugin(double x, double y, double scale)
+    {
+      redraw_requested_ = false;
+
+      if (visible_ && initialized_)
+      {
+        TraceScope trace("plugin", name_, " Draw");
+        drawn_stamp_ = ros::Time();
         meas_draw_.start();
         Draw(x, y, scale);
         meas_draw_.stop();
       }
     }
+
+    /**
+     * Records how old the data the plugin drew is when a frame is shown.  The
+     * canvas calls this once it has finished rendering each frame.  Plugins
+     * that are drawn from a render cache keep the stamp of the data they drew
+     * last, so their latency keeps growing until they are redrawn.
+     */
+    void RecordDisplayed(const ros::Time& now)
+    {
+      if (visible_ && initialized_ && drawn_stamp_ != ros::Time())
+      {
+        meas_display_latency_.record(ros::WallDuration((now - drawn_stamp_).toSec()));
+      }
+    }
     
     void PaintPlugin(QPainter* painter, double x, double y, double scale)
     {
       if (visible_ && initialized_)
       {
-        meas_transform_.start();
-        Transform();
-        meas_transform_.stop();
-         
+        TraceScope trace("plugin", name_, " Paint");
         meas_paint_.start();
         Paint(painter, x, y, scale);
-        meas_paint_.start();
+        meas_paint_.stop();
       }
     }
 
@@ -161,8 +302,92 @@ namespace mapviz
       }
     }
 
+    bool Conflate() const { return conflate_; }
+
+    /**
+     * When conflation is enabled, plugins that support it (see
+     * SupportsConflate()) only keep the newest unprocessed message on each
+     * topic.
+     */
+    void SetConflate(bool conflate)
+    {
+      if (conflate_ != conflate)
+      {
+        conflate_ = conflate;
+        Q_EMIT ConflateChanged(conflate_);
+      }
+    }
+
+    /**
+     * Returns the number of messages that were dropped from the queues of
+     * the plugin's Subscribe() subscriptions before they could be processed.
+     */
+    uint64_t DroppedMessages() const
+    {
+      return message_delivery_.droppedCount();
+    }
+
+    /**
+     * Returns the number of messages the plugin has received through
+     * Subscribe() subscriptions, including the ones that were dropped.
+     */
+    uint64_t ReceivedMessages() const
+    {
+      return message_delivery_.receivedCount();
+    }
+
+    /**
+     * Returns the number of elements (e.g. points, scans or markers) the
+     * plugin is currently holding on to.  This is only used to monitor
+     * performance, so plugins that don't buffer data don't need to override
+     * it.
+     */
+    virtual size_t BufferedElements()
+    {
+      return 0;
+    }
+
+    /**
+     * Returns the memory held by the plugin: buffered messages, vertex
+     * arrays and caches in system memory, and textures and vertex buffers in
+     * video memory.  Like BufferedElements(), this is only used to monitor
+     * performance, so an estimate of the largest allocations is enough.
+     */
+    virtual MemoryStats MemoryUsage()
+    {
+      return MemoryStats();
+    }
+
     bool Visible() const { return visible_; }
 
+    /**
+     * Sets the part of the map that is visible on the canvas, in the target
+     * frame.  The canvas calls this before transforming and drawing each
+     * frame.
+     */
+    void SetVisibleBounds(const BoundingBox& bounds) { visible_bounds_ = bounds; }
+
+    /**
+     * Returns the part of the map that is visible on the canvas, in the
+     * target frame.  This is a box that contains the whole viewport, so it
+     * may include some content just outside of a rotated view.
+     */
+    const BoundingBox& VisibleBounds() const { return visible_bounds_; }
+
+    /**
+     * Returns true if any part of a box in the target frame is visible.
+     * Plugins can use this to skip content that is outside of the view.
+     */
+    bool IsVisible(const BoundingBox& bounds) const
+    {
+      return visible_bounds_.Intersects(bounds);
+    }
+
+    bool IsVisible(const tf::Point& point) const
+    {
+      return visible_bounds_.Contains(point);
+    }
+
     void SetVisible(bool visible)
     {
       if (visible_ != visible)
@@ -191,7 +416,7 @@ namespace mapviz
         return false;
       }
 
-      if (tf_manager_->GetTransform(target_frame_, source_frame_, time, transform))
+      if (LookupTransform(target_frame_, source_frame_, time, transform))
       {
         return true;
       }
@@ -199,7 +424,7 @@ namespace mapviz
       {
         // If the stamped transform failed because it is too recent, find the
         // most recent transform in the cache instead.
-        if (tf_manager_->GetTransform(target_frame_, source_frame_,  ros::Time(), transform))
+        if (LookupTransform(target_frame_, source_frame_,  ros::Time(), transform))
         {
           return true;
         }
@@ -227,7 +452,7 @@ namespace mapviz
         return false;
       }
 
-      if (tf_manager_->GetTransform(target_frame_, source, time, transform))
+      if (LookupTransform(target_frame_, source, time, transform))
       {
         return true;
       }
@@ -235,7 +460,7 @@ namespace mapviz
       {
         // If the stamped transform failed because it is too recent, find the
         // most recent transform in the cache instead.
-        if (tf_manager_->GetTransform(target_frame_, source,  ros::Time(), transform))
+        if (LookupTransform(target_frame_, source,  ros::Time(), transform))
         {
           return true;
         }
@@ -244,6 +469,39 @@ namespace mapviz
       return false;
     }
 
+    /**
+     * Multiplies the OpenGL modelview matrix by a rigid transform so that
+     * vertices can be drawn in the transform's source frame.  This lets a
+     * plugin keep its vertex data in the frame it arrived in and supply one
+     * transform per batch of vertices, so that moving the target frame only
+     * costs a transform lookup per batch instead of transforming and
+     * re-uploading every vertex.
+     *
+     * Returns false without changing the matrix if the transform isn't rigid
+     * (e.g. a transform to WGS84), in which case the vertices still have to
+     * be transformed on the CPU.  Every call that returns true must be
+     * matched by a call to PopGLTransform().
+     */
+    static bool PushGLTransform(const PointTransformer& transformer)
+    {
+      double matrix[16];
+      if (!transformer.GetGLMatrix(matrix))
+      {
+        return false;
+      }
+
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix();
+      glMultMatrixd(matrix);
+      return true;
+    }
+
+    static void PopGLTransform()
+    {
+      glMatrixMode(GL_MODELVIEW);
+      glPopMatrix();
+    }
+
     virtual void Transform() = 0;
 
     virtual void LoadConfig(const YAML::Node& load, const std::string& path) = 0;
@@ -251,18 +509,95 @@ namespace mapviz
 
     virtual QWidget* GetConfigWidget(QWidget* parent) { return NULL; }
 
+    /**
+     * Override this to return "true" if the plugin's ROS callbacks may run on
+     * a background thread.  Callbacks for such plugins must not touch Qt
+     * widgets, OpenGL or tf; they should decode their messages and hand the
+     * results to the GUI thread (e.g. through a queued slot) for Transform()
+     * and Draw() to pick up.
+     */
+    virtual bool SupportsAsyncCallbacks()
+    {
+      return false;
+    }
+
+    /**
+     * Override this to return "true" if the plugin sizes its subscriber
+     * queues with SubscriberQueueSize() and resubscribes when
+     * ConflateChanged() is emitted.  Only such plugins offer the option to
+     * only process their latest messages.
+     */
+    virtual bool SupportsConflate()
+    {
+      return false;
+    }
+
+    /**
+     * Override this to return "true" if the output of Draw() rarely changes,
+     * e.g. for map imagery.  The canvas then keeps the output in an offscreen
+     * texture and composites that instead of calling Draw() until the view
+     * changes or NeedsRedraw() returns true, so such plugins must request a
+     * redraw whenever anything they draw changes, including their transform.
+     */
+    virtual bool SupportsRenderCache()
+    {
+      return false;
+    }
+
     virtual void PrintError(const std::string& message) = 0;
     virtual void PrintInfo(const std::string& message) = 0;
     virtual void PrintWarning(const std::string& message) = 0;
 
     void SetIcon(IconWidget* icon) { icon_ = icon; }
 
-    void PrintMeasurements()
+    /**
+     * Timings of the plugin's processing steps and the latency of its data
+     * over one measurement window, and the memory it held at the end of the
+     * window.
+     */
+    struct Measurements
+    {
+      StopwatchSummary callbacks;
+      StopwatchSummary transform;
+      StopwatchSummary draw;
+      StopwatchSummary paint;
+      // Age of the messages when they were received and when the data in
+      // them was on screen, relative to their header stamps.
+      StopwatchSummary receive_latency;
+      StopwatchSummary display_latency;
+      MemoryStats memory;
+    };
+
+    /**
+     * Ends the current measurement window and returns the timings in it.
+     * Must be called from the GUI thread.
+     */
+    Measurements CollectMeasurements()
+    {
+      Measurements measurements;
+      measurements.callbacks = callback_queue_.callbackTimes().nextSummary();
+      measurements.transform = meas_transform_.nextSummary();
+      measurements.draw = meas_draw_.nextSummary();
+      measurements.paint = meas_paint_.nextSummary();
+      measurements.receive_latency = meas_receive_latency_.nextSummary();
+      measurements.display_latency = meas_display_latency_.nextSummary();
+      measurements.memory = MemoryUsage();
+      return measurements;
+    }
+
+    void PrintMeasurements(const Measurements& measurements)
     {
       std::string header = type_ + " (" + name_ + ")";
-      meas_transform_.printInfo(header + " Transform()");
-      meas_paint_.printInfo(header + " Paint()");
-      meas_draw_.printInfo(header + " Draw()");
+      Stopwatch::printSummary(header + " callbacks", measurements.callbacks);
+      Stopwatch::printSummary(header + " Transform()", measurements.transform);
+      Stopwatch::printSummary(header + " Paint()", measurements.paint);
+      Stopwatch::printSummary(header + " Draw()", measurements.draw);
+      Stopwatch::printSummary(header + " receive latency", measurements.receive_latency);
+      Stopwatch::printSummary(header + " display latency", measurements.display_latency);
+      ROS_INFO("%s memory -- CPU: %s, GPU: %s",
+               header.c_str(),
+               FormatBytes(measurements.memory.cpu_bytes).c_str(),
+               FormatBytes(measurements.memory.gpu_bytes).c_str());
     }
 
     static void PrintErrorHelper(QLabel *status_label, const std::string& message, double throttle = 0.0);
@@ -282,6 +617,7 @@ namespace mapviz
     }
 
   Q_SIGNALS:
+    void ConflateChanged(bool conflate);
     void DrawOrderChanged(int draw_order);
     void SizeChanged();
     void TargetFrameChanged(const std::string& target_frame);
@@ -300,6 +636,7 @@ namespace mapviz
 
     boost::shared_ptr<tf::TransformListener> tf_;
     swri_transform_util::TransformManagerPtr tf_manager_;
+    TransformCachePtr transform_cache_;
     
     std::string target_frame_;
     std::string source_frame_;
@@ -310,8 +647,123 @@ namespace mapviz
 
     int draw_order_;
 
+    bool conflate_;
+
+    BoundingBox visible_bounds_;
+
     virtual bool Initialize(QGLWidget* canvas) = 0;
 
+    /**
+     * Returns the queue size a subscriber should use; this is 1 if the plugin
+     * is conflating messages and queue_size otherwise.  Plugins that use this
+     * should resubscribe when ConflateChanged() is emitted.
+     */
+    uint32_t SubscriberQueueSize(uint32_t queue_size) const
+    {
+      return conflate_ ? 1 : queue_size;
+    }
+
+    /**
+     * Subscribes to topic like ros::NodeHandle::subscribe(), and also lets
+     * DeliverMessage() pass messages for topic to the callback.  Plugins
+     * should subscribe through this so that they can be benchmarked without
+     * a ROS master and so that their dropped messages are counted.
+     *
+     * roscpp discards the oldest message of a full subscription queue
+     * without telling anyone, so messages from ROS are received on a
+     * separate thread that only hands them to the plugin's MessageDelivery.
+     * That is where the queue_size limit is applied and where messages are
+     * dropped and counted, the same way as for DeliverMessage().
+     */
+    template <class M, class T>
+    ros::Subscriber Subscribe(
+        const std::string& topic,
+        uint32_t queue_size,
+        void (T::*callback)(const boost::shared_ptr<M const>&),
+        T* obj)
+    {
+      message_delivery_.addSubscriber(topic, queue_size, callback, obj);
+
+      if (!receive_spinner_)
+      {
+        receive_spinner_ = boost::make_shared<ros::AsyncSpinner>(1, &receive_queue_);
+        receive_spinner_->start();
+      }
+
+      MessageDelivery* message_delivery = &message_delivery_;
+      ros::SubscribeOptions options;
+      options.init<M>(
+          topic,
+          RECEIVE_QUEUE_SIZE,
+          [message_delivery, topic](const boost::shared_ptr<M const>& message)
+          {
+            message_delivery->deliver(topic, message);
+          });
+      options.callback_queue = &receive_queue_;
+      return node_.subscribe(options);
+    }
+
+    /**
+     * Looks up the transform from source to target at the given time, or the
+     * latest one for ros::Time().  Transform() runs concurrently for all
+     * plugins, so plugins must look up transforms through this or
+     * GetTransform() rather than using tf_manager_ directly; this goes
+     * through the canvas's transform cache, which serializes the lookups.
+     */
+    bool LookupTransform(
+        const std::string& target,
+        const std::string& source,
+        const ros::Time& time,
+        swri_transform_util::Transform& transform)
+    {
+      if (transform_cache_)
+      {
+        return transform_cache_->GetTransform(target, source, time, transform);
+      }
+
+      return tf_manager_->GetTransform(target, source, time, transform);
+    }
+
+    /**
+     * Records how long a message took to arrive, from its header stamp to
+     * now.  Plugins should call this with the stamp of every message they
+     * receive, before decoding it.  This is safe to call from any thread.
+     */
+    void RecordReceived(const ros::Time& stamp)
+    {
+      if (stamp != ros::Time())
+      {
+        meas_receive_latency_.record(ros::WallDuration((ros::Time::now() - stamp).toSec()));
+      }
+    }
+
+    /**
+     * Records the header stamp of data drawn in Draw().  Plugins should call
+     * this from Draw() for everything they draw; the newest stamp is used to
+     * measure how old the data on screen is.
+     */
+    void RecordDrawn(const ros::Time& stamp)
+    {
+      if (stamp > drawn_stamp_)
+      {
+        drawn_stamp_ = stamp;
+      }
+    }
+
+    /**
+     * Appends the number of dropped messages, if any, to a status message.
+     */
+    std::string AppendDroppedMessages(const std::string& message) const
+    {
+      uint64_t dropped = DroppedMessages();
+      if (dropped == 0)
+      {
+        return message;
+      }
+
+      return message + " (" + std::to_string(dropped) + " messages dropped)";
+    }
+
     MapvizPlugin() :
       initialized_(false),
       visible_(true),
@@ -321,14 +773,36 @@ namespace mapviz
       target_frame_(""),
       source_frame_(""),
       use_latest_transforms_(false),
-      draw_order_(0) {}
+      draw_order_(0),
+      conflate_(false),
+      visible_bounds_(BoundingBox::Infinite()),
+      message_delivery_(&callback_queue_),
+      redraw_requested_(true) {}
 
    private:
+    // The receive thread only moves message pointers, so roscpp should
+    // never have to drop any of them.
+    static const uint32_t RECEIVE_QUEUE_SIZE = 100;
+
+    PluginCallbackQueue callback_queue_;
+    boost::shared_ptr<ros::AsyncSpinner> spinner_;
+    MessageDelivery message_delivery_;
+    ros::CallbackQueue receive_queue_;
+    boost::shared_ptr<ros::AsyncSpinner> receive_spinner_;
+
+    std::atomic<bool> redraw_requested_;
+
     // Collect basic profiling info to know how much time each plugin
     // spends in Transform(), Paint(), and Draw().
     Stopwatch meas_transform_;
     Stopwatch meas_paint_;
     Stopwatch meas_draw_;
+
+    // Latency from the header stamps of the plugin's messages to when they
+    // were received and when they were on screen.
+    Stopwatch meas_receive_latency_;
+    Stopwatch meas_display_latency_;
+    ros::Time drawn_stamp_;
   };
   typedef boost::shared_ptr<MapvizPlugin> MapvizPluginPtr;
 
@@ -342,6 +816,16 @@ namespace mapviz
         return;
       }
 
+      if (QThread::currentThread() != status_label->thread())
+      {
+        // Widgets can only be modified from the GUI thread.
+        QTimer::singleShot(0, status_label, [=]()
+        {
+          PrintErrorHelper(status_label, message, throttle);
+        });
+        return;
+      }
+
       if( throttle > 0.0){
           ROS_ERROR_THROTTLE(throttle, "Error: %s", message.c_str());
       }
@@ -362,6 +846,16 @@ namespace mapviz
         return;
       }
 
+      if (QThread::currentThread() != status_label->thread())
+      {
+        // Widgets can only be modified from the GUI thread.
+        QTimer::singleShot(0, status_label, [=]()
+        {
+          PrintInfoHelper(status_label, message, throttle);
+        });
+        return;
+      }
+
       if( throttle > 0.0){
           ROS_INFO_THROTTLE(throttle, "%s", message.c_str());
       }
@@ -382,6 +876,16 @@ namespace mapviz
         return;
       }
 
+      if (QThread::currentThread() != status_label->thread())
+      {
+        // Widgets can only be modified from the GUI thread.
+        QTimer::singleShot(0, status_label, [=]()
+        {
+          PrintWarningHelper(status_label, message, throttle);
+        });
+        return;
+      }
+
       if( throttle > 0.0){
           ROS_WARN_THROTTLE(throttle, "%s", message.c_str());
       }
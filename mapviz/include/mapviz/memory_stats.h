@@ -0,0 +1,111 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_MEMORY_STATS_H_
+#define MAPVIZ_MEMORY_STATS_H_
+
+// C++ standard libraries
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace mapviz
+{
+  /**
+   * Memory held by a plugin or one of its parts, in bytes.
+   */
+  struct MemoryStats
+  {
+    MemoryStats() : cpu_bytes(0), gpu_bytes(0) {}
+    MemoryStats(size_t cpu, size_t gpu) : cpu_bytes(cpu), gpu_bytes(gpu) {}
+
+    size_t Total() const { return cpu_bytes + gpu_bytes; }
+
+    MemoryStats& operator+=(const MemoryStats& other)
+    {
+      cpu_bytes += other.cpu_bytes;
+      gpu_bytes += other.gpu_bytes;
+      return *this;
+    }
+
+    // Memory in system RAM, e.g. buffered messages and vertex arrays
+    size_t cpu_bytes;
+    // Memory in video RAM, e.g. textures and vertex buffer objects
+    size_t gpu_bytes;
+  };
+
+  /**
+   * Returns the heap memory allocated by a vector, not counting anything the
+   * elements point to.
+   */
+  template <class T>
+  size_t HeapBytes(const std::vector<T>& items)
+  {
+    return items.capacity() * sizeof(T);
+  }
+
+  /**
+   * Returns the approximate heap memory allocated by a deque, not counting
+   * anything the elements point to.
+   */
+  template <class T>
+  size_t HeapBytes(const std::deque<T>& items)
+  {
+    return items.size() * sizeof(T);
+  }
+
+  inline size_t HeapBytes(const std::string& text)
+  {
+    return text.capacity();
+  }
+
+  /**
+   * Formats a number of bytes for display, e.g. "12.3 MB".
+   */
+  inline std::string FormatBytes(size_t bytes)
+  {
+    const char* units[] = {"B", "kB", "MB", "GB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024.0 && unit < 3)
+    {
+      value /= 1024.0;
+      unit++;
+    }
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return buffer;
+  }
+}
+
+#endif  // MAPVIZ_MEMORY_STATS_H_
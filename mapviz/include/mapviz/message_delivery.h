@@ -0,0 +1,177 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <ros/callback_queue_interface.h>
+#include <ros/message_traits.h>
+
+namespace mapviz
+{
+/* Hands messages to subscriber callbacks through a callback queue.
+ * MapvizPlugin::Subscribe() passes the messages it receives from ROS through
+ * this, and because roscpp needs a master to set up a subscription, even
+ * between a publisher and a subscriber in the same process, a benchmark can
+ * feed plugins the same way without one.
+ *
+ * Like a roscpp subscriber, every topic keeps at most queue_size messages
+ * that haven't been processed, and there is one callback in the queue for
+ * each of them.  A message that arrives while the topic's queue is full
+ * pushes out the oldest one without adding another callback; those are
+ * counted as dropped.
+ */
+class MessageDelivery
+{
+ public:
+  explicit MessageDelivery(ros::CallbackQueueInterface* queue)
+    :
+    queue_(queue),
+    received_(0),
+    dropped_(0)
+  {
+  }
+
+  /* Registers callback as the subscriber to topic, replacing any previous
+   * one. */
+  template <class M, class T>
+  void addSubscriber(
+      const std::string& topic,
+      uint32_t queue_size,
+      void (T::*callback)(const boost::shared_ptr<M const>&),
+      T* obj)
+  {
+    boost::shared_ptr<Subscriber> subscriber = boost::make_shared<Subscriber>();
+    subscriber->datatype = ros::message_traits::DataType<M>::value();
+    subscriber->queue_size = std::max<uint32_t>(1, queue_size);
+    subscriber->callback = [callback, obj](const boost::shared_ptr<void const>& message)
+    {
+      (obj->*callback)(boost::static_pointer_cast<M const>(message));
+    };
+
+    QMutexLocker locker(&mutex_);
+    subscribers_[topic] = subscriber;
+  }
+
+  /* Queues a message for the subscriber to topic.  Returns false if there
+   * is no subscriber to topic for messages of type M. */
+  template <class M>
+  bool deliver(const std::string& topic, const boost::shared_ptr<M const>& message)
+  {
+    boost::shared_ptr<Subscriber> subscriber;
+    {
+      QMutexLocker locker(&mutex_);
+      std::map<std::string, boost::shared_ptr<Subscriber> >::const_iterator it = subscribers_.find(topic);
+      if (it == subscribers_.end() || it->second->datatype != ros::message_traits::DataType<M>::value())
+      {
+        return false;
+      }
+      subscriber = it->second;
+    }
+
+    ++received_;
+    {
+      QMutexLocker locker(&subscriber->mutex);
+      subscriber->messages.push_back(message);
+      if (subscriber->messages.size() > subscriber->queue_size)
+      {
+        // The callback that was added for the oldest message handles this
+        // one instead.
+        subscriber->messages.pop_front();
+        ++dropped_;
+        return true;
+      }
+    }
+    queue_->addCallback(boost::make_shared<DeliveryCallback>(subscriber));
+    return true;
+  }
+
+  /* Returns the number of messages delivered since this was created,
+   * including the ones that were dropped. */
+  uint64_t receivedCount() const { return received_; }
+
+  /* Returns the number of messages that were pushed out of a full queue
+   * before they could be processed. */
+  uint64_t droppedCount() const { return dropped_; }
+
+ private:
+  struct Subscriber
+  {
+    std::string datatype;
+    uint32_t queue_size;
+    boost::function<void(const boost::shared_ptr<void const>&)> callback;
+
+    // Messages that haven't been processed yet
+    std::deque<boost::shared_ptr<void const> > messages;
+    QMutex mutex;
+  };
+
+  class DeliveryCallback : public ros::CallbackInterface
+  {
+   public:
+    explicit DeliveryCallback(const boost::shared_ptr<Subscriber>& subscriber) : subscriber_(subscriber) {}
+
+    virtual CallResult call()
+    {
+      boost::shared_ptr<void const> message;
+      {
+        QMutexLocker locker(&subscriber_->mutex);
+        if (subscriber_->messages.empty())
+        {
+          return Invalid;
+        }
+        message = subscriber_->messages.front();
+        subscriber_->messages.pop_front();
+      }
+      subscriber_->callback(message);
+      return Success;
+    }
+
+   private:
+    boost::shared_ptr<Subscriber> subscriber_;
+  };
+
+  ros::CallbackQueueInterface* queue_;
+  std::atomic<uint64_t> received_;
+  std::atomic<uint64_t> dropped_;
+  std::map<std::string, boost::shared_ptr<Subscriber> > subscribers_;
+  QMutex mutex_;
+};  // class MessageDelivery
+}  // namespace mapviz
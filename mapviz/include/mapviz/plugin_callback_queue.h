@@ -0,0 +1,106 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+#pragma once
+
+#include <string>
+
+#include <boost/make_shared.hpp>
+
+#include <ros/callback_queue.h>
+
+#include <mapviz/stopwatch.h>
+#include <mapviz/trace.h>
+
+namespace mapviz
+{
+/* A callback queue that keeps track of how long its callbacks take and
+ * traces them.
+ *
+ * Received and dropped messages are counted by MessageDelivery instead:
+ * roscpp doesn't add a callback for a message that overflows a subscription
+ * queue, so nothing here can tell that it was dropped.
+ */
+class PluginCallbackQueue : public ros::CallbackQueue
+{
+ public:
+  virtual void addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id = 0)
+  {
+    ros::CallbackQueue::addCallback(
+        boost::make_shared<TimedCallback>(callback, &meas_callback_, &trace_name_), owner_id);
+  }
+
+  /* Sets the name the callbacks are given in traces.  This must be set before
+   * any callbacks are added. */
+  void setTraceName(const std::string& name) { trace_name_ = name + " callback"; }
+
+  /* Returns the durations of the callbacks that were processed. */
+  Stopwatch& callbackTimes() { return meas_callback_; }
+
+ private:
+  class TimedCallback : public ros::CallbackInterface
+  {
+   public:
+    TimedCallback(
+        const ros::CallbackInterfacePtr& callback,
+        Stopwatch* meas_callback,
+        const std::string* trace_name)
+      :
+      callback_(callback),
+      meas_callback_(meas_callback),
+      trace_name_(trace_name)
+    {
+    }
+
+    virtual CallResult call()
+    {
+      TraceScope trace("callback", *trace_name_);
+      ros::WallTime start = ros::WallTime::now();
+      CallResult result = callback_->call();
+      if (result == Success)
+      {
+        meas_callback_->record(ros::WallTime::now() - start);
+      }
+      return result;
+    }
+
+    virtual bool ready()
+    {
+      return callback_->ready();
+    }
+
+   private:
+    ros::CallbackInterfacePtr callback_;
+    Stopwatch* meas_callback_;
+    const std::string* trace_name_;
+  };
+
+  Stopwatch meas_callback_;
+  std::string trace_name_;
+};  // class PluginCallbackQueue
+}  // namespace mapviz
@@ -0,0 +1,178 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+#ifndef MAPVIZ_POINT_TRANSFORMER_H_
+#define MAPVIZ_POINT_TRANSFORMER_H_
+
+// C++ standard libraries
+#include <cstddef>
+#include <vector>
+
+// ROS libraries
+#include <tf/transform_datatypes.h>
+#include <swri_transform_util/transform.h>
+
+#include <mapviz/bounding_box.h>
+
+namespace mapviz
+{
+  /**
+   * Applies a single transform to whole buffers of points at once.
+   *
+   * Rigid transforms are reduced to a 3x4 matrix and applied with SIMD
+   * instructions where the CPU supports them (AVX, then SSE2, with a plain
+   * C++ fallback).  Transforms that aren't rigid, such as conversions to
+   * WGS84, are detected when the transformer is created and applied one point
+   * at a time through swri_transform_util instead, so the results are always
+   * the same as transforming each point individually.
+   *
+   * Unless noted otherwise, the input and output buffers may be the same but
+   * must not otherwise overlap.
+   */
+  class PointTransformer
+  {
+  public:
+    /**
+     * Creates an identity transformer.
+     */
+    PointTransformer();
+
+    explicit PointTransformer(const swri_transform_util::Transform& transform);
+
+    /**
+     * Creates a transformer that applies local_transform followed by
+     * transform, i.e. transform * (local_transform * point).
+     */
+    PointTransformer(
+        const swri_transform_util::Transform& transform,
+        const swri_transform_util::Transform& local_transform);
+
+    /**
+     * Returns false if the transform couldn't be reduced to a matrix and
+     * points are transformed one at a time.
+     */
+    bool IsRigid() const { return rigid_; }
+
+    /**
+     * Returns true if both transformers move points to the same place.
+     * Transforms that aren't rigid are compared at a few sample points.
+     */
+    bool Equals(const PointTransformer& other) const;
+
+    /**
+     * Stores the transform as a column-major OpenGL matrix that can be passed
+     * to glMultMatrixd().  The matrix projects points onto the z = 0 plane.
+     * Returns false if the transform isn't rigid and can't be represented as
+     * a matrix.
+     */
+    bool GetGLMatrix(double matrix[16]) const;
+
+    tf::Point operator*(const tf::Point& point) const;
+
+    /**
+     * Returns a box that contains the transformed corners of the box.  For
+     * transforms that aren't rigid this is only an approximation, since the
+     * edges of the box may not stay straight.
+     */
+    BoundingBox TransformBounds(const BoundingBox& bounds) const;
+
+    /**
+     * Transforms count interleaved xyz points.
+     */
+    void TransformXYZ(const float* in, size_t count, float* out) const;
+
+    /**
+     * Transforms count interleaved xyz points and writes only the x and y
+     * coordinates of the results, e.g. into a 2D vertex array.  The buffers
+     * must not overlap.
+     */
+    void TransformXYZToXY(const float* in, size_t count, float* out) const;
+
+    /**
+     * Transforms count interleaved xy points that lie in the z = 0 plane and
+     * writes only the x and y coordinates of the results.
+     */
+    void TransformXY(const float* in, size_t count, float* out) const;
+
+    /**
+     * Transforms count points stored as separate coordinate arrays.  z may be
+     * NULL for points in the z = 0 plane, and out_z may be NULL if the z
+     * coordinates of the results aren't needed.
+     */
+    void Transform(
+        const float* x,
+        const float* y,
+        const float* z,
+        size_t count,
+        float* out_x,
+        float* out_y,
+        float* out_z) const;
+
+    /**
+     * Transforms count tf::Points spaced in_stride bytes apart and writes them
+     * to points spaced out_stride bytes apart.  This is intended for points
+     * stored in an array of structs; see the overload below.
+     */
+    void Transform(
+        const tf::Point* in,
+        size_t in_stride,
+        size_t count,
+        tf::Point* out,
+        size_t out_stride) const;
+
+    /**
+     * Transforms the point member "in" of every item and stores the result in
+     * its member "out", e.g.:
+     *   transformer.Transform(scan.points, &StampedPoint::point, &StampedPoint::transformed_point);
+     */
+    template <class T>
+    void Transform(std::vector<T>& items, tf::Point T::* in, tf::Point T::* out) const
+    {
+      if (!items.empty())
+      {
+        Transform(&(items.front().*in), sizeof(T), items.size(), &(items.front().*out), sizeof(T));
+      }
+    }
+
+  private:
+    void Initialize();
+
+    swri_transform_util::Transform transform_;
+    swri_transform_util::Transform local_transform_;
+    bool has_local_transform_;
+
+    bool rigid_;
+
+    // Row-major 3x4 matrix of the rigid transform
+    double matrix_d_[12];
+    float matrix_f_[12];
+  };
+}
+
+#endif  // MAPVIZ_POINT_TRANSFORMER_H_
@@ -0,0 +1,193 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_RENDER_BATCH_H_
+#define MAPVIZ_RENDER_BATCH_H_
+
+// C++ standard libraries
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+// QT libraries
+#include <QColor>
+
+class QGLContext;
+
+// ROS libraries
+#include <tf/transform_datatypes.h>
+
+#include <mapviz/bounding_box.h>
+#include <mapviz/memory_stats.h>
+
+namespace mapviz
+{
+  /**
+   * A set of vertices that is drawn with a single OpenGL call.
+   *
+   * Vertices are added the same way they would be in immediate mode: set the
+   * color (and texture coordinate) and then add the vertex.  The vertex data
+   * is kept in vertex buffer objects that persist between frames and is only
+   * uploaded again after it has changed, so a batch that is rebuilt only when
+   * its data changes costs a single draw call per frame no matter how many
+   * vertices it has.
+   *
+   * Vertices may be added from any thread (e.g. in a plugin's Transform()),
+   * but Draw() must be called with the canvas' OpenGL context current.  A
+   * batch may be destroyed anywhere; if its context isn't current, its
+   * buffers are deleted the next time the canvas paints.
+   */
+  class RenderBatch : private boost::noncopyable
+  {
+  public:
+    enum Primitive
+    {
+      POINTS,
+      LINES,
+      LINE_STRIP,
+      TRIANGLES,
+      QUADS
+    };
+
+    explicit RenderBatch(Primitive primitive = POINTS);
+    ~RenderBatch();
+
+    Primitive GetPrimitive() const { return primitive_; }
+    void SetPrimitive(Primitive primitive) { primitive_ = primitive; }
+
+    /**
+     * Sets the point size used for POINTS batches and the line width used for
+     * LINES and LINE_STRIP batches.
+     */
+    void SetSize(float size) { size_ = size; }
+
+    /**
+     * Sets the texture that is mapped onto the batch; 0 draws the batch
+     * without a texture.  The batch doesn't take ownership of the texture.
+     */
+    void SetTexture(unsigned int texture) { texture_ = texture; }
+
+    /**
+     * Removes all of the vertices.  The OpenGL buffers are kept so that they
+     * can be reused when the batch is filled again.
+     */
+    void Clear();
+
+    void Reserve(size_t count);
+
+    size_t Size() const { return positions_.size() / 3; }
+    bool Empty() const { return positions_.empty(); }
+
+    /**
+     * Returns a box that contains all of the vertices.
+     */
+    const BoundingBox& Bounds() const { return bounds_; }
+
+    /**
+     * Sets the color of the vertices added after this call.
+     */
+    void SetColor(const QColor& color);
+    void SetColor(float red, float green, float blue, float alpha);
+
+    /**
+     * Sets the texture coordinate of the vertices added after this call.
+     */
+    void SetTexCoord(float u, float v);
+
+    void AddVertex(double x, double y, double z = 0.0);
+    void AddVertex(const tf::Point& point)
+    {
+      AddVertex(point.x(), point.y(), point.z());
+    }
+
+    /**
+     * Changes the color of an existing vertex.  Only the colors are uploaded
+     * again if nothing else about the batch changes.
+     */
+    void SetVertexColor(size_t index, const QColor& color);
+
+    /**
+     * Uploads any vertex data that has changed and draws the batch.
+     */
+    void Draw();
+
+    /**
+     * Returns the memory held by the vertex arrays and their OpenGL buffers.
+     */
+    MemoryStats MemoryUsage() const;
+
+    /**
+     * Deletes the buffers that batches destroyed while their context wasn't
+     * current left behind in the current context.  The canvas calls this
+     * every frame.
+     */
+    static void DeleteReleasedBuffers();
+
+  private:
+    Primitive primitive_;
+    float size_;
+    unsigned int texture_;
+
+    uint8_t color_[4];
+    float tex_coord_[2];
+    bool has_tex_coords_;
+
+    struct Buffer
+    {
+      Buffer() : id(0), size(0), dirty(true) {}
+
+      unsigned int id;
+      // Number of bytes allocated for the buffer
+      size_t size;
+      bool dirty;
+    };
+
+    template <class T>
+    static void Upload(Buffer& buffer, const std::vector<T>& data);
+
+    std::vector<float> positions_;
+    std::vector<uint8_t> colors_;
+    std::vector<float> tex_coords_;
+    BoundingBox bounds_;
+
+    Buffer position_buffer_;
+    Buffer color_buffer_;
+    Buffer tex_coord_buffer_;
+
+    // The context the buffers were created in
+    const QGLContext* context_;
+  };
+  typedef boost::shared_ptr<RenderBatch> RenderBatchPtr;
+}
+
+#endif  // MAPVIZ_RENDER_BATCH_H_
@@ -0,0 +1,122 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_RENDER_CACHE_H_
+#define MAPVIZ_RENDER_CACHE_H_
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+// QT libraries
+#include <QGLFramebufferObject>
+
+#include <mapviz/memory_stats.h>
+
+namespace mapviz
+{
+  /**
+   * Keeps a plugin's output in an offscreen texture so that it can be
+   * composited onto the canvas instead of being drawn again every frame.
+   *
+   * The cached image covers the view plus a margin of MARGIN pixels on every
+   * side.  As long as the view is only translated by less than the margin,
+   * e.g. while panning or following a vehicle with a fixed orientation, the
+   * cached image is drawn with an offset.  Any other change to the view
+   * requires the plugin to be rendered again.
+   *
+   * All functions must be called with the canvas' OpenGL context current.
+   */
+  class RenderCache : private boost::noncopyable
+  {
+  public:
+    // Size of the border around the view that is rendered into the cache,
+    // in pixels.
+    static const int MARGIN;
+
+    explicit RenderCache(bool multisample);
+    ~RenderCache();
+
+    /**
+     * Returns true if render caching is supported by the OpenGL driver.
+     */
+    static bool IsSupported();
+
+    /**
+     * Discards the cached image so that the next call to Draw() fails.
+     */
+    void Invalidate() { valid_ = false; }
+
+    /**
+     * Draws the cached image if it can be reused with the current OpenGL
+     * view.  Returns false without drawing anything otherwise.
+     */
+    bool Draw();
+
+    /**
+     * Redirects drawing into the cache.  Everything that is drawn until
+     * EndRender() is called replaces the cached image.  Returns false if the
+     * cache couldn't be set up, in which case drawing goes to the canvas.
+     */
+    bool BeginRender();
+
+    void EndRender();
+
+    /**
+     * Returns the video memory held by the cached image.
+     */
+    MemoryStats MemoryUsage() const;
+
+  private:
+    bool Reusable(
+        const double modelview[16],
+        const double projection[16],
+        const int viewport[4],
+        double* offset_x,
+        double* offset_y) const;
+
+    bool multisample_;
+    bool valid_;
+
+    boost::scoped_ptr<QGLFramebufferObject> render_buffer_;
+    boost::scoped_ptr<QGLFramebufferObject> texture_buffer_;
+
+    // The view that the cached image was rendered with
+    double modelview_[16];
+    double projection_[16];
+    int viewport_[4];
+
+    // The framebuffer that was bound before rendering into the cache
+    int previous_framebuffer_;
+  };
+  typedef boost::shared_ptr<RenderCache> RenderCachePtr;
+}
+
+#endif  // MAPVIZ_RENDER_CACHE_H_
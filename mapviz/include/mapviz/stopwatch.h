@@ -28,22 +28,68 @@
 // *****************************************************************************
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+
 #include <ros/time.h>
 #include <ros/console.h>
 
+#include <mapviz/latency_histogram.h>
+
 namespace mapviz
 {
-/* This class measures the wall time of an interval and keeps track of
- * the number of intervals, the average duration, and the maximum
- * duration.  This is used to provide some simple measurements to keep
- * an eye on performance.
+/* Summary of the durations in one window of a Stopwatch, in milliseconds. */
+struct StopwatchSummary
+{
+  StopwatchSummary()
+    :
+    count(0),
+    avg_ms(0),
+    p50_ms(0),
+    p90_ms(0),
+    p99_ms(0),
+    p999_ms(0),
+    max_ms(0)
+  {
+  }
+
+  explicit StopwatchSummary(const LatencyHistogram& histogram)
+    :
+    count(histogram.count()),
+    avg_ms(histogram.avgUsec() / 1000.0),
+    p50_ms(histogram.percentileUsec(0.5) / 1000.0),
+    p90_ms(histogram.percentileUsec(0.9) / 1000.0),
+    p99_ms(histogram.percentileUsec(0.99) / 1000.0),
+    p999_ms(histogram.percentileUsec(0.999) / 1000.0),
+    max_ms(histogram.maxUsec() / 1000.0)
+  {
+  }
+
+  uint64_t count;
+  double avg_ms;
+  double p50_ms;
+  double p90_ms;
+  double p99_ms;
+  double p999_ms;
+  double max_ms;
+};
+
+/* This class measures the wall time of an interval and keeps histograms of
+ * the durations, both over the lifetime of the stopwatch and over a window
+ * that restarts every time the measurements are printed.  The window shows
+ * recent behavior, including occasional spikes that don't move the average.
+ *
+ * Recording is lock-free, so record() may be called from any thread.
+ * start() and stop() keep the start time in the stopwatch, so a stopwatch
+ * that uses them must only measure one interval at a time.
  */
 class Stopwatch
 {
  public:
   Stopwatch()
     :
-    count_(0)
+    active_window_(0)
   {
   }
 
@@ -58,55 +104,88 @@ class Stopwatch
    */
   void stop()
   {
-    ros::WallDuration dt = ros::WallTime::now() - start_;
-    count_ += 1;
-    total_time_ += dt;
-    max_time_ = std::max(max_time_, dt);
+    record(ros::WallTime::now() - start_);
+  }
+
+  /* Add a duration that was measured elsewhere. */
+  void record(const ros::WallDuration& dt)
+  {
+    uint64_t usec = static_cast<uint64_t>(std::max<int64_t>(0, dt.toNSec() / 1000));
+    lifetime_.record(usec);
+    windows_[active_window_.load(std::memory_order_relaxed)].record(usec);
   }
 
   /* Return the number of intervals measured. */
-  int count() const { return count_; }
+  int count() const { return static_cast<int>(lifetime_.count()); }
 
   /* Returns the longest observed duration. */
-  ros::WallDuration maxTime() const { return max_time_; }
+  ros::WallDuration maxTime() const
+  {
+    return ros::WallDuration().fromNSec(lifetime_.maxUsec() * 1000);
+  }
 
   /* Returns the average duration spent in the interval. */
   ros::WallDuration avgTime() const
   {
-    if (count_)
-    {
-      return total_time_*(1.0/count_);
-    }
-    else
-    {
-      return ros::WallDuration();
-    }
+    return ros::WallDuration(lifetime_.avgUsec() / 1.0e6);
+  }
+
+  /* Returns the histogram of all durations measured so far. */
+  const LatencyHistogram& lifetime() const { return lifetime_; }
+
+  /* Ends the current window and returns its histogram; new durations are
+   * recorded in a new window.  The returned histogram stays valid until the
+   * next call.
+   */
+  const LatencyHistogram& nextWindow()
+  {
+    int finished = active_window_.load();
+    int next = 1 - finished;
+    windows_[next].clear();
+    active_window_.store(next);
+    return windows_[finished];
   }
 
-  /* Print measurement info to the ROS console. */
-  void printInfo(const std::string &name) const
+  /* Ends the current window and returns a summary of it. */
+  StopwatchSummary nextSummary()
   {
-    if (count_)
+    return StopwatchSummary(nextWindow());
+  }
+
+  /* Print the measurements of the current window to the ROS console and
+   * start a new window.
+   */
+  void printInfo(const std::string &name)
+  {
+    printSummary(name, nextSummary());
+  }
+
+  static void printSummary(const std::string &name, const StopwatchSummary& summary)
+  {
+    if (summary.count)
     {
-      ROS_INFO("%s -- calls: %d, avg time: %.2fms, max time: %.2fms",
+      ROS_INFO("%s -- calls: %lu, avg: %.2fms, p50: %.2fms, p90: %.2fms, "
+               "p99: %.2fms, p99.9: %.2fms, max: %.2fms",
                name.c_str(),
-               count_,
-               avgTime().toSec()*1000.0,
-               maxTime().toSec()*1000.0);
+               static_cast<unsigned long>(summary.count),
+               summary.avg_ms,
+               summary.p50_ms,
+               summary.p90_ms,
+               summary.p99_ms,
+               summary.p999_ms,
+               summary.max_ms);
     }
     else
     {
-      ROS_INFO("%s -- calls: %d, avg time: --ms, max time: --ms",
-               name.c_str(),
-               count_);
+      ROS_INFO("%s -- calls: 0", name.c_str());
     }
   }
 
  private:
-  int count_;
-  ros::WallDuration total_time_;
-  ros::WallDuration max_time_;
+  LatencyHistogram lifetime_;
+  LatencyHistogram windows_[2];
+  std::atomic<int> active_window_;
 
   ros::WallTime start_;
-};  // class PluginInstrumentation
+};  // class Stopwatch
 }  // namespace mapviz
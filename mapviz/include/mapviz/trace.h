@@ -0,0 +1,142 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_TRACE_H_
+#define MAPVIZ_TRACE_H_
+
+// C++ standard libraries
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mapviz
+{
+  /**
+   * Records a timeline of what mapviz is doing so that slow frames can be
+   * matched up with the callbacks, transforms and loads that overlapped
+   * them.
+   *
+   * While tracing is enabled, every TraceScope adds an event to a fixed-size
+   * ring buffer, so only the most recent events are kept.  Save() writes the
+   * buffered events in the Chrome trace event format, which can be opened
+   * with chrome://tracing or the Perfetto UI.  While tracing is disabled a
+   * TraceScope only costs an atomic load.
+   *
+   * All functions are thread-safe.
+   */
+  class Tracer
+  {
+  public:
+    static void SetEnabled(bool enabled);
+
+    static bool Enabled()
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Adds an event with a start time and duration in microseconds from
+     * Now().
+     */
+    static void Record(
+        const char* category,
+        const std::string& name,
+        int64_t start_usec,
+        int64_t duration_usec);
+
+    /**
+     * Writes the buffered events to a file as Chrome trace JSON.  Returns
+     * false if the file couldn't be written.
+     */
+    static bool Save(const std::string& filename);
+
+    /**
+     * Discards all buffered events.
+     */
+    static void Clear();
+
+    /**
+     * Returns a monotonic timestamp in microseconds.
+     */
+    static int64_t Now();
+
+  private:
+    static std::atomic<bool> enabled_;
+  };
+
+  /**
+   * Records the time between its construction and destruction as a trace
+   * event, e.g.:
+   *   TraceScope trace("plugin", name_, " Draw()");
+   *
+   * Names given as strings are only copied, and joined with the suffix,
+   * while tracing is enabled.
+   */
+  class TraceScope
+  {
+  public:
+    TraceScope(const char* category, const char* name) :
+      category_(category),
+      name_(name),
+      start_(Tracer::Enabled() ? Tracer::Now() : -1)
+    {
+    }
+
+    TraceScope(const char* category, const std::string& name, const char* suffix = "") :
+      category_(category),
+      name_(NULL),
+      start_(Tracer::Enabled() ? Tracer::Now() : -1)
+    {
+      if (start_ >= 0)
+      {
+        name_string_ = name + suffix;
+      }
+    }
+
+    ~TraceScope()
+    {
+      if (start_ >= 0)
+      {
+        Tracer::Record(category_, name_ ? std::string(name_) : name_string_, start_, Tracer::Now() - start_);
+      }
+    }
+
+  private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+
+    const char* category_;
+    const char* name_;
+    std::string name_string_;
+    int64_t start_;
+  };
+}
+
+#endif  // MAPVIZ_TRACE_H_
@@ -0,0 +1,192 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include <boost/shared_ptr.hpp>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <ros/console.h>
+#include <ros/time.h>
+#include <swri_transform_util/transform.h>
+#include <swri_transform_util/transform_manager.h>
+
+#include <mapviz/trace.h>
+
+namespace mapviz
+{
+/* Caches transform lookups for the duration of a single frame.
+ *
+ * Plugins tend to look up the same (target, source, stamp) transforms over
+ * and over while drawing, e.g. once per marker or once per buffered scan.
+ * While a frame is being drawn, the first lookup of each transform goes to
+ * the transform manager and every repeat is answered from the cache.  Failed
+ * lookups are cached as well.  Outside of a frame, lookups are passed
+ * straight through to the transform manager.
+ *
+ * Lookups may be made concurrently from multiple threads.  The transform
+ * manager isn't thread safe, so lookups that go to it are serialized.
+ */
+class TransformCache
+{
+ public:
+  explicit TransformCache(swri_transform_util::TransformManagerPtr tf_manager)
+    :
+    tf_manager_(tf_manager),
+    active_(false),
+    hits_(0),
+    misses_(0)
+  {
+  }
+
+  /* Clears the cache and starts caching lookups for a new frame. */
+  void BeginFrame()
+  {
+    QMutexLocker locker(&mutex_);
+    entries_.clear();
+    active_ = true;
+  }
+
+  /* Stops caching lookups until the next frame begins. */
+  void EndFrame()
+  {
+    QMutexLocker locker(&mutex_);
+    entries_.clear();
+    active_ = false;
+  }
+
+  /* Looks up the transform from the source frame to the target frame at the
+   * given time.  A time of ros::Time() requests the latest transform.
+   */
+  bool GetTransform(
+      const std::string& target_frame,
+      const std::string& source_frame,
+      const ros::Time& time,
+      swri_transform_util::Transform& transform)
+  {
+    Key key(target_frame, source_frame, time);
+    {
+      QMutexLocker locker(&mutex_);
+      if (!active_)
+      {
+        locker.unlock();
+        QMutexLocker lookup_locker(&lookup_mutex_);
+        return tf_manager_->GetTransform(target_frame, source_frame, time, transform);
+      }
+
+      std::map<Key, Entry>::const_iterator it = entries_.find(key);
+      if (it != entries_.end())
+      {
+        ++hits_;
+        transform = it->second.transform;
+        return it->second.valid;
+      }
+    }
+
+    // Misses are looked up one at a time, but without holding mutex_ so that
+    // plugins transforming in parallel can still be answered from the cache
+    // in the meantime.  Another plugin may have looked up the same key while
+    // this one was waiting its turn.
+    QMutexLocker lookup_locker(&lookup_mutex_);
+    {
+      QMutexLocker locker(&mutex_);
+      std::map<Key, Entry>::const_iterator it = entries_.find(key);
+      if (it != entries_.end())
+      {
+        ++hits_;
+        transform = it->second.transform;
+        return it->second.valid;
+      }
+    }
+
+    ++misses_;
+    Entry entry;
+    {
+      TraceScope trace("tf", source_frame, " transform lookup");
+      entry.valid = tf_manager_->GetTransform(target_frame, source_frame, time, entry.transform);
+    }
+    transform = entry.transform;
+
+    QMutexLocker locker(&mutex_);
+    if (active_)
+    {
+      entries_[key] = entry;
+    }
+    return entry.valid;
+  }
+
+  /* Returns the number of lookups answered from the cache. */
+  uint64_t Hits() const { return hits_; }
+
+  /* Returns the number of lookups made while a frame was being drawn that
+   * had to go to the transform manager. */
+  uint64_t Misses() const { return misses_; }
+
+  /* Print the hit and miss counts to the ROS console. */
+  void PrintInfo(const std::string &name) const
+  {
+    uint64_t hits = hits_;
+    uint64_t misses = misses_;
+    uint64_t total = hits + misses;
+    ROS_INFO("%s -- hits: %lu, misses: %lu, hit rate: %.1f%%",
+             name.c_str(),
+             static_cast<unsigned long>(hits),
+             static_cast<unsigned long>(misses),
+             total ? 100.0 * hits / total : 0.0);
+  }
+
+ private:
+  typedef std::tuple<std::string, std::string, ros::Time> Key;
+
+  struct Entry
+  {
+    bool valid;
+    swri_transform_util::Transform transform;
+  };
+
+  swri_transform_util::TransformManagerPtr tf_manager_;
+
+  // Held while the transform manager is in use
+  QMutex lookup_mutex_;
+
+  QMutex mutex_;
+  bool active_;
+  std::map<Key, Entry> entries_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};  // class TransformCache
+typedef boost::shared_ptr<TransformCache> TransformCachePtr;
+}  // namespace mapviz
@@ -55,6 +55,13 @@ namespace mapviz
     bool isRecording();
     void stop();
 
+    /**
+     * Converts a frame grabbed from the canvas, which is bottom-up BGRA, into
+     * the top-down BGR image that cv::VideoWriter expects.  Returns false if
+     * the frame isn't in the expected format.
+     */
+    static bool ConvertFrame(QImage& frame, cv::Mat& image);
+
   public Q_SLOTS:
     void processFrame(QImage frame);
 
@@ -0,0 +1,132 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+// Measures how many points per second mapviz::PointTransformer can transform
+// compared to applying a swri_transform_util::Transform to one tf::Point at a
+// time, which is what the plugins used to do.
+//
+// Usage: point_transformer_benchmark [num_points] [--filter=...] [--json=...]
+
+#include <mapviz/benchmark.h>
+#include <mapviz/point_transformer.h>
+
+// C++ standard libraries
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+  size_t num_points = 1000000;
+  if (argc > 1 && std::string(argv[1]).compare(0, 2, "--") != 0)
+  {
+    num_points = std::strtoul(argv[1], NULL, 10);
+  }
+  mapviz::BenchmarkRunner runner(argc, argv);
+
+  swri_transform_util::Transform transform(tf::Transform(
+      tf::createQuaternionFromRPY(0.02, -0.01, 1.2),
+      tf::Vector3(12.5, -40.25, 1.5)));
+  mapviz::PointTransformer transformer(transform);
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+  std::vector<tf::Point> points(num_points);
+  std::vector<tf::Point> transformed_points(num_points);
+  std::vector<float> xyz(num_points * 3);
+  std::vector<float> xy(num_points * 2);
+  std::vector<float> x(num_points), y(num_points), z(num_points);
+  for (size_t i = 0; i < num_points; i++)
+  {
+    x[i] = distribution(generator);
+    y[i] = distribution(generator);
+    z[i] = distribution(generator) * 0.1f;
+    xyz[i * 3] = x[i];
+    xyz[i * 3 + 1] = y[i];
+    xyz[i * 3 + 2] = z[i];
+    xy[i * 2] = x[i];
+    xy[i * 2 + 1] = y[i];
+    points[i] = tf::Point(x[i], y[i], z[i]);
+  }
+
+  std::vector<float> out_xyz(num_points * 3);
+  std::vector<float> out_xy(num_points * 2);
+  std::vector<float> out_x(num_points), out_y(num_points), out_z(num_points);
+
+  printf("Transforming %zu points\n\n", num_points);
+
+  runner.Run("tf::Point, one at a time", num_points, [&]()
+  {
+    for (size_t i = 0; i < num_points; i++)
+    {
+      transformed_points[i] = transform * points[i];
+    }
+  });
+
+  runner.Run("float xyz -> xy, one at a time", num_points, [&]()
+  {
+    for (size_t i = 0; i < num_points; i++)
+    {
+      tf::Point point = transform * tf::Point(xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+      out_xy[i * 2] = point.x();
+      out_xy[i * 2 + 1] = point.y();
+    }
+  });
+
+  runner.Run("PointTransformer tf::Point", num_points, [&]()
+  {
+    transformer.Transform(&points[0], sizeof(tf::Point), num_points,
+                          &transformed_points[0], sizeof(tf::Point));
+  });
+
+  runner.Run("PointTransformer interleaved xyz", num_points, [&]()
+  {
+    transformer.TransformXYZ(&xyz[0], num_points, &out_xyz[0]);
+  });
+
+  runner.Run("PointTransformer interleaved xyz -> xy", num_points, [&]()
+  {
+    transformer.TransformXYZToXY(&xyz[0], num_points, &out_xy[0]);
+  });
+
+  runner.Run("PointTransformer interleaved xy", num_points, [&]()
+  {
+    transformer.TransformXY(&xy[0], num_points, &out_xy[0]);
+  });
+
+  runner.Run("PointTransformer SoA xyz", num_points, [&]()
+  {
+    transformer.Transform(&x[0], &y[0], &z[0], num_points, &out_x[0], &out_y[0], &out_z[0]);
+  });
+
+  return runner.Finish();
+}
@@ -0,0 +1,83 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+// Measures how long VideoWriter takes to convert a frame grabbed from the
+// canvas into the BGR image that is handed to the cv::VideoWriter.
+//
+// Usage: video_writer_benchmark [--filter=...] [--json=...]
+
+#include <mapviz/benchmark.h>
+#include <mapviz/video_writer.h>
+
+// C++ standard libraries
+#include <cstdio>
+#include <random>
+#include <string>
+
+// QT libraries
+#include <QImage>
+
+int main(int argc, char **argv)
+{
+  mapviz::BenchmarkRunner runner(argc, argv);
+
+  const int sizes[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    const int width = sizes[i][0];
+    const int height = sizes[i][1];
+    std::string name = "VideoWriter::ConvertFrame/" +
+        std::to_string(width) + "x" + std::to_string(height);
+    if (!runner.Enabled(name))
+    {
+      continue;
+    }
+
+    QImage frame(width, height, QImage::Format_ARGB32);
+    std::mt19937 generator(0);
+    for (int row = 0; row < height; row++)
+    {
+      uint32_t* line = reinterpret_cast<uint32_t*>(frame.scanLine(row));
+      for (int col = 0; col < width; col++)
+      {
+        line[col] = generator();
+      }
+    }
+
+    cv::Mat image;
+    runner.Run(name, static_cast<size_t>(width) * height, [&]()
+    {
+      mapviz::VideoWriter::ConvertFrame(frame, image);
+      mapviz::DoNotOptimize(image.data);
+    });
+  }
+
+  return runner.Finish();
+}
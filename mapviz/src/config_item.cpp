@@ -44,9 +44,12 @@ namespace mapviz
     edit_name_action_   = new  QAction("Edit Name", this);
     remove_item_action_ = new  QAction("Remove", this);
     remove_item_action_->setIcon(QIcon(":/images/remove-icon-th.png"));
+    conflate_action_ = new QAction("Only Process Latest Messages", this);
+    conflate_action_->setCheckable(true);
 
     connect(edit_name_action_, SIGNAL(triggered()), this, SLOT(EditName()));
     connect(remove_item_action_, SIGNAL(triggered()), this, SLOT(Remove()));
+    connect(conflate_action_, SIGNAL(toggled(bool)), this, SLOT(ToggleConflate(bool)));
   }
 
   ConfigItem::~ConfigItem()
@@ -67,10 +70,27 @@ namespace mapviz
     }
   }
 
+  void ConfigItem::ToggleConflate(bool toggled)
+  {
+    if (conflate_action_->isChecked() != toggled)
+    {
+      conflate_action_->setChecked(toggled);
+      return;
+    }
+
+    Q_EMIT ToggledConflate(item_, toggled);
+  }
+
+  void ConfigItem::SetSupportsConflate(bool supported)
+  {
+    conflate_action_->setVisible(supported);
+  }
+
   void ConfigItem::contextMenuEvent(QContextMenuEvent* event)
   {
     QMenu menu(this);
     menu.addAction(edit_name_action_);
+    menu.addAction(conflate_action_);
     menu.addAction(remove_item_action_);
     menu.exec(event->globalPos());
   }
@@ -87,6 +107,21 @@ namespace mapviz
     ui_.namelabel->setText(type_ + " (" + name_ + ")");
   }
 
+  void ConfigItem::SetMemoryUsage(const MemoryStats& memory)
+  {
+    if (memory.Total() == 0)
+    {
+      ui_.memorylabel->clear();
+      ui_.memorylabel->setToolTip(QString());
+      return;
+    }
+
+    ui_.memorylabel->setText(QString::fromStdString(FormatBytes(memory.Total())));
+    ui_.memorylabel->setToolTip(QString("CPU memory: %1\nGPU memory: %2")
+        .arg(QString::fromStdString(FormatBytes(memory.cpu_bytes)))
+        .arg(QString::fromStdString(FormatBytes(memory.gpu_bytes))));
+  }
+
   void ConfigItem::SetWidget(QWidget* widget)
   {
     ui_.label->hide();
@@ -33,11 +33,22 @@
 #include <GL/glu.h>
 
 #include <mapviz/map_canvas.h>
+#include <mapviz/render_batch.h>
+#include <mapviz/trace.h>
 
 // C++ standard libraries
+#include <algorithm>
 #include <cmath>
+
+#include <boost/bind.hpp>
 #include <swri_math_util/constants.h>
 
+// QT libraries
+#include <QtConcurrentMap>
+#include <QFont>
+#include <QFontMetrics>
+#include <QPainter>
+
 namespace mapviz
 {
 
@@ -47,9 +58,15 @@ bool compare_plugins(MapvizPluginPtr a, MapvizPluginPtr b)
   return a->DrawOrder() < b->DrawOrder();
 }
 
+void transform_plugin(MapvizPluginPtr& plugin)
+{
+  plugin->TransformPlugin();
+}
+
 MapCanvas::MapCanvas(QWidget* parent) :
   QGLWidget(QGLFormat(QGL::SampleBuffers), parent),
   has_pixel_buffers_(false),
+  has_render_cache_(false),
   pixel_buffer_size_(0),
   pixel_buffer_index_(0),
   capture_frames_(false),
@@ -57,6 +74,11 @@ MapCanvas::MapCanvas(QWidget* parent) :
   fix_orientation_(false),
   rotate_90_(false),
   enable_antialiasing_(true),
+  dirty_(true),
+  frames_drawn_(0),
+  frames_skipped_(0),
+  show_hud_(false),
+  hud_frames_drawn_(0),
   mouse_button_(Qt::NoButton),
   mouse_pressed_(false),
   mouse_x_(0),
@@ -86,7 +108,7 @@ MapCanvas::MapCanvas(QWidget* parent) :
 
   transform_.setIdentity();
 
-  QObject::connect(&frame_rate_timer_, SIGNAL(timeout()), this, SLOT(update()));
+  QObject::connect(&frame_rate_timer_, SIGNAL(timeout()), this, SLOT(RedrawIfDirty()));
   setFrameRate(50.0);
   frame_rate_timer_.start();
   setFocusPolicy(Qt::StrongFocus);
@@ -94,6 +116,11 @@ MapCanvas::MapCanvas(QWidget* parent) :
 
 MapCanvas::~MapCanvas()
 {
+  if (tf_)
+  {
+    tf_->removeTransformsChangedListener(tf_changed_connection_);
+  }
+
   if(pixel_buffer_size_ != 0)
   {
     glDeleteBuffersARB(2, pixel_buffer_ids_);
@@ -102,7 +129,22 @@ MapCanvas::~MapCanvas()
 
 void MapCanvas::InitializeTf(boost::shared_ptr<tf::TransformListener> tf)
 {
+  if (tf_)
+  {
+    tf_->removeTransformsChangedListener(tf_changed_connection_);
+  }
+
   tf_ = tf;
+
+  // New transforms can move anything that isn't in the fixed frame, so
+  // redraw whenever tf changes.
+  tf_changed_connection_ = tf_->addTransformsChangedListener(
+      boost::bind(&MapCanvas::MarkDirty, this));
+}
+
+void MapCanvas::SetTransformCache(TransformCachePtr transform_cache)
+{
+  transform_cache_ = transform_cache;
 }
 
 void MapCanvas::InitializePixelBuffers()
@@ -142,6 +184,7 @@ void MapCanvas::initializeGL()
     // Check if pixel buffers are available for asynchronous capturing
     std::string extensions = (const char*)glGetString(GL_EXTENSIONS);
     has_pixel_buffers_ = extensions.find("GL_ARB_pixel_buffer_object") != std::string::npos;
+    has_render_cache_ = RenderCache::IsSupported();
   }
 
   glClearColor(0.58f, 0.56f, 0.5f, 1);
@@ -178,6 +221,7 @@ void MapCanvas::initGlBlending()
 void MapCanvas::resizeGL(int w, int h)
 {
   UpdateView();
+  MarkDirty();
 }
 
 void MapCanvas::CaptureFrame(bool force)
@@ -218,12 +262,52 @@ void MapCanvas::CaptureFrame(bool force)
 
 void MapCanvas::paintEvent(QPaintEvent* event)
 {
-  if (capture_frames_)
+  Paint(this);
+}
+
+bool MapCanvas::RenderOffscreen(QImage* image)
+{
+  makeCurrent();
+  if (!initialized_)
+  {
+    glInit();
+  }
+
+  if (!offscreen_buffer_ || offscreen_buffer_->size() != size())
+  {
+    QGLFramebufferObjectFormat format;
+    format.setAttachment(QGLFramebufferObject::CombinedDepthStencil);
+    if (enable_antialiasing_ && QGLFramebufferObject::hasOpenGLFramebufferBlit())
+    {
+      format.setSamples(4);
+    }
+    offscreen_buffer_.reset(new QGLFramebufferObject(size(), format));
+    if (!offscreen_buffer_->isValid())
+    {
+      ROS_ERROR("Failed to create a %dx%d offscreen frame buffer.", width(), height());
+      offscreen_buffer_.reset();
+      return false;
+    }
+  }
+
+  Paint(offscreen_buffer_.get());
+  *image = offscreen_buffer_->toImage();
+  return !image->isNull();
+}
+
+void MapCanvas::Paint(QPaintDevice* device)
+{
+  TraceScope trace("canvas", "Frame");
+  meas_frame_.start();
+  frames_drawn_++;
+
+  // The capture buffer is read back from the window's frame buffer.
+  if (capture_frames_ && device == this)
   {
     CaptureFrame();
   }
 
-  QPainter p(this);
+  QPainter p(device);
   p.setRenderHints(QPainter::Antialiasing |
                    QPainter::TextAntialiasing |
                    QPainter::SmoothPixmapTransform |
@@ -233,6 +317,11 @@ void MapCanvas::paintEvent(QPaintEvent* event)
   // .beginNativePainting() disables blending and clears a handful of other
   // values that we need to manually reset.
   initGlBlending();
+
+  // Batches that were dropped outside of drawing couldn't delete their
+  // buffers themselves.
+  RenderBatch::DeleteReleasedBuffers();
+
   glMatrixMode(GL_MODELVIEW);
   glPushMatrix();
 
@@ -256,6 +345,30 @@ void MapCanvas::paintEvent(QPaintEvent* event)
   glVertex2f(0, 20);
   glEnd();
 
+  // Let the plugins skip anything that is outside of the view.  Plugins that
+  // are rendered into a cache need to draw the margin around the view, too.
+  for (std::list<MapvizPluginPtr>::iterator it = plugins_.begin(); it != plugins_.end(); ++it)
+  {
+    const bool cached = has_render_cache_ && (*it)->SupportsRenderCache();
+    (*it)->SetVisibleBounds(cached ? cached_visible_bounds_ : visible_bounds_);
+  }
+
+  // Transforms looked up by the plugins are shared for the rest of the frame.
+  if (transform_cache_)
+  {
+    transform_cache_->BeginFrame();
+  }
+
+  // The plugins' transform steps don't depend on each other or on OpenGL, so
+  // run them all at once on the thread pool and then draw them in order here.
+  meas_transform_.start();
+  {
+    TraceScope trace_transform("canvas", "Transform plugins");
+    std::vector<MapvizPluginPtr> plugins(plugins_.begin(), plugins_.end());
+    QtConcurrent::blockingMap(plugins, transform_plugin);
+  }
+  meas_transform_.stop();
+
   std::list<MapvizPluginPtr>::iterator it;
   for (it = plugins_.begin(); it != plugins_.end(); ++it)
   {
@@ -264,7 +377,7 @@ void MapCanvas::paintEvent(QPaintEvent* event)
     // for the next plugin.
     pushGlMatrices();
 
-    (*it)->DrawPlugin(view_center_x_, view_center_y_, view_scale_);
+    DrawPlugin(*it);
 
     if ((*it)->SupportsPainting())
     {
@@ -277,9 +390,83 @@ void MapCanvas::paintEvent(QPaintEvent* event)
     popGlMatrices();
   }
 
+  if (transform_cache_)
+  {
+    transform_cache_->EndFrame();
+  }
+
   glMatrixMode(GL_MODELVIEW);
   glPopMatrix();
   p.endNativePainting();
+
+  // Measure how old the data in this frame is.
+  ros::Time now = ros::Time::now();
+  for (it = plugins_.begin(); it != plugins_.end(); ++it)
+  {
+    (*it)->RecordDisplayed(now);
+  }
+
+  if (show_hud_)
+  {
+    DrawHud(&p);
+  }
+
+  meas_frame_.stop();
+}
+
+void MapCanvas::DrawPlugin(const MapvizPluginPtr& plugin)
+{
+  if (!has_render_cache_ || !plugin->SupportsRenderCache())
+  {
+    plugin->DrawPlugin(view_center_x_, view_center_y_, view_scale_);
+    return;
+  }
+
+  RenderCachePtr& cache = render_caches_[plugin.get()];
+  if (!cache)
+  {
+    cache = boost::make_shared<RenderCache>(enable_antialiasing_);
+  }
+
+  // Hidden plugins may receive data without being drawn, so their output
+  // has to be rendered again once they're shown.
+  if (!plugin->Visible())
+  {
+    cache->Invalidate();
+    plugin->DrawPlugin(view_center_x_, view_center_y_, view_scale_);
+    return;
+  }
+
+  if (plugin->NeedsRedraw())
+  {
+    cache->Invalidate();
+  }
+
+  if (cache->Draw())
+  {
+    return;
+  }
+
+  if (cache->BeginRender())
+  {
+    plugin->DrawPlugin(view_center_x_, view_center_y_, view_scale_);
+    cache->EndRender();
+    cache->Draw();
+  }
+  else
+  {
+    plugin->DrawPlugin(view_center_x_, view_center_y_, view_scale_);
+  }
+}
+
+void MapCanvas::InvalidateRenderCaches()
+{
+  std::map<MapvizPlugin*, RenderCachePtr>::iterator it;
+  for (it = render_caches_.begin(); it != render_caches_.end(); ++it)
+  {
+    it->second->Invalidate();
+  }
+  MarkDirty();
 }
 
 void MapCanvas::pushGlMatrices()
@@ -315,6 +502,7 @@ void MapCanvas::Zoom(float factor)
 {
   view_scale_ *= std::pow(1.1, factor);
   UpdateView();
+  MarkDirty();
 }
 
 void MapCanvas::mousePressEvent(QMouseEvent* e)
@@ -356,10 +544,17 @@ void MapCanvas::mouseReleaseEvent(QMouseEvent* e)
   offset_y_ += drag_y_;
   drag_x_ = 0;
   drag_y_ = 0;
+  MarkDirty();
 }
 
 void MapCanvas::mouseMoveEvent(QMouseEvent* e)
 {
+  if (mouse_pressed_)
+  {
+    // Either the view is being dragged or a plugin is handling the drag.
+    MarkDirty();
+  }
+
   if (mouse_pressed_ && canvas_able_to_move_)
   {
     int diff;
@@ -416,6 +611,7 @@ void MapCanvas::SetFixedFrame(const std::string& frame)
   {
     (*it)->SetTargetFrame(frame);
   }
+  InvalidateRenderCaches();
 }
 
 void MapCanvas::SetTargetFrame(const std::string& frame)
@@ -426,16 +622,19 @@ void MapCanvas::SetTargetFrame(const std::string& frame)
   drag_y_ = 0;
 
   target_frame_ = frame;
+  MarkDirty();
 }
 
 void MapCanvas::ToggleFixOrientation(bool on)
 {
   fix_orientation_ = on;
+  MarkDirty();
 }
 
 void MapCanvas::ToggleRotate90(bool on)
 {
   rotate_90_ = on;
+  MarkDirty();
 }
 
 void MapCanvas::ToggleEnableAntialiasing(bool on)
@@ -444,8 +643,12 @@ void MapCanvas::ToggleEnableAntialiasing(bool on)
   QGLFormat format;
   format.setSwapInterval(1);
   format.setSampleBuffers(enable_antialiasing_);
+  // The render caches belong to the current context, which is replaced.
+  makeCurrent();
+  render_caches_.clear();
   // After setting the format, initializeGL will automatically be called again, then paintGL.
   this->setFormat(format);
+  MarkDirty();
 }
 
 void MapCanvas::ToggleUseLatestTransforms(bool on)
@@ -455,19 +658,24 @@ void MapCanvas::ToggleUseLatestTransforms(bool on)
   {
     (*it)->SetUseLatestTransforms(on);
   }
+  MarkDirty();
 }
 
 void MapCanvas::AddPlugin(MapvizPluginPtr plugin, int order)
 {
   plugins_.push_back(plugin);
+  MarkDirty();
 }
 
 void MapCanvas::RemovePlugin(MapvizPluginPtr plugin)
 {
-  
-  plugin->Shutdown(); 
+  plugin->StopCallbacks();
+  plugin->Shutdown();
   plugins_.remove(plugin);
-  
+
+  makeCurrent();
+  render_caches_.erase(plugin.get());
+  MarkDirty();
 }
 
 void MapCanvas::TransformTarget(QPainter* painter)
@@ -487,6 +695,7 @@ void MapCanvas::TransformTarget(QPainter* painter)
     qtransform_ = qtransform_.scale(1, -1);
     painter->setWorldTransform(qtransform_, false);
 
+    UpdateVisibleBounds(false);
     return;
   }
 
@@ -524,6 +733,8 @@ void MapCanvas::TransformTarget(QPainter* painter)
     view_center_x_ = center.getX();
     view_center_y_ = center.getY();
 
+    UpdateVisibleBounds(true);
+
     qtransform_ = qtransform_.scale(1, -1);
     painter->setWorldTransform(qtransform_, false);
 
@@ -566,6 +777,38 @@ void MapCanvas::TransformTarget(QPainter* painter)
   }
 }
 
+void MapCanvas::UpdateVisibleBounds(bool transformed)
+{
+  // Leave a margin around the view so that things like wide lines and icons
+  // that are centered just outside of it are still drawn.
+  visible_bounds_ = ViewBounds(32.0, transformed);
+  cached_visible_bounds_ = ViewBounds(32.0 + RenderCache::MARGIN, transformed);
+}
+
+BoundingBox MapCanvas::ViewBounds(double margin_pixels, bool transformed) const
+{
+  const double margin = margin_pixels * view_scale_;
+
+  double left = view_left_ - offset_x_ - drag_x_ - margin;
+  double right = view_right_ - offset_x_ - drag_x_ + margin;
+  double bottom = view_top_ - offset_y_ - drag_y_ - margin;
+  double top = view_bottom_ - offset_y_ - drag_y_ + margin;
+
+  if (!transformed)
+  {
+    return BoundingBox(left, bottom, right, top);
+  }
+
+  // The view may be rotated relative to the target frame, so use a box that
+  // contains all of its corners.
+  BoundingBox bounds;
+  bounds.Add(transform_ * tf::Point(left, bottom, 0));
+  bounds.Add(transform_ * tf::Point(left, top, 0));
+  bounds.Add(transform_ * tf::Point(right, bottom, 0));
+  bounds.Add(transform_ * tf::Point(right, top, 0));
+  return bounds;
+}
+
 void MapCanvas::UpdateView()
 {
   if (initialized_)
@@ -591,6 +834,7 @@ void MapCanvas::ResetLocation()
 void MapCanvas::ReorderDisplays()
 {
   plugins_.sort(compare_plugins);
+  MarkDirty();
 }
 
 void MapCanvas::Recenter()
@@ -612,6 +856,200 @@ void MapCanvas::setFrameRate(const double fps)
   frame_rate_timer_.setInterval(1000.0/fps);
 }
 
+void MapCanvas::RedrawIfDirty()
+{
+  // The frame rate is an upper bound; when nothing has changed since the last
+  // frame there's no reason to repaint.
+  bool dirty = dirty_.exchange(false);
+
+  std::list<MapvizPluginPtr>::iterator it;
+  for (it = plugins_.begin(); !dirty && it != plugins_.end(); ++it)
+  {
+    dirty = (*it)->Visible() && (*it)->NeedsRedraw();
+  }
+
+  // Frames are read back from the previous paint when recording, so keep
+  // painting while capturing to avoid stalling the video.
+  if (dirty || capture_frames_)
+  {
+    update();
+  }
+  else
+  {
+    frames_skipped_++;
+  }
+}
+
+MapCanvas::Measurements MapCanvas::CollectMeasurements()
+{
+  Measurements measurements;
+  measurements.frame = meas_frame_.nextSummary();
+  measurements.transform = meas_transform_.nextSummary();
+  measurements.frames_drawn = frames_drawn_;
+  measurements.frames_skipped = frames_skipped_;
+  std::map<MapvizPlugin*, RenderCachePtr>::const_iterator it;
+  for (it = render_caches_.begin(); it != render_caches_.end(); ++it)
+  {
+    measurements.render_caches += it->second->MemoryUsage();
+  }
+  return measurements;
+}
+
+void MapCanvas::PrintMeasurements(const Measurements& measurements)
+{
+  Stopwatch::printSummary("Canvas frame", measurements.frame);
+  Stopwatch::printSummary("Canvas Transform()", measurements.transform);
+  if (transform_cache_)
+  {
+    transform_cache_->PrintInfo("Transform cache");
+  }
+  ROS_INFO("Canvas -- frames drawn: %lu, idle frames skipped: %lu, render caches: %s",
+           static_cast<unsigned long>(measurements.frames_drawn),
+           static_cast<unsigned long>(measurements.frames_skipped),
+           FormatBytes(measurements.render_caches.gpu_bytes).c_str());
+}
+
+void MapCanvas::ToggleShowHud(bool on)
+{
+  show_hud_ = on;
+  hud_frames_drawn_ = frames_drawn_;
+  hud_lines_.clear();
+  if (on)
+  {
+    hud_lines_.append("Collecting measurements...");
+  }
+  MarkDirty();
+}
+
+namespace
+{
+  struct HudPluginCost
+  {
+    QString name;
+    double draw_ms;
+    double transform_ms;
+    double message_rate;
+    double latency_ms;
+    MemoryStats memory;
+  };
+
+  bool HigherCost(const HudPluginCost& a, const HudPluginCost& b)
+  {
+    return a.draw_ms + a.transform_ms > b.draw_ms + b.transform_ms;
+  }
+
+  double TotalMs(const StopwatchSummary& summary)
+  {
+    return summary.avg_ms * summary.count;
+  }
+}
+
+void MapCanvas::UpdateHud(
+    double elapsed,
+    const Measurements& measurements,
+    const std::vector<std::pair<MapvizPluginPtr, MapvizPlugin::Measurements> >& plugins)
+{
+  // Only the most expensive displays are listed so that the overlay doesn't
+  // cover the whole map.
+  const size_t max_plugins = 8;
+
+  if (elapsed <= 0.0)
+  {
+    return;
+  }
+
+  double fps = (measurements.frames_drawn - hud_frames_drawn_) / elapsed;
+  hud_frames_drawn_ = measurements.frames_drawn;
+
+  std::vector<HudPluginCost> costs;
+  MemoryStats memory = measurements.render_caches;
+  for (size_t i = 0; i < plugins.size(); i++)
+  {
+    const MapvizPlugin::Measurements& plugin = plugins[i].second;
+    HudPluginCost cost;
+    cost.name = QString::fromStdString(plugins[i].first->Name());
+    cost.draw_ms = (TotalMs(plugin.draw) + TotalMs(plugin.paint)) / elapsed;
+    cost.transform_ms = TotalMs(plugin.transform) / elapsed;
+    cost.message_rate = plugin.callbacks.count / elapsed;
+    cost.latency_ms = plugin.display_latency.p99_ms;
+    cost.memory = plugin.memory;
+    memory += cost.memory;
+    costs.push_back(cost);
+  }
+  std::sort(costs.begin(), costs.end(), HigherCost);
+
+  hud_lines_.clear();
+  hud_lines_.append(QString("Frames: %1 fps, p50 %2 ms, p99 %3 ms, max %4 ms")
+      .arg(fps, 0, 'f', 1)
+      .arg(measurements.frame.p50_ms, 0, 'f', 2)
+      .arg(measurements.frame.p99_ms, 0, 'f', 2)
+      .arg(measurements.frame.max_ms, 0, 'f', 2));
+  hud_lines_.append(QString("Transform: p50 %1 ms, p99 %2 ms")
+      .arg(measurements.transform.p50_ms, 0, 'f', 2)
+      .arg(measurements.transform.p99_ms, 0, 'f', 2));
+  hud_lines_.append(QString("Memory: CPU %1 MB, GPU %2 MB (render caches %3 MB)")
+      .arg(memory.cpu_bytes / (1024.0 * 1024.0), 0, 'f', 1)
+      .arg(memory.gpu_bytes / (1024.0 * 1024.0), 0, 'f', 1)
+      .arg(measurements.render_caches.gpu_bytes / (1024.0 * 1024.0), 0, 'f', 1));
+  hud_lines_.append("");
+  hud_lines_.append(QString("%1 %2 %3 %4 %5 %6 %7")
+      .arg("Display", -24)
+      .arg("draw ms/s", 10)
+      .arg("xform ms/s", 10)
+      .arg("msgs/s", 8)
+      .arg("p99 age ms", 10)
+      .arg("CPU MB", 8)
+      .arg("GPU MB", 8));
+  for (size_t i = 0; i < costs.size() && i < max_plugins; i++)
+  {
+    hud_lines_.append(QString("%1 %2 %3 %4 %5 %6 %7")
+        .arg(costs[i].name.left(24), -24)
+        .arg(costs[i].draw_ms, 10, 'f', 1)
+        .arg(costs[i].transform_ms, 10, 'f', 1)
+        .arg(costs[i].message_rate, 8, 'f', 1)
+        .arg(costs[i].latency_ms, 10, 'f', 1)
+        .arg(costs[i].memory.cpu_bytes / (1024.0 * 1024.0), 8, 'f', 1)
+        .arg(costs[i].memory.gpu_bytes / (1024.0 * 1024.0), 8, 'f', 1));
+  }
+  if (costs.size() > max_plugins)
+  {
+    hud_lines_.append(QString("(%1 more)").arg(costs.size() - max_plugins));
+  }
+
+  MarkDirty();
+}
+
+void MapCanvas::DrawHud(QPainter* painter)
+{
+  const int margin = 8;
+
+  QFont font("Monospace");
+  font.setStyleHint(QFont::TypeWriter);
+  font.setPointSize(9);
+  QFontMetrics metrics(font);
+
+  int text_width = 0;
+  for (int i = 0; i < hud_lines_.size(); i++)
+  {
+    text_width = std::max(text_width, metrics.width(hud_lines_[i]));
+  }
+  int line_height = metrics.lineSpacing();
+
+  painter->save();
+  painter->resetTransform();
+  painter->setPen(Qt::NoPen);
+  painter->setBrush(QColor(0, 0, 0, 160));
+  painter->drawRect(margin, margin, text_width + 2 * margin, line_height * hud_lines_.size() + 2 * margin);
+
+  painter->setFont(font);
+  painter->setPen(Qt::white);
+  for (int i = 0; i < hud_lines_.size(); i++)
+  {
+    painter->drawText(2 * margin, 2 * margin + i * line_height + metrics.ascent(), hud_lines_[i]);
+  }
+  painter->restore();
+}
+
 double MapCanvas::frameRate() const
 {
   return 1000.0 / frame_rate_timer_.interval();
@@ -37,6 +37,7 @@
 #include <sstream>
 
 // Boost libraries
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -74,6 +75,7 @@
 #include <swri_yaml_util/yaml_util.h>
 
 #include <mapviz/config_item.h>
+#include <mapviz/trace.h>
 #include <QtGui/QtGui>
 
 #include <image_transport/image_transport.h>
@@ -100,7 +102,13 @@ Mapviz::Mapviz(bool is_standalone, int argc, char** argv, QWidget *parent, Qt::W
     vid_writer_(NULL),
     updating_frames_(false),
     node_(NULL),
-    canvas_(NULL)
+    canvas_(NULL),
+    print_profile_data_(false),
+    last_frames_drawn_(0),
+    headless_(false),
+    headless_frames_(0),
+    headless_frame_count_(0),
+    headless_video_(false)
 {
   ui_.setupUi(this);
 
@@ -183,6 +191,8 @@ Mapviz::Mapviz(bool is_standalone, int argc, char** argv, QWidget *parent, Qt::W
   connect(stop_button_, SIGNAL(clicked()), this, SLOT(StopRecord()));
   connect(screenshot_button_, SIGNAL(clicked()), this, SLOT(Screenshot()));
   connect(ui_.actionClear_History, SIGNAL(triggered()), this, SLOT(ClearHistory()));
+  connect(ui_.actionRecord_Trace, SIGNAL(toggled(bool)), this, SLOT(ToggleTracing(bool)));
+  connect(ui_.actionSave_Trace, SIGNAL(triggered()), this, SLOT(SaveTrace()));
 
   // Use a separate thread for writing video files so that it won't cause
   // lag on the main thread.
@@ -201,6 +211,10 @@ Mapviz::Mapviz(bool is_standalone, int argc, char** argv, QWidget *parent, Qt::W
 
   ui_.bg_color->setColor(background_);
   canvas_->SetBackground(background_);
+
+  // Watch for user input anywhere in the application so that edits in the
+  // config panel are drawn even though the canvas only repaints on changes.
+  qApp->installEventFilter(this);
 }
 
 Mapviz::~Mapviz()
@@ -215,6 +229,136 @@ void Mapviz::showEvent(QShowEvent* event)
   Initialize();
 }
 
+void Mapviz::StartHeadless()
+{
+  headless_ = true;
+
+  // The canvas is never shown, but it still needs a native window to create
+  // its OpenGL context for.
+  canvas_->winId();
+  Initialize();
+
+  ros::NodeHandle priv("~");
+  int width;
+  int height;
+  double rate;
+  std::string timings_file;
+  priv.param("headless_width", width, 1280);
+  priv.param("headless_height", height, 720);
+  priv.param("headless_rate", rate, 10.0);
+  priv.param("headless_frames", headless_frames_, 0);
+  priv.param("headless_output", headless_output_, std::string());
+  priv.param("headless_timings", timings_file, std::string());
+  boost::replace_all(headless_output_, "~", getenv("HOME"));
+  boost::replace_all(timings_file, "~", getenv("HOME"));
+
+  // The config may have set a fixed size for the canvas.
+  canvas_->setFixedSize(width, height);
+  canvas_->resize(width, height);
+
+  headless_video_ = boost::algorithm::ends_with(headless_output_, ".avi");
+  if (headless_video_)
+  {
+    if (!vid_writer_->initializeWriter(headless_output_, width, height))
+    {
+      ROS_ERROR("Failed to open video file %s for writing.", headless_output_.c_str());
+      QCoreApplication::exit(1);
+      return;
+    }
+  }
+  else if (!headless_output_.empty())
+  {
+    boost::system::error_code error;
+    boost::filesystem::create_directories(headless_output_, error);
+    if (error)
+    {
+      ROS_ERROR("Failed to create output directory %s: %s", headless_output_.c_str(), error.message().c_str());
+      QCoreApplication::exit(1);
+      return;
+    }
+  }
+
+  if (!timings_file.empty())
+  {
+    headless_timings_.open(timings_file.c_str());
+    if (!headless_timings_)
+    {
+      ROS_ERROR("Failed to open %s for writing.", timings_file.c_str());
+    }
+    headless_timings_ << "frame,wall_time,render_ms,write_ms" << std::endl;
+  }
+
+  ROS_INFO("Rendering %dx%d frames offscreen at %.1f Hz", width, height, rate);
+  connect(&headless_timer_, SIGNAL(timeout()), this, SLOT(RenderHeadlessFrame()));
+  headless_timer_.start(static_cast<int>(1000.0 / rate));
+}
+
+void Mapviz::RenderHeadlessFrame()
+{
+  if (!ros::ok() || (headless_frames_ > 0 && headless_frame_count_ >= headless_frames_))
+  {
+    StopHeadless();
+    return;
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  QImage frame;
+  if (!canvas_->RenderOffscreen(&frame))
+  {
+    ROS_ERROR("Failed to render frame %d.", headless_frame_count_);
+    StopHeadless();
+    return;
+  }
+  ros::WallTime rendered = ros::WallTime::now();
+
+  if (headless_video_)
+  {
+    // The video writer expects a BGRA image that is upside down, like the
+    // ones read back from the window.  Frames are written here instead of on
+    // the video thread so none are still queued when rendering stops.
+    vid_writer_->processFrame(frame.convertToFormat(QImage::Format_ARGB32).mirrored(false, true));
+  }
+  else if (!headless_output_.empty())
+  {
+    QString filename = QString("%1/frame_%2.png")
+        .arg(QString::fromStdString(headless_output_))
+        .arg(headless_frame_count_, 6, 10, QChar('0'));
+    if (!frame.save(filename))
+    {
+      ROS_ERROR("Failed to write %s", filename.toStdString().c_str());
+    }
+  }
+  ros::WallTime written = ros::WallTime::now();
+
+  meas_headless_render_.record(rendered - start);
+  meas_headless_write_.record(written - rendered);
+  if (headless_timings_.is_open())
+  {
+    headless_timings_ << headless_frame_count_ << ","
+                      << std::fixed << start.toSec() << ","
+                      << (rendered - start).toSec() * 1000.0 << ","
+                      << (written - rendered).toSec() * 1000.0 << std::endl;
+  }
+
+  headless_frame_count_++;
+}
+
+void Mapviz::StopHeadless()
+{
+  headless_timer_.stop();
+  if (headless_video_)
+  {
+    vid_writer_->stop();
+  }
+  headless_timings_.close();
+
+  ROS_INFO("Rendered %d frames", headless_frame_count_);
+  Stopwatch::printSummary("Headless render", meas_headless_render_.nextSummary());
+  Stopwatch::printSummary("Headless write", meas_headless_write_.nextSummary());
+
+  QCoreApplication::quit();
+}
+
 void Mapviz::closeEvent(QCloseEvent* event)
 {
   AutoSave();
@@ -228,6 +372,35 @@ void Mapviz::closeEvent(QCloseEvent* event)
   plugins_.clear();
 }
 
+bool Mapviz::eventFilter(QObject* object, QEvent* event)
+{
+  switch (event->type())
+  {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::Wheel:
+      if (canvas_)
+      {
+        canvas_->MarkDirty();
+
+        // Input to anything other than the canvas itself, such as a
+        // plugin's config widget, may change what cached plugins draw.
+        if (object != canvas_ && object->isWidgetType())
+        {
+          canvas_->InvalidateRenderCaches();
+        }
+      }
+      break;
+    default:
+      break;
+  }
+
+  return QMainWindow::eventFilter(object, event);
+}
+
 void Mapviz::Initialize()
 {
   if (!initialized_)
@@ -238,11 +411,13 @@ void Mapviz::Initialize()
       // ROS and start spinning.  If it's running as an rqt plugin, rqt will
       // take care of that.
       ros::init(argc_, argv_, "mapviz", ros::init_options::AnonymousName);
-
-      spin_timer_.start(30);
-      connect(&spin_timer_, SIGNAL(timeout()), this, SLOT(SpinOnce()));
     }
 
+    // Plugins have their own callback queues, which need to be serviced
+    // whether or not we're running as an rqt plugin.
+    spin_timer_.start(30);
+    connect(&spin_timer_, SIGNAL(timeout()), this, SLOT(SpinOnce()));
+
     node_ = new ros::NodeHandle("~");
 
     // Create a sub-menu that lists all available Image Transports
@@ -263,6 +438,7 @@ void Mapviz::Initialize()
     tf_ = boost::make_shared<tf::TransformListener>();
     tf_manager_ = boost::make_shared<swri_transform_util::TransformManager>();
     tf_manager_->Initialize(tf_);
+    transform_cache_ = boost::make_shared<TransformCache>(tf_manager_);
 
     loader_ = new pluginlib::ClassLoader<MapvizPlugin>(
         "mapviz", "mapviz::MapvizPlugin");
@@ -274,12 +450,14 @@ void Mapviz::Initialize()
     }
 
     canvas_->InitializeTf(tf_);
+    canvas_->SetTransformCache(transform_cache_);
     canvas_->SetFixedFrame(ui_.fixedframe->currentText().toStdString());
     canvas_->SetTargetFrame(ui_.targetframe->currentText().toStdString());
 
     ros::NodeHandle priv("~");
 
     add_display_srv_ = node_->advertiseService("add_mapviz_display", &Mapviz::AddDisplay, this);
+    save_trace_srv_ = priv.advertiseService("save_trace", &Mapviz::SaveTraceService, this);
 
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     QString default_path = QDir::homePath();
@@ -314,7 +492,13 @@ void Mapviz::Initialize()
     frame_timer_.start(1000);
     connect(&frame_timer_, SIGNAL(timeout()), this, SLOT(UpdateFrames()));
 
-    if (auto_save)
+    if (!headless_)
+    {
+      memory_timer_.start(2000);
+      connect(&memory_timer_, SIGNAL(timeout()), this, SLOT(UpdateMemoryUsage()));
+    }
+
+    if (auto_save && !headless_)
     {
       save_timer_.start(10000);
       connect(&save_timer_, SIGNAL(timeout()), this, SLOT(AutoSave()));
@@ -322,13 +506,30 @@ void Mapviz::Initialize()
 
     connect(&record_timer_, SIGNAL(timeout()), this, SLOT(CaptureVideoFrame()));
 
-    bool print_profile_data;
-    priv.param("print_profile_data", print_profile_data, false);
-    if (print_profile_data)
+    // Performance telemetry is published at telemetry_rate (in Hz) if it is
+    // greater than zero.  Profile data is printed at the same rate in that
+    // case, or every 2 seconds otherwise.
+    double telemetry_rate;
+    priv.param("print_profile_data", print_profile_data_, false);
+    priv.param("telemetry_rate", telemetry_rate, 0.0);
+    if (telemetry_rate > 0.0)
     {
-      profile_timer_.start(2000);
-      connect(&profile_timer_, SIGNAL(timeout()), this, SLOT(HandleProfileTimer()));
+      telemetry_pub_ = priv.advertise<diagnostic_msgs::DiagnosticArray>("performance", 10);
     }
+    connect(&profile_timer_, SIGNAL(timeout()), this, SLOT(HandleProfileTimer()));
+    if (print_profile_data_ || telemetry_pub_)
+    {
+      last_profile_time_ = ros::WallTime::now();
+      // Rates above 1 kHz are limited to the timer's 1 ms resolution.
+      profile_timer_.start(telemetry_pub_ ? std::max(1, static_cast<int>(1000.0 / telemetry_rate)) : 2000);
+    }
+
+    // Tracing can also be turned on from the Data menu.  The save_trace
+    // service writes the trace to trace_file.
+    bool enable_tracing;
+    priv.param("enable_tracing", enable_tracing, false);
+    priv.param("trace_file", trace_file_, QDir::homePath().toStdString() + "/mapviz_trace.json");
+    ui_.actionRecord_Trace->setChecked(enable_tracing);
 
     setFocus(); // Set the main window as focused object, prevent other fields from obtaining focus at startup
 
@@ -338,16 +539,25 @@ void Mapviz::Initialize()
 
 void Mapviz::SpinOnce()
 {
-  if (ros::ok())
+  if (is_standalone_ && !ros::ok())
+  {
+    QApplication::exit();
+    return;
+  }
+
+  meas_spin_.start();
+  if (is_standalone_)
   {
-    meas_spin_.start();
     ros::spinOnce();
-    meas_spin_.stop();
   }
-  else
+
+  // Plugins that don't process their callbacks on a separate thread are
+  // serviced here, on the GUI thread.
+  for (auto& display: plugins_)
   {
-    QApplication::exit();
+    display.second->ProcessCallbacks();
   }
+  meas_spin_.stop();
 }
 
 void Mapviz::UpdateFrames()
@@ -724,10 +934,22 @@ void Mapviz::Open(const std::string& filename)
         bool collapsed = false;
         config["collapsed"] >> collapsed;
 
+        bool conflate = false;
+        if (swri_yaml_util::FindValue(config, "conflate"))
+        {
+          config["conflate"] >> conflate;
+        }
+
         try
         {
           MapvizPluginPtr plugin =
               CreateNewDisplay(name, type, visible, collapsed);
+          // Set this before loading the config so the plugin subscribes with
+          // the right queue size.
+          if (plugin->SupportsConflate())
+          {
+            plugin->SetConflate(conflate);
+          }
           plugin->LoadConfig(config, config_path);
           plugin->DrawIcon();
         }
@@ -822,6 +1044,10 @@ void Mapviz::Save(const std::string& filename)
 
       out << YAML::Key << "visible" << YAML::Value << plugins_[ui_.configs->item(i)]->Visible();
       out << YAML::Key << "collapsed" << YAML::Value << (static_cast<ConfigItem*>(ui_.configs->itemWidget(ui_.configs->item(i))))->Collapsed();
+      if (plugins_[ui_.configs->item(i)]->SupportsConflate())
+      {
+        out << YAML::Key << "conflate" << YAML::Value << plugins_[ui_.configs->item(i)]->Conflate();
+      }
 
       plugins_[ui_.configs->item(i)]->SaveConfig(out, config_path);
 
@@ -947,6 +1173,55 @@ void Mapviz::ClearHistory()
   }
 }
 
+void Mapviz::ToggleTracing(bool on)
+{
+  if (on)
+  {
+    Tracer::Clear();
+  }
+  Tracer::SetEnabled(on);
+}
+
+void Mapviz::SaveTrace()
+{
+  QFileDialog dialog(this, "Save Trace File");
+  dialog.setFileMode(QFileDialog::AnyFile);
+  dialog.setAcceptMode(QFileDialog::AcceptSave);
+  dialog.setNameFilter(tr("Chrome Trace Files (*.json)"));
+  dialog.setDefaultSuffix("json");
+  dialog.selectFile(QString::fromStdString(trace_file_));
+  dialog.exec();
+
+  if (dialog.result() == QDialog::Accepted && dialog.selectedFiles().count() == 1)
+  {
+    std::string path = dialog.selectedFiles().first().toStdString();
+    if (!Tracer::Save(path))
+    {
+      ROS_ERROR("Failed to save trace to %s", path.c_str());
+    }
+  }
+}
+
+bool Mapviz::SaveTraceService(
+      std_srvs::Trigger::Request& req,
+      std_srvs::Trigger::Response& resp)
+{
+  resp.success = Tracer::Save(trace_file_);
+  if (resp.success)
+  {
+    resp.message = "Saved trace to " + trace_file_;
+  }
+  else
+  {
+    resp.message = "Failed to save trace to " + trace_file_;
+  }
+  if (!Tracer::Enabled())
+  {
+    resp.message += " (tracing is not enabled)";
+  }
+  return true;
+}
+
 void Mapviz::SelectNewDisplay()
 {
   ROS_INFO("Select new display ...");
@@ -1003,6 +1278,8 @@ bool Mapviz::AddDisplay(
     return false;
   }
 
+  canvas_->MarkDirty();
+
   for (auto& display: plugins_)
   {
     MapvizPluginPtr plugin = display.second;
@@ -1161,6 +1438,7 @@ MapvizPluginPtr Mapviz::CreateNewDisplay(
   // Setup configure widget
   config_item->SetWidget(plugin->GetConfigWidget(this));
   plugin->SetIcon(config_item->ui_.icon);
+  plugin->SetTransformCache(transform_cache_);
   plugin->Initialize(tf_, tf_manager_, canvas_);
   plugin->SetType(real_type.c_str());
   plugin->SetName(name);
@@ -1183,13 +1461,16 @@ MapvizPluginPtr Mapviz::CreateNewDisplay(
   QString pretty_type(real_type.c_str());
   pretty_type = pretty_type.split('/').last();
   config_item->SetType(pretty_type);
+  config_item->SetSupportsConflate(plugin->SupportsConflate());
   QListWidgetItem* item = new PluginConfigListItem();
   config_item->SetListItem(item);
   item->setSizeHint(config_item->sizeHint());
   connect(config_item, SIGNAL(UpdateSizeHint()), this, SLOT(UpdateSizeHints()));
   connect(config_item, SIGNAL(ToggledDraw(QListWidgetItem*, bool)), this, SLOT(ToggleShowPlugin(QListWidgetItem*, bool)));
+  connect(config_item, SIGNAL(ToggledConflate(QListWidgetItem*, bool)), this, SLOT(ToggleConflatePlugin(QListWidgetItem*, bool)));
   connect(config_item, SIGNAL(RemoveRequest(QListWidgetItem*)), this, SLOT(RemoveDisplay(QListWidgetItem*)));
   connect(plugin.get(), SIGNAL(VisibleChanged(bool)), config_item, SLOT(ToggleDraw(bool)));
+  connect(plugin.get(), SIGNAL(ConflateChanged(bool)), config_item, SLOT(ToggleConflate(bool)));
   connect(plugin.get(), SIGNAL(SizeChanged()), this, SLOT(UpdateSizeHints()));
 
   if (real_type == "mapviz_plugins/image")
@@ -1239,6 +1520,15 @@ void Mapviz::ToggleShowPlugin(QListWidgetItem* item, bool visible)
     plugins_[item]->SetVisible(visible);
   }
   canvas_->UpdateView();
+  canvas_->MarkDirty();
+}
+
+void Mapviz::ToggleConflatePlugin(QListWidgetItem* item, bool conflate)
+{
+  if (plugins_.count(item) == 1 && plugins_[item]->SupportsConflate())
+  {
+    plugins_[item]->SetConflate(conflate);
+  }
 }
 
 void Mapviz::FixedFrameSelected(const QString& text)
@@ -1286,6 +1576,28 @@ void Mapviz::ToggleEnableAntialiasing(bool on)
   canvas_->ToggleEnableAntialiasing(on);
 }
 
+void Mapviz::ToggleShowHud(bool on)
+{
+  canvas_->ToggleShowHud(on);
+
+  // The HUD is updated by the profile timer, which only runs on its own if
+  // profile data is printed or published.
+  if (print_profile_data_ || telemetry_pub_)
+  {
+    return;
+  }
+
+  if (on)
+  {
+    last_profile_time_ = ros::WallTime::now();
+    profile_timer_.start(1000);
+  }
+  else
+  {
+    profile_timer_.stop();
+  }
+}
+
 void Mapviz::ToggleConfigPanel(bool on)
 {
   if (on)
@@ -1545,15 +1857,146 @@ void Mapviz::SetCaptureDirectory()
 
 void Mapviz::HandleProfileTimer()
 {
-  ROS_INFO("Mapviz Profiling Data");
-  meas_spin_.printInfo("ROS SpinOnce()");
+  // Every measurement window is ended exactly once here, so the printed and
+  // published data always cover the same period.
+  ros::WallTime now = ros::WallTime::now();
+  double elapsed = (now - last_profile_time_).toSec();
+  last_profile_time_ = now;
+
+  StopwatchSummary spin = meas_spin_.nextSummary();
+  MapCanvas::Measurements canvas = canvas_->CollectMeasurements();
+  std::vector<std::pair<MapvizPluginPtr, MapvizPlugin::Measurements> > plugins;
   for (auto& display: plugins_)
   {
     MapvizPluginPtr plugin = display.second;
     if (plugin)
     {
-      plugin->PrintMeasurements();
+      plugins.push_back(std::make_pair(plugin, plugin->CollectMeasurements()));
+    }
+  }
+
+  if (print_profile_data_)
+  {
+    ROS_INFO("Mapviz Profiling Data");
+    Stopwatch::printSummary("ROS SpinOnce()", spin);
+    canvas_->PrintMeasurements(canvas);
+    for (size_t i = 0; i < plugins.size(); i++)
+    {
+      plugins[i].first->PrintMeasurements(plugins[i].second);
     }
   }
+
+  if (telemetry_pub_)
+  {
+    PublishTelemetry(elapsed, canvas, spin, plugins);
+  }
+
+  if (canvas_->ShowHud())
+  {
+    canvas_->UpdateHud(elapsed, canvas, plugins);
+  }
+
+  last_frames_drawn_ = canvas.frames_drawn;
+}
+
+void Mapviz::UpdateMemoryUsage()
+{
+  for (int i = 0; i < ui_.configs->count(); i++)
+  {
+    QListWidgetItem* item = ui_.configs->item(i);
+    ConfigItem* widget = static_cast<ConfigItem*>(ui_.configs->itemWidget(item));
+    std::map<QListWidgetItem*, MapvizPluginPtr>::iterator plugin = plugins_.find(item);
+    if (widget && plugin != plugins_.end() && plugin->second)
+    {
+      widget->SetMemoryUsage(plugin->second->MemoryUsage());
+    }
+  }
+}
+
+namespace
+{
+  void AddValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, const std::string& value)
+  {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = value;
+    status.values.push_back(key_value);
+  }
+
+  void AddValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, double value)
+  {
+    AddValue(status, key, std::to_string(value));
+  }
+
+  void AddValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, uint64_t value)
+  {
+    AddValue(status, key, std::to_string(value));
+  }
+
+  void AddTimings(
+      diagnostic_msgs::DiagnosticStatus& status,
+      const std::string& prefix,
+      const StopwatchSummary& summary)
+  {
+    AddValue(status, prefix + "_count", summary.count);
+    AddValue(status, prefix + "_avg_ms", summary.avg_ms);
+    AddValue(status, prefix + "_p50_ms", summary.p50_ms);
+    AddValue(status, prefix + "_p90_ms", summary.p90_ms);
+    AddValue(status, prefix + "_p99_ms", summary.p99_ms);
+    AddValue(status, prefix + "_p99.9_ms", summary.p999_ms);
+    AddValue(status, prefix + "_max_ms", summary.max_ms);
+  }
+}
+
+void Mapviz::PublishTelemetry(
+    double elapsed,
+    const MapCanvas::Measurements& canvas,
+    const StopwatchSummary& spin,
+    const std::vector<std::pair<MapvizPluginPtr, MapvizPlugin::Measurements> >& plugins)
+{
+  diagnostic_msgs::DiagnosticArray telemetry;
+  telemetry.header.stamp = ros::Time::now();
+
+  diagnostic_msgs::DiagnosticStatus status;
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "mapviz: canvas";
+  status.hardware_id = "mapviz";
+  status.message = "OK";
+  double fps = elapsed > 0.0 ? (canvas.frames_drawn - last_frames_drawn_) / elapsed : 0.0;
+  AddValue(status, "fps", fps);
+  AddValue(status, "target_fps", canvas_->frameRate());
+  AddValue(status, "frames_drawn", canvas.frames_drawn);
+  AddValue(status, "frames_skipped", canvas.frames_skipped);
+  AddValue(status, "render_cache_gpu_bytes", static_cast<uint64_t>(canvas.render_caches.gpu_bytes));
+  AddTimings(status, "frame", canvas.frame);
+  AddTimings(status, "transform", canvas.transform);
+  AddTimings(status, "spin", spin);
+  telemetry.status.push_back(status);
+
+  for (size_t i = 0; i < plugins.size(); i++)
+  {
+    const MapvizPluginPtr& plugin = plugins[i].first;
+    const MapvizPlugin::Measurements& measurements = plugins[i].second;
+
+    diagnostic_msgs::DiagnosticStatus plugin_status;
+    plugin_status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    plugin_status.name = "mapviz: " + plugin->Name();
+    plugin_status.hardware_id = plugin->Type();
+    plugin_status.message = plugin->Visible() ? "visible" : "hidden";
+    AddValue(plugin_status, "messages_received", plugin->ReceivedMessages());
+    AddValue(plugin_status, "messages_dropped", plugin->DroppedMessages());
+    AddValue(plugin_status, "buffered_elements", plugin->BufferedElements());
+    AddValue(plugin_status, "cpu_bytes", static_cast<uint64_t>(measurements.memory.cpu_bytes));
+    AddValue(plugin_status, "gpu_bytes", static_cast<uint64_t>(measurements.memory.gpu_bytes));
+    AddTimings(plugin_status, "callback", measurements.callbacks);
+    AddTimings(plugin_status, "transform", measurements.transform);
+    AddTimings(plugin_status, "draw", measurements.draw);
+    AddTimings(plugin_status, "paint", measurements.paint);
+    AddTimings(plugin_status, "receive_latency", measurements.receive_latency);
+    AddTimings(plugin_status, "display_latency", measurements.display_latency);
+    telemetry.status.push_back(plugin_status);
+  }
+
+  telemetry_pub_.publish(telemetry);
 }
 }
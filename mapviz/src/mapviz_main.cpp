@@ -31,6 +31,8 @@
 #include "mapviz/mapviz_application.h"
 #include <GL/glut.h>
 
+#include <cstring>
+
 int main(int argc, char **argv)
 {
   // Initialize QT
@@ -41,7 +43,26 @@ int main(int argc, char **argv)
 
   // Start mapviz
   mapviz::Mapviz mapviz(true, argc, argv);
-  mapviz.show();
+
+  // With --headless, mapviz renders into offscreen frames instead of showing
+  // its window.
+  bool headless = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--headless") == 0)
+    {
+      headless = true;
+    }
+  }
+
+  if (headless)
+  {
+    mapviz.StartHeadless();
+  }
+  else
+  {
+    mapviz.show();
+  }
 
   return app.exec();
 }
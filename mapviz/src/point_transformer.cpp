@@ -0,0 +1,575 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+#include <mapviz/point_transformer.h>
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MAPVIZ_HAS_SSE2
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MAPVIZ_HAS_AVX
+#define MAPVIZ_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+namespace mapviz
+{
+namespace
+{
+  // The tf::Point kernels read and write the coordinates directly.
+  static_assert(sizeof(tfScalar) == sizeof(double), "tf must use double precision");
+
+  const double* Coordinates(const tf::Point* point, size_t index, size_t stride)
+  {
+    return reinterpret_cast<const tf::Point*>(
+        reinterpret_cast<const char*>(point) + index * stride)->m_floats;
+  }
+
+  double* Coordinates(tf::Point* point, size_t index, size_t stride)
+  {
+    return reinterpret_cast<tf::Point*>(
+        reinterpret_cast<char*>(point) + index * stride)->m_floats;
+  }
+
+#ifdef MAPVIZ_HAS_AVX
+  bool CpuHasAvx()
+  {
+    static const bool has_avx = []()
+    {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx") != 0;
+    }();
+    return has_avx;
+  }
+
+  MAPVIZ_TARGET_AVX
+  size_t TransformXYAvx(const float* m, const float* in, size_t count, float* out)
+  {
+    // Four points per iteration: duplicate the x and y coordinates of each
+    // point into both of its lanes and apply the matching matrix columns.
+    const __m256 cx = _mm256_setr_ps(m[0], m[4], m[0], m[4], m[0], m[4], m[0], m[4]);
+    const __m256 cy = _mm256_setr_ps(m[1], m[5], m[1], m[5], m[1], m[5], m[1], m[5]);
+    const __m256 t = _mm256_setr_ps(m[3], m[7], m[3], m[7], m[3], m[7], m[3], m[7]);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m256 v = _mm256_loadu_ps(in + 2 * i);
+      __m256 r = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(cx, _mm256_moveldup_ps(v)),
+                        _mm256_mul_ps(cy, _mm256_movehdup_ps(v))),
+          t);
+      _mm256_storeu_ps(out + 2 * i, r);
+    }
+    _mm256_zeroupper();
+    return i;
+  }
+
+  MAPVIZ_TARGET_AVX
+  size_t TransformSoAAvx(
+      const float* m,
+      const float* x,
+      const float* y,
+      const float* z,
+      size_t count,
+      float* out_x,
+      float* out_y,
+      float* out_z)
+  {
+    const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+    const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+    const __m256 m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m11 = _mm256_set1_ps(m[11]);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256 vx = _mm256_loadu_ps(x + i);
+      __m256 vy = _mm256_loadu_ps(y + i);
+      __m256 vz = z ? _mm256_loadu_ps(z + i) : _mm256_setzero_ps();
+
+      __m256 rx = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(m0, vx), _mm256_mul_ps(m1, vy)),
+          _mm256_add_ps(_mm256_mul_ps(m2, vz), m3));
+      __m256 ry = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(m4, vx), _mm256_mul_ps(m5, vy)),
+          _mm256_add_ps(_mm256_mul_ps(m6, vz), m7));
+      if (out_z)
+      {
+        __m256 rz = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(m8, vx), _mm256_mul_ps(m9, vy)),
+            _mm256_add_ps(_mm256_mul_ps(m10, vz), m11));
+        _mm256_storeu_ps(out_z + i, rz);
+      }
+      _mm256_storeu_ps(out_x + i, rx);
+      _mm256_storeu_ps(out_y + i, ry);
+    }
+    _mm256_zeroupper();
+    return i;
+  }
+
+  MAPVIZ_TARGET_AVX
+  void TransformPointsAvx(
+      const double* m,
+      const tf::Point* in,
+      size_t in_stride,
+      size_t count,
+      tf::Point* out,
+      size_t out_stride)
+  {
+    // One point per iteration, with x, y, z and the unused w coordinate in
+    // the four lanes.
+    const __m256d c0 = _mm256_setr_pd(m[0], m[4], m[8], 0.0);
+    const __m256d c1 = _mm256_setr_pd(m[1], m[5], m[9], 0.0);
+    const __m256d c2 = _mm256_setr_pd(m[2], m[6], m[10], 0.0);
+    const __m256d t = _mm256_setr_pd(m[3], m[7], m[11], 0.0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const double* p = Coordinates(in, i, in_stride);
+      __m256d r = _mm256_add_pd(
+          _mm256_add_pd(_mm256_mul_pd(c0, _mm256_broadcast_sd(p)),
+                        _mm256_mul_pd(c1, _mm256_broadcast_sd(p + 1))),
+          _mm256_add_pd(_mm256_mul_pd(c2, _mm256_broadcast_sd(p + 2)), t));
+      _mm256_storeu_pd(Coordinates(out, i, out_stride), r);
+    }
+    _mm256_zeroupper();
+  }
+#endif  // MAPVIZ_HAS_AVX
+}  // namespace
+
+  PointTransformer::PointTransformer() :
+    has_local_transform_(false),
+    rigid_(false)
+  {
+    Initialize();
+  }
+
+  PointTransformer::PointTransformer(const swri_transform_util::Transform& transform) :
+    transform_(transform),
+    has_local_transform_(false),
+    rigid_(false)
+  {
+    Initialize();
+  }
+
+  PointTransformer::PointTransformer(
+      const swri_transform_util::Transform& transform,
+      const swri_transform_util::Transform& local_transform) :
+    transform_(transform),
+    local_transform_(local_transform),
+    has_local_transform_(true),
+    rigid_(false)
+  {
+    Initialize();
+  }
+
+  void PointTransformer::Initialize()
+  {
+    tf::Transform rigid(transform_.GetOrientation(), transform_.GetOrigin());
+    if (has_local_transform_)
+    {
+      rigid *= tf::Transform(local_transform_.GetOrientation(), local_transform_.GetOrigin());
+    }
+
+    const tf::Matrix3x3& basis = rigid.getBasis();
+    const tf::Vector3& origin = rigid.getOrigin();
+    for (int row = 0; row < 3; row++)
+    {
+      for (int col = 0; col < 3; col++)
+      {
+        matrix_d_[row * 4 + col] = basis[row][col];
+      }
+      matrix_d_[row * 4 + 3] = origin[row];
+    }
+    for (int i = 0; i < 12; i++)
+    {
+      matrix_f_[i] = static_cast<float>(matrix_d_[i]);
+    }
+
+    // Transforms between projections (e.g. UTM and WGS84) have an origin and
+    // orientation but aren't rigid, so check that the matrix reproduces the
+    // real transform away from the origin before relying on it.
+    rigid_ = true;
+    const tf::Point probes[] = {
+      tf::Point(100.0, 0.0, 0.0),
+      tf::Point(0.0, 100.0, 0.0),
+      tf::Point(0.0, 0.0, 100.0),
+      tf::Point(-37.0, 59.0, -13.0)};
+    for (const tf::Point& probe: probes)
+    {
+      tf::Point expected = has_local_transform_ ?
+          transform_ * (local_transform_ * probe) : transform_ * probe;
+      tf::Point actual = rigid * probe;
+      if ((expected - actual).length() > 1e-6 * (1.0 + expected.length()))
+      {
+        rigid_ = false;
+        break;
+      }
+    }
+  }
+
+  bool PointTransformer::GetGLMatrix(double matrix[16]) const
+  {
+    if (!rigid_)
+    {
+      return false;
+    }
+
+    // OpenGL matrices are column-major.  The z row is left at zero so that
+    // everything is projected onto the z = 0 plane, the same as drawing the
+    // x and y coordinates of the transformed points.
+    for (int col = 0; col < 4; col++)
+    {
+      matrix[col * 4] = matrix_d_[col];
+      matrix[col * 4 + 1] = matrix_d_[4 + col];
+      matrix[col * 4 + 2] = 0.0;
+      matrix[col * 4 + 3] = col == 3 ? 1.0 : 0.0;
+    }
+    return true;
+  }
+
+  tf::Point PointTransformer::operator*(const tf::Point& point) const
+  {
+    if (has_local_transform_)
+    {
+      return transform_ * (local_transform_ * point);
+    }
+    return transform_ * point;
+  }
+
+  bool PointTransformer::Equals(const PointTransformer& other) const
+  {
+    if (rigid_ != other.rigid_)
+    {
+      return false;
+    }
+
+    if (rigid_)
+    {
+      return std::equal(matrix_d_, matrix_d_ + 12, other.matrix_d_);
+    }
+
+    const tf::Point samples[] = {
+        tf::Point(0.0, 0.0, 0.0),
+        tf::Point(1.0, 0.0, 0.0),
+        tf::Point(0.0, 1.0, 0.0)};
+    for (int i = 0; i < 3; i++)
+    {
+      if (*this * samples[i] != other * samples[i])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  BoundingBox PointTransformer::TransformBounds(const BoundingBox& bounds) const
+  {
+    BoundingBox transformed;
+    if (bounds.Empty())
+    {
+      return transformed;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+      tf::Point corner(
+          (i & 1) ? bounds.MaxX() : bounds.MinX(),
+          (i & 2) ? bounds.MaxY() : bounds.MinY(),
+          (i & 4) ? bounds.MaxZ() : bounds.MinZ());
+      transformed.Add(*this * corner);
+    }
+    return transformed;
+  }
+
+  void PointTransformer::TransformXYZ(const float* in, size_t count, float* out) const
+  {
+    if (!rigid_)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        tf::Point p = *this * tf::Point(in[3 * i], in[3 * i + 1], in[3 * i + 2]);
+        out[3 * i] = p.x();
+        out[3 * i + 1] = p.y();
+        out[3 * i + 2] = p.z();
+      }
+      return;
+    }
+
+    const float* m = matrix_f_;
+#ifdef MAPVIZ_HAS_SSE2
+    const __m128 c0 = _mm_setr_ps(m[0], m[4], m[8], 0.0f);
+    const __m128 c1 = _mm_setr_ps(m[1], m[5], m[9], 0.0f);
+    const __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], 0.0f);
+    const __m128 t = _mm_setr_ps(m[3], m[7], m[11], 0.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+      const float* p = in + 3 * i;
+      __m128 r = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])), _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+          _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), t));
+      float* o = out + 3 * i;
+      _mm_storel_pi(reinterpret_cast<__m64*>(o), r);
+      _mm_store_ss(o + 2, _mm_movehl_ps(r, r));
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+      const float x = in[3 * i], y = in[3 * i + 1], z = in[3 * i + 2];
+      out[3 * i] = m[0] * x + m[1] * y + m[2] * z + m[3];
+      out[3 * i + 1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+      out[3 * i + 2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+    }
+#endif
+  }
+
+  void PointTransformer::TransformXYZToXY(const float* in, size_t count, float* out) const
+  {
+    if (!rigid_)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        tf::Point p = *this * tf::Point(in[3 * i], in[3 * i + 1], in[3 * i + 2]);
+        out[2 * i] = p.x();
+        out[2 * i + 1] = p.y();
+      }
+      return;
+    }
+
+    const float* m = matrix_f_;
+#ifdef MAPVIZ_HAS_SSE2
+    const __m128 c0 = _mm_setr_ps(m[0], m[4], 0.0f, 0.0f);
+    const __m128 c1 = _mm_setr_ps(m[1], m[5], 0.0f, 0.0f);
+    const __m128 c2 = _mm_setr_ps(m[2], m[6], 0.0f, 0.0f);
+    const __m128 t = _mm_setr_ps(m[3], m[7], 0.0f, 0.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+      const float* p = in + 3 * i;
+      __m128 r = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])), _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+          _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), t));
+      _mm_storel_pi(reinterpret_cast<__m64*>(out + 2 * i), r);
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+      const float x = in[3 * i], y = in[3 * i + 1], z = in[3 * i + 2];
+      out[2 * i] = m[0] * x + m[1] * y + m[2] * z + m[3];
+      out[2 * i + 1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+    }
+#endif
+  }
+
+  void PointTransformer::TransformXY(const float* in, size_t count, float* out) const
+  {
+    if (!rigid_)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        tf::Point p = *this * tf::Point(in[2 * i], in[2 * i + 1], 0.0);
+        out[2 * i] = p.x();
+        out[2 * i + 1] = p.y();
+      }
+      return;
+    }
+
+    const float* m = matrix_f_;
+    size_t i = 0;
+#ifdef MAPVIZ_HAS_AVX
+    if (CpuHasAvx())
+    {
+      i = TransformXYAvx(m, in, count, out);
+    }
+#endif
+#ifdef MAPVIZ_HAS_SSE2
+    // Two points per iteration
+    const __m128 cx = _mm_setr_ps(m[0], m[4], m[0], m[4]);
+    const __m128 cy = _mm_setr_ps(m[1], m[5], m[1], m[5]);
+    const __m128 t = _mm_setr_ps(m[3], m[7], m[3], m[7]);
+    for (; i + 2 <= count; i += 2)
+    {
+      __m128 v = _mm_loadu_ps(in + 2 * i);
+      __m128 r = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(cx, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0))),
+                     _mm_mul_ps(cy, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1)))),
+          t);
+      _mm_storeu_ps(out + 2 * i, r);
+    }
+#endif
+    for (; i < count; i++)
+    {
+      const float x = in[2 * i], y = in[2 * i + 1];
+      out[2 * i] = m[0] * x + m[1] * y + m[3];
+      out[2 * i + 1] = m[4] * x + m[5] * y + m[7];
+    }
+  }
+
+  void PointTransformer::Transform(
+      const float* x,
+      const float* y,
+      const float* z,
+      size_t count,
+      float* out_x,
+      float* out_y,
+      float* out_z) const
+  {
+    if (!rigid_)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        tf::Point p = *this * tf::Point(x[i], y[i], z ? z[i] : 0.0f);
+        out_x[i] = p.x();
+        out_y[i] = p.y();
+        if (out_z)
+        {
+          out_z[i] = p.z();
+        }
+      }
+      return;
+    }
+
+    const float* m = matrix_f_;
+    size_t i = 0;
+#ifdef MAPVIZ_HAS_AVX
+    if (CpuHasAvx())
+    {
+      i = TransformSoAAvx(m, x, y, z, count, out_x, out_y, out_z);
+    }
+#endif
+#ifdef MAPVIZ_HAS_SSE2
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+    const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+    const __m128 m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128 vx = _mm_loadu_ps(x + i);
+      __m128 vy = _mm_loadu_ps(y + i);
+      __m128 vz = z ? _mm_loadu_ps(z + i) : _mm_setzero_ps();
+
+      __m128 rx = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m1, vy)),
+          _mm_add_ps(_mm_mul_ps(m2, vz), m3));
+      __m128 ry = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(m4, vx), _mm_mul_ps(m5, vy)),
+          _mm_add_ps(_mm_mul_ps(m6, vz), m7));
+      if (out_z)
+      {
+        __m128 rz = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(m8, vx), _mm_mul_ps(m9, vy)),
+            _mm_add_ps(_mm_mul_ps(m10, vz), m11));
+        _mm_storeu_ps(out_z + i, rz);
+      }
+      _mm_storeu_ps(out_x + i, rx);
+      _mm_storeu_ps(out_y + i, ry);
+    }
+#endif
+    for (; i < count; i++)
+    {
+      const float px = x[i], py = y[i], pz = z ? z[i] : 0.0f;
+      out_x[i] = m[0] * px + m[1] * py + m[2] * pz + m[3];
+      out_y[i] = m[4] * px + m[5] * py + m[6] * pz + m[7];
+      if (out_z)
+      {
+        out_z[i] = m[8] * px + m[9] * py + m[10] * pz + m[11];
+      }
+    }
+  }
+
+  void PointTransformer::Transform(
+      const tf::Point* in,
+      size_t in_stride,
+      size_t count,
+      tf::Point* out,
+      size_t out_stride) const
+  {
+    if (!rigid_)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        const double* p = Coordinates(in, i, in_stride);
+        tf::Point result = *this * tf::Point(p[0], p[1], p[2]);
+        double* o = Coordinates(out, i, out_stride);
+        o[0] = result.x();
+        o[1] = result.y();
+        o[2] = result.z();
+      }
+      return;
+    }
+
+    const double* m = matrix_d_;
+#ifdef MAPVIZ_HAS_AVX
+    if (CpuHasAvx())
+    {
+      TransformPointsAvx(m, in, in_stride, count, out, out_stride);
+      return;
+    }
+#endif
+#ifdef MAPVIZ_HAS_SSE2
+    // The x and y coordinates go in one register and z and w in another.
+    const __m128d c0xy = _mm_setr_pd(m[0], m[4]), c0zw = _mm_setr_pd(m[8], 0.0);
+    const __m128d c1xy = _mm_setr_pd(m[1], m[5]), c1zw = _mm_setr_pd(m[9], 0.0);
+    const __m128d c2xy = _mm_setr_pd(m[2], m[6]), c2zw = _mm_setr_pd(m[10], 0.0);
+    const __m128d txy = _mm_setr_pd(m[3], m[7]), tzw = _mm_setr_pd(m[11], 0.0);
+    for (size_t i = 0; i < count; i++)
+    {
+      const double* p = Coordinates(in, i, in_stride);
+      __m128d x = _mm_set1_pd(p[0]);
+      __m128d y = _mm_set1_pd(p[1]);
+      __m128d z = _mm_set1_pd(p[2]);
+      __m128d rxy = _mm_add_pd(
+          _mm_add_pd(_mm_mul_pd(c0xy, x), _mm_mul_pd(c1xy, y)),
+          _mm_add_pd(_mm_mul_pd(c2xy, z), txy));
+      __m128d rzw = _mm_add_pd(
+          _mm_add_pd(_mm_mul_pd(c0zw, x), _mm_mul_pd(c1zw, y)),
+          _mm_add_pd(_mm_mul_pd(c2zw, z), tzw));
+      double* o = Coordinates(out, i, out_stride);
+      _mm_storeu_pd(o, rxy);
+      _mm_storeu_pd(o + 2, rzw);
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+      const double* p = Coordinates(in, i, in_stride);
+      const double x = p[0], y = p[1], z = p[2];
+      double* o = Coordinates(out, i, out_stride);
+      o[0] = m[0] * x + m[1] * y + m[2] * z + m[3];
+      o[1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+      o[2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+    }
+#endif
+  }
+}  // namespace mapviz
@@ -0,0 +1,332 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <mapviz/render_batch.h>
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// QT libraries
+#include <QGLContext>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace mapviz
+{
+namespace
+{
+  uint8_t ToByte(float value)
+  {
+    return static_cast<uint8_t>(std::floor(std::max(0.0f, std::min(value, 1.0f)) * 255.0f + 0.5f));
+  }
+
+  GLenum ToGLMode(RenderBatch::Primitive primitive)
+  {
+    switch (primitive)
+    {
+      case RenderBatch::LINES:
+        return GL_LINES;
+      case RenderBatch::LINE_STRIP:
+        return GL_LINE_STRIP;
+      case RenderBatch::TRIANGLES:
+        return GL_TRIANGLES;
+      case RenderBatch::QUADS:
+        return GL_QUADS;
+      case RenderBatch::POINTS:
+      default:
+        return GL_POINTS;
+    }
+  }
+
+  // Buffers of batches that were destroyed without their context current,
+  // waiting for DeleteReleasedBuffers() to be called in that context.
+  struct ReleasedBuffer
+  {
+    const QGLContext* context;
+    GLuint id;
+  };
+
+  QMutex released_buffers_mutex;
+  std::vector<ReleasedBuffer> released_buffers;
+}  // namespace
+
+  RenderBatch::RenderBatch(Primitive primitive) :
+    primitive_(primitive),
+    size_(1.0f),
+    texture_(0),
+    has_tex_coords_(false),
+    context_(NULL)
+  {
+    color_[0] = 255;
+    color_[1] = 255;
+    color_[2] = 255;
+    color_[3] = 255;
+    tex_coord_[0] = 0.0f;
+    tex_coord_[1] = 0.0f;
+  }
+
+  RenderBatch::~RenderBatch()
+  {
+    const bool context_current = context_ != NULL && context_ == QGLContext::currentContext();
+
+    GLuint ids[] = {position_buffer_.id, color_buffer_.id, tex_coord_buffer_.id};
+    for (GLuint id: ids)
+    {
+      if (id == 0)
+      {
+        continue;
+      }
+
+      if (context_current)
+      {
+        glDeleteBuffers(1, &id);
+      }
+      else
+      {
+        QMutexLocker locker(&released_buffers_mutex);
+        ReleasedBuffer buffer = {context_, id};
+        released_buffers.push_back(buffer);
+      }
+    }
+  }
+
+  void RenderBatch::DeleteReleasedBuffers()
+  {
+    const QGLContext* context = QGLContext::currentContext();
+    if (context == NULL)
+    {
+      return;
+    }
+
+    QMutexLocker locker(&released_buffers_mutex);
+    std::vector<ReleasedBuffer>::iterator end = std::remove_if(
+        released_buffers.begin(), released_buffers.end(),
+        [context](const ReleasedBuffer& buffer)
+        {
+          if (buffer.context != context)
+          {
+            return false;
+          }
+          glDeleteBuffers(1, &buffer.id);
+          return true;
+        });
+    released_buffers.erase(end, released_buffers.end());
+  }
+
+  void RenderBatch::Clear()
+  {
+    positions_.clear();
+    colors_.clear();
+    tex_coords_.clear();
+    has_tex_coords_ = false;
+    bounds_ = BoundingBox();
+
+    position_buffer_.dirty = true;
+    color_buffer_.dirty = true;
+    tex_coord_buffer_.dirty = true;
+  }
+
+  void RenderBatch::Reserve(size_t count)
+  {
+    positions_.reserve(count * 3);
+    colors_.reserve(count * 4);
+  }
+
+  void RenderBatch::SetColor(const QColor& color)
+  {
+    color_[0] = static_cast<uint8_t>(color.red());
+    color_[1] = static_cast<uint8_t>(color.green());
+    color_[2] = static_cast<uint8_t>(color.blue());
+    color_[3] = static_cast<uint8_t>(color.alpha());
+  }
+
+  void RenderBatch::SetColor(float red, float green, float blue, float alpha)
+  {
+    color_[0] = ToByte(red);
+    color_[1] = ToByte(green);
+    color_[2] = ToByte(blue);
+    color_[3] = ToByte(alpha);
+  }
+
+  void RenderBatch::SetTexCoord(float u, float v)
+  {
+    if (!has_tex_coords_)
+    {
+      // Vertices that were added before the first texture coordinate was set
+      // get (0, 0).
+      tex_coords_.assign(Size() * 2, 0.0f);
+      has_tex_coords_ = true;
+    }
+
+    tex_coord_[0] = u;
+    tex_coord_[1] = v;
+  }
+
+  void RenderBatch::AddVertex(double x, double y, double z)
+  {
+    positions_.push_back(static_cast<float>(x));
+    positions_.push_back(static_cast<float>(y));
+    positions_.push_back(static_cast<float>(z));
+    bounds_.Add(x, y, z);
+    colors_.insert(colors_.end(), color_, color_ + 4);
+    position_buffer_.dirty = true;
+    color_buffer_.dirty = true;
+
+    if (has_tex_coords_)
+    {
+      tex_coords_.insert(tex_coords_.end(), tex_coord_, tex_coord_ + 2);
+      tex_coord_buffer_.dirty = true;
+    }
+  }
+
+  void RenderBatch::SetVertexColor(size_t index, const QColor& color)
+  {
+    uint8_t* dst = &colors_[index * 4];
+    dst[0] = static_cast<uint8_t>(color.red());
+    dst[1] = static_cast<uint8_t>(color.green());
+    dst[2] = static_cast<uint8_t>(color.blue());
+    dst[3] = static_cast<uint8_t>(color.alpha());
+    color_buffer_.dirty = true;
+  }
+
+  template <class T>
+  void RenderBatch::Upload(Buffer& buffer, const std::vector<T>& data)
+  {
+    if (buffer.id == 0)
+    {
+      glGenBuffers(1, &buffer.id);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+
+    // Only reallocate the buffer if the amount of data changed.
+    size_t size = data.size() * sizeof(T);
+    if (size != buffer.size)
+    {
+      glBufferData(GL_ARRAY_BUFFER, size, data.data(), GL_DYNAMIC_DRAW);
+      buffer.size = size;
+    }
+    else
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, size, data.data());
+    }
+
+    buffer.dirty = false;
+  }
+
+  void RenderBatch::Draw()
+  {
+    if (positions_.empty())
+    {
+      return;
+    }
+
+    if (context_ == NULL)
+    {
+      context_ = QGLContext::currentContext();
+    }
+
+    const bool textured = texture_ != 0 && has_tex_coords_;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    if (position_buffer_.dirty)
+    {
+      Upload(position_buffer_, positions_);
+    }
+    else
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, position_buffer_.id);
+    }
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+
+    if (color_buffer_.dirty)
+    {
+      Upload(color_buffer_, colors_);
+    }
+    else
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, color_buffer_.id);
+    }
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+
+    if (textured)
+    {
+      if (tex_coord_buffer_.dirty)
+      {
+        Upload(tex_coord_buffer_, tex_coords_);
+      }
+      else
+      {
+        glBindBuffer(GL_ARRAY_BUFFER, tex_coord_buffer_.id);
+      }
+      glTexCoordPointer(2, GL_FLOAT, 0, 0);
+
+      glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+      glEnable(GL_TEXTURE_2D);
+      glBindTexture(GL_TEXTURE_2D, texture_);
+    }
+
+    if (primitive_ == POINTS)
+    {
+      glPointSize(size_);
+    }
+    else if (primitive_ == LINES || primitive_ == LINE_STRIP)
+    {
+      glLineWidth(size_);
+    }
+
+    glDrawArrays(ToGLMode(primitive_), 0, static_cast<GLsizei>(Size()));
+
+    if (textured)
+    {
+      glBindTexture(GL_TEXTURE_2D, 0);
+      glDisable(GL_TEXTURE_2D);
+      glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    }
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  MemoryStats RenderBatch::MemoryUsage() const
+  {
+    return MemoryStats(
+        HeapBytes(positions_) + HeapBytes(colors_) + HeapBytes(tex_coords_),
+        position_buffer_.size + color_buffer_.size + tex_coord_buffer_.size);
+  }
+}
@@ -0,0 +1,271 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <mapviz/render_cache.h>
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+
+namespace mapviz
+{
+  const int RenderCache::MARGIN = 128;
+
+  RenderCache::RenderCache(bool multisample) :
+    multisample_(multisample),
+    valid_(false),
+    previous_framebuffer_(0)
+  {
+  }
+
+  RenderCache::~RenderCache()
+  {
+  }
+
+  bool RenderCache::IsSupported()
+  {
+    // glBlendFuncSeparate() is needed to render with premultiplied alpha.
+    return QGLFramebufferObject::hasOpenGLFramebufferObjects() && GLEW_VERSION_1_4;
+  }
+
+  bool RenderCache::Reusable(
+      const double modelview[16],
+      const double projection[16],
+      const int viewport[4],
+      double* offset_x,
+      double* offset_y) const
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      if (viewport[i] != viewport_[i])
+      {
+        return false;
+      }
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+      if (projection[i] != projection_[i])
+      {
+        return false;
+      }
+    }
+
+    // Only the translation of the view may have changed.
+    const int linear[] = {0, 1, 4, 5};
+    for (int i = 0; i < 4; i++)
+    {
+      if (std::fabs(modelview[linear[i]] - modelview_[linear[i]]) > 1e-9)
+      {
+        return false;
+      }
+    }
+
+    // Convert the translation to normalized device coordinates, where the
+    // view spans -1 to 1.
+    const double dx = modelview[12] - modelview_[12];
+    const double dy = modelview[13] - modelview_[13];
+    *offset_x = projection[0] * dx + projection[4] * dy;
+    *offset_y = projection[1] * dx + projection[5] * dy;
+
+    return std::fabs(*offset_x) <= 2.0 * MARGIN / viewport[2] &&
+           std::fabs(*offset_y) <= 2.0 * MARGIN / viewport[3];
+  }
+
+  bool RenderCache::Draw()
+  {
+    if (!valid_ || !texture_buffer_)
+    {
+      return false;
+    }
+
+    double modelview[16];
+    double projection[16];
+    int viewport[4];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    double offset_x = 0;
+    double offset_y = 0;
+    if (!Reusable(modelview, projection, viewport, &offset_x, &offset_y))
+    {
+      return false;
+    }
+
+    // Size of the cached image relative to the view
+    const double size_x = static_cast<double>(texture_buffer_->width()) / viewport[2];
+    const double size_y = static_cast<double>(texture_buffer_->height()) / viewport[3];
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture_buffer_->texture());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+    // The cached image has premultiplied alpha.
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBegin(GL_QUADS);
+    glTexCoord2d(0, 0);
+    glVertex2d(offset_x - size_x, offset_y - size_y);
+    glTexCoord2d(1, 0);
+    glVertex2d(offset_x + size_x, offset_y - size_y);
+    glTexCoord2d(1, 1);
+    glVertex2d(offset_x + size_x, offset_y + size_y);
+    glTexCoord2d(0, 1);
+    glVertex2d(offset_x - size_x, offset_y + size_y);
+    glEnd();
+
+    glPopAttrib();
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    return true;
+  }
+
+  bool RenderCache::BeginRender()
+  {
+    valid_ = false;
+
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelview_);
+    glGetDoublev(GL_PROJECTION_MATRIX, projection_);
+    glGetIntegerv(GL_VIEWPORT, viewport_);
+
+    const int width = viewport_[2] + 2 * MARGIN;
+    const int height = viewport_[3] + 2 * MARGIN;
+
+    if (!texture_buffer_ || texture_buffer_->width() != width || texture_buffer_->height() != height)
+    {
+      render_buffer_.reset();
+      texture_buffer_.reset(new QGLFramebufferObject(width, height));
+      if (!texture_buffer_->isValid())
+      {
+        texture_buffer_.reset();
+        return false;
+      }
+
+      // Multisampled buffers can't be used as a texture, so render into one
+      // and copy the result into the texture afterwards.
+      if (multisample_ && QGLFramebufferObject::hasOpenGLFramebufferBlit())
+      {
+        QGLFramebufferObjectFormat format;
+        format.setSamples(4);
+        render_buffer_.reset(new QGLFramebufferObject(width, height, format));
+        if (!render_buffer_->isValid())
+        {
+          render_buffer_.reset();
+        }
+      }
+    }
+
+    // Releasing a framebuffer object binds the window's framebuffer, which
+    // isn't what the canvas was drawing into if it's rendering offscreen.
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer_);
+
+    QGLFramebufferObject* target = render_buffer_ ? render_buffer_.get() : texture_buffer_.get();
+    if (!target->bind())
+    {
+      return false;
+    }
+
+    glPushAttrib(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT);
+    glViewport(0, 0, width, height);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Keep the scale of the view and extend it by the margin.
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glScaled(static_cast<double>(viewport_[2]) / width, static_cast<double>(viewport_[3]) / height, 1.0);
+    glMultMatrixd(projection_);
+    glMatrixMode(GL_MODELVIEW);
+
+    // Blending into a transparent image has to produce premultiplied alpha
+    // for the image to look the same as drawing directly onto the canvas.
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    return true;
+  }
+
+  void RenderCache::EndRender()
+  {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+
+    if (render_buffer_)
+    {
+      render_buffer_->release();
+      QRect rect(0, 0, render_buffer_->width(), render_buffer_->height());
+      QGLFramebufferObject::blitFramebuffer(texture_buffer_.get(), rect, render_buffer_.get(), rect);
+    }
+    else
+    {
+      texture_buffer_->release();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer_);
+
+    valid_ = true;
+  }
+
+  MemoryStats RenderCache::MemoryUsage() const
+  {
+    MemoryStats usage;
+    if (texture_buffer_)
+    {
+      usage.gpu_bytes += static_cast<size_t>(texture_buffer_->width()) * texture_buffer_->height() * 4;
+    }
+    if (render_buffer_)
+    {
+      usage.gpu_bytes += static_cast<size_t>(render_buffer_->width()) * render_buffer_->height() *
+          4 * std::max(1, render_buffer_->format().samples());
+    }
+    return usage;
+  }
+}
@@ -0,0 +1,198 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#include <mapviz/trace.h>
+
+// C++ standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+namespace mapviz
+{
+namespace
+{
+  // Number of events kept in the ring buffer
+  const size_t MAX_EVENTS = 1 << 16;
+
+  struct TraceEvent
+  {
+    const char* category;
+    std::string name;
+    int64_t start;
+    int64_t duration;
+    int thread;
+  };
+
+  struct TraceBuffer
+  {
+    TraceBuffer() : next(0), size(0) {}
+
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    size_t next;
+    size_t size;
+  };
+
+  TraceBuffer& Buffer()
+  {
+    static TraceBuffer buffer;
+    return buffer;
+  }
+
+  // Small sequential thread ids are easier to read in the trace viewer than
+  // the system's thread ids.
+  int ThreadId()
+  {
+    static std::atomic<int> next_id(1);
+    thread_local int id = next_id++;
+    return id;
+  }
+
+  void WriteEscaped(FILE* file, const std::string& text)
+  {
+    for (size_t i = 0; i < text.size(); i++)
+    {
+      char c = text[i];
+      if (c == '"' || c == '\\')
+      {
+        fprintf(file, "\\%c", c);
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        fprintf(file, "\\u%04x", c);
+      }
+      else
+      {
+        fputc(c, file);
+      }
+    }
+  }
+}
+
+  std::atomic<bool> Tracer::enabled_(false);
+
+  void Tracer::SetEnabled(bool enabled)
+  {
+    if (enabled)
+    {
+      // Allocate the buffer up front instead of while recording.
+      TraceBuffer& buffer = Buffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      buffer.events.resize(MAX_EVENTS);
+    }
+    enabled_ = enabled;
+  }
+
+  void Tracer::Record(
+      const char* category,
+      const std::string& name,
+      int64_t start_usec,
+      int64_t duration_usec)
+  {
+    int thread = ThreadId();
+
+    TraceBuffer& buffer = Buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.empty())
+    {
+      return;
+    }
+
+    TraceEvent& event = buffer.events[buffer.next];
+    event.category = category;
+    event.name = name;
+    event.start = start_usec;
+    event.duration = duration_usec;
+    event.thread = thread;
+
+    buffer.next = (buffer.next + 1) % buffer.events.size();
+    buffer.size = std::min(buffer.size + 1, buffer.events.size());
+  }
+
+  bool Tracer::Save(const std::string& filename)
+  {
+    // Copy the events so that recording isn't blocked while writing.
+    std::vector<TraceEvent> events;
+    {
+      TraceBuffer& buffer = Buffer();
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      events.reserve(buffer.size);
+      size_t first = (buffer.next + buffer.events.size() - buffer.size) % std::max<size_t>(1, buffer.events.size());
+      for (size_t i = 0; i < buffer.size; i++)
+      {
+        events.push_back(buffer.events[(first + i) % buffer.events.size()]);
+      }
+    }
+
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file)
+    {
+      return false;
+    }
+
+    const int pid = static_cast<int>(getpid());
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"mapviz\"}}", pid);
+    for (size_t i = 0; i < events.size(); i++)
+    {
+      const TraceEvent& event = events[i];
+      fprintf(file, ",\n{\"name\":\"");
+      WriteEscaped(file, event.name);
+      fprintf(file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d}",
+              event.category,
+              static_cast<long long>(event.start),
+              static_cast<long long>(event.duration),
+              pid,
+              event.thread);
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+  }
+
+  void Tracer::Clear()
+  {
+    TraceBuffer& buffer = Buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.next = 0;
+    buffer.size = 0;
+  }
+
+  int64_t Tracer::Now()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
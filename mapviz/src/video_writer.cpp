@@ -28,6 +28,7 @@
 // *****************************************************************************
 
 #include <mapviz/video_writer.h>
+#include <mapviz/trace.h>
 
 #include <ros/ros.h>
 
@@ -68,6 +69,7 @@ namespace mapviz
 
   void VideoWriter::processFrame(QImage frame)
   {
+    TraceScope trace("video", "Process frame");
     try
     {
       ROS_DEBUG_THROTTLE(1.0, "VideoWriter::processFrame()");
@@ -81,20 +83,10 @@ namespace mapviz
       }
 
       cv::Mat image;
-      cv::Mat temp_image;
-      switch (frame.format())
+      if (!ConvertFrame(frame, image))
       {
-        case QImage::Format_ARGB32:
-          // The image received should have its format set to ARGB32, but it's
-          // actually BGRA.  Need to convert it to BGR and flip it vertically
-          // before giving it to the cv::VideoWriter.
-          image = cv::Mat(frame.height(), frame.width(), CV_8UC4, frame.bits());
-          cv::cvtColor(image, temp_image, cv::COLOR_BGRA2BGR);
-          cv::flip(temp_image, image, 0);
-          break;
-        default:
-          ROS_WARN_THROTTLE(1.0, "Unexpected image format: %d", frame.format());
-          return;
+        ROS_WARN_THROTTLE(1.0, "Unexpected image format: %d", frame.format());
+        return;
       }
 
       {
@@ -112,6 +104,26 @@ namespace mapviz
     }
   }
 
+  bool VideoWriter::ConvertFrame(QImage& frame, cv::Mat& image)
+  {
+    switch (frame.format())
+    {
+      case QImage::Format_ARGB32:
+      {
+        // The image received should have its format set to ARGB32, but it's
+        // actually BGRA.  Need to convert it to BGR and flip it vertically
+        // before giving it to the cv::VideoWriter.
+        cv::Mat bgra(frame.height(), frame.width(), CV_8UC4, frame.bits(), frame.bytesPerLine());
+        cv::Mat temp_image;
+        cv::cvtColor(bgra, temp_image, cv::COLOR_BGRA2BGR);
+        cv::flip(temp_image, image, 0);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
   void VideoWriter::stop()
   {
     ROS_INFO("Stopping video recording.");
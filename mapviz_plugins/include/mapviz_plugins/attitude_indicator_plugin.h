@@ -88,8 +88,6 @@ class AttitudeIndicatorPlugin : public mapviz::MapvizPlugin
   void drawBackground();
   void drawBall();
   void drawPanel();
-  
-  void timerEvent(QTimerEvent *);
 
  protected Q_SLOTS:
    void SelectTopic();
@@ -90,6 +90,17 @@ namespace mapviz_plugins
 
     QWidget* GetConfigWidget(QWidget* parent);
 
+    /**
+     * Maps a 32FC1 disparity image onto the jet color map, scaled so that
+     * min_disparity and max_disparity are the ends of the map, and stores
+     * the result in color as BGR.
+     */
+    static void ColorizeDisparity(
+        const cv::Mat& disparity,
+        float min_disparity,
+        float max_disparity,
+        cv::Mat_<cv::Vec3b>& color);
+
   protected:
     void PrintError(const std::string& message);
     void PrintInfo(const std::string& message);
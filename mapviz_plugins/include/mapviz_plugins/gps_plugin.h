@@ -62,6 +62,11 @@ namespace mapviz_plugins
 
     void Draw(double x, double y, double scale);
 
+    bool SupportsConflate()
+    {
+      return true;
+    }
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
@@ -75,6 +80,7 @@ namespace mapviz_plugins
    protected Q_SLOTS:
     void SelectTopic();
     void TopicEdited();
+    void Resubscribe();
 
    private:
     Ui::gps_config ui_;
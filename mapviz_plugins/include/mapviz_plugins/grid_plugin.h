@@ -35,6 +35,7 @@
 #include <list>
 
 #include <mapviz/mapviz_plugin.h>
+#include <mapviz/render_batch.h>
 
 // QT libraries
 #include <QGLWidget>
@@ -68,6 +69,11 @@ namespace mapviz_plugins
 
     void Transform();
 
+    bool SupportsRenderCache()
+    {
+      return true;
+    }
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
@@ -114,8 +120,17 @@ namespace mapviz_plugins
     std::list<tf::Point> transformed_right_points_;
 
     swri_transform_util::Transform transform_;
+    mapviz::PointTransformer transformer_;
+
+    mapviz::RenderBatch lines_;
+    QColor lines_color_;
+    bool lines_dirty_;
+    // True if the lines are in the grid frame and the transform is applied
+    // by OpenGL
+    bool lines_in_source_frame_;
 
     void RecalculateGrid();
+    void UpdateLines(const QColor& color);
     void Transform(std::list<tf::Point>& src, std::list<tf::Point>& dst);
   };
 }
@@ -89,6 +89,8 @@ namespace mapviz_plugins
 
     void Transform() {}
 
+    mapviz::MemoryStats MemoryUsage();
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
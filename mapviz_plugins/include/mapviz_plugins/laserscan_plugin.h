@@ -36,10 +36,12 @@
 #include <vector>
 
 #include <mapviz/mapviz_plugin.h>
+#include <mapviz/render_batch.h>
 
 // QT libraries
 #include <QGLWidget>
 #include <QColor>
+#include <QMutex>
 
 // ROS libraries
 #include <sensor_msgs/LaserScan.h>
@@ -77,11 +79,58 @@ namespace mapviz_plugins
 
       void Transform();
 
+      bool SupportsAsyncCallbacks()
+      {
+        return true;
+      }
+
+      bool SupportsConflate()
+      {
+        return true;
+      }
+
+      size_t BufferedElements();
+
+      mapviz::MemoryStats MemoryUsage();
+
       void LoadConfig(const YAML::Node& node, const std::string& path);
       void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
       QWidget* GetConfigWidget(QWidget* parent);
 
+      struct StampedPoint
+      {
+        tf::Point point;
+        // Only computed if the transform can't be applied by OpenGL or the
+        // points are colored by their transformed z coordinate
+        tf::Point transformed_point;
+        QColor color;
+        float range;
+        float intensity;
+      };
+
+      /**
+       * Fills cos_table and sin_table with the cosine and sine of the angle of
+       * each of the count beams of a scan.
+       */
+      static void ComputeTrigTables(
+          float angle_min,
+          float angle_increment,
+          size_t count,
+          std::vector<double>& cos_table,
+          std::vector<double>& sin_table);
+
+      /**
+       * Converts the ranges of a scan that are within its limits to points,
+       * using tables computed by ComputeTrigTables().  The points are
+       * appended to points.
+       */
+      static void ConvertRanges(
+          const sensor_msgs::LaserScan& msg,
+          const std::vector<double>& cos_table,
+          const std::vector<double>& sin_table,
+          std::vector<StampedPoint>& points);
+
     protected:
       void PrintError(const std::string& message);
       void PrintInfo(const std::string& message);
@@ -90,6 +139,7 @@ namespace mapviz_plugins
     protected Q_SLOTS:
       void SelectTopic();
       void TopicEdited();
+      void Resubscribe();
       void AlphaEdited(double val);
       void ColorTransformerChanged(int index);
       void MinValueChanged(double value);
@@ -100,17 +150,9 @@ namespace mapviz_plugins
       void UpdateColors();    
       void DrawIcon();
       void ResetTransformedScans();
+      void ProcessPendingScans();
 
     private:
-      struct StampedPoint
-      {
-        tf::Point point;
-        tf::Point transformed_point;
-        QColor color;
-        float range;
-        float intensity;
-      };
-
       struct Scan
       {
         ros::Time stamp;
@@ -118,12 +160,29 @@ namespace mapviz_plugins
         std::vector<StampedPoint> points;
         std::string source_frame_;
         bool transformed;
+        // Transform from the source frame to the target frame
+        mapviz::PointTransformer transformer;
+        mapviz::RenderBatchPtr batch;
         bool has_intensity;
       };
 
+      // The color settings from the config widget
+      struct ColorSettings
+      {
+        int color_transformer;
+        bool use_rainbow;
+        QColor min_color;
+        QColor max_color;
+      };
+
       void laserScanCallback(const sensor_msgs::LaserScanConstPtr& scan);
       QColor CalculateColor(const StampedPoint& point, bool has_intensity);
+      void UpdateBatch(Scan& scan);
+      void UpdateBatchColors(Scan& scan);
+      void UpdateColorSettings();
+      void ColorScans();
       void updatePreComputedTriginometic(const sensor_msgs::LaserScanConstPtr& msg);
+      static mapviz::MemoryStats ScanMemoryUsage(const Scan& scan);
 
       Ui::laserscan_config ui_;
       QWidget* config_widget_;
@@ -135,6 +194,11 @@ namespace mapviz_plugins
       size_t point_size_;
       size_t buffer_size_;
 
+      // Scans are colored in Transform(), which runs off the GUI thread, so
+      // the color settings are copied from the widgets on the GUI thread
+      // whenever they change.
+      ColorSettings color_settings_;
+
       bool has_message_;
 
       // Use a list instead of a deque for scans to facilitate removing
@@ -142,6 +206,12 @@ namespace mapviz_plugins
       // decay time (evenator)
       std::deque<Scan> scans_;
       ros::Subscriber laserscan_sub_;
+
+      // Scans that have been decoded by the callback thread but not yet
+      // picked up by the GUI thread.
+      std::deque<Scan> pending_scans_;
+      QMutex pending_mutex_;
+
       std::vector<double> precomputed_cos_;
       std::vector<double> precomputed_sin_;
       size_t prev_ranges_size_;
@@ -35,6 +35,7 @@
 #include <unordered_map>
 
 #include <mapviz/mapviz_plugin.h>
+#include <mapviz/render_batch.h>
 
 // QT libraries
 #include <QGLWidget>
@@ -97,6 +98,10 @@ namespace mapviz_plugins
       return true;
     }
 
+    size_t BufferedElements();
+
+    mapviz::MemoryStats MemoryUsage();
+
   protected:
     void PrintError(const std::string& message);
     void PrintInfo(const std::string& message);
@@ -148,6 +153,18 @@ namespace mapviz_plugins
       swri_transform_util::Transform local_transform;
       
       bool transformed;
+
+      // Transform from the marker's pose to the target frame
+      mapviz::PointTransformer transformer;
+
+      // Vertices of the marker, relative to its pose if the transform is
+      // applied by OpenGL and in the target frame otherwise
+      mapviz::RenderBatchPtr batch;
+      bool batch_in_source_frame;
+      bool batch_dirty;
+
+      // Bounds of the marker in the target frame
+      mapviz::BoundingBox bounds;
     };
 
     Ui::marker_config ui_;
@@ -167,6 +184,7 @@ namespace mapviz_plugins
     void handleMarkerArray(const visualization_msgs::MarkerArray &markers);
     void transformArrow(MarkerData& markerData,
                         const swri_transform_util::Transform& transform);
+    void UpdateBatch(MarkerData& marker, bool source_frame);
   };
 }
 
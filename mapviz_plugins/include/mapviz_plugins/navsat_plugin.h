@@ -59,6 +59,11 @@ namespace mapviz_plugins
 
     void Draw(double x, double y, double scale);
 
+    bool SupportsConflate()
+    {
+      return true;
+    }
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
@@ -72,6 +77,7 @@ namespace mapviz_plugins
    protected Q_SLOTS:
     void SelectTopic();
     void TopicEdited();
+    void Resubscribe();
 
    private:
     Ui::navsat_config ui_;
@@ -82,7 +88,7 @@ namespace mapviz_plugins
     ros::Subscriber navsat_sub_;
     bool has_message_;
 
-    void NavSatFixCallback(const sensor_msgs::NavSatFixConstPtr navsat);
+    void NavSatFixCallback(const sensor_msgs::NavSatFixConstPtr& navsat);
   };
 }
 
@@ -59,9 +59,9 @@ namespace mapviz_plugins
   {
     Q_OBJECT
 
+  public:
     typedef std::array<uchar, 256*4> Palette;
 
-  public:
     OccupancyGridPlugin();
     virtual ~OccupancyGridPlugin();
 
@@ -72,11 +72,34 @@ namespace mapviz_plugins
 
     void Transform();
 
+    bool SupportsRenderCache()
+    {
+      return true;
+    }
+
+    mapviz::MemoryStats MemoryUsage();
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
     QWidget* GetConfigWidget(QWidget* parent);
 
+    /**
+     * Copies a width x height block of occupancy values from src into raw
+     * and writes their RGBA palette colors into color.  src_stride and
+     * dst_stride are the lengths of the rows of the source and destination
+     * in cells.
+     */
+    static void ColorizeCells(
+        const int8_t* src,
+        size_t width,
+        size_t height,
+        size_t src_stride,
+        size_t dst_stride,
+        const Palette& palette,
+        uchar* raw,
+        uchar* color);
+
   protected:
     void PrintError(const std::string& message);
     void PrintInfo(const std::string& message);
@@ -98,6 +121,8 @@ namespace mapviz_plugins
     QWidget* config_widget_;
 
     nav_msgs::OccupancyGridConstPtr grid_;
+    // Stamp of the newest grid or update applied to the texture
+    ros::Time grid_stamp_;
 
     ros::Subscriber grid_sub_;
     ros::Subscriber update_sub_;
@@ -69,6 +69,12 @@ namespace mapviz_plugins
 
     void Paint(QPainter* painter, double x, double y, double scale);
     void Draw(double x, double y, double scale);
+
+    bool SupportsConflate()
+    {
+      return true;
+    }
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
@@ -87,6 +93,7 @@ namespace mapviz_plugins
    protected Q_SLOTS:
     void SelectTopic();
     void TopicEdited();
+    void Resubscribe();
     
 
    private:
@@ -96,7 +103,7 @@ namespace mapviz_plugins
     std::string topic_;
     ros::Subscriber odometry_sub_;
     bool has_message_;
-    void odometryCallback(const nav_msgs::OdometryConstPtr odometry);
+    void odometryCallback(const nav_msgs::OdometryConstPtr& odometry);
   };
 }
 
@@ -36,6 +36,7 @@
 
 #include <mapviz/mapviz_plugin.h>
 #include <mapviz/map_canvas.h>
+#include <mapviz/render_batch.h>
 
 // QT libraries
 #include <QGLWidget>
@@ -87,6 +88,9 @@ namespace mapviz_plugins
 
     virtual void Transform();
     virtual bool DrawPoints(double scale);
+
+    size_t BufferedElements() { return points_.size(); }
+    mapviz::MemoryStats MemoryUsage();
     virtual bool DrawArrows();
     virtual bool DrawArrow(const StampedPoint& point);
     virtual bool DrawLaps();
@@ -134,6 +138,11 @@ namespace mapviz_plugins
     double scale_;
     bool static_arrow_sizes_;
 
+    // Current points or arrows
+    mapviz::RenderBatch batch_;
+
+    bool AddArrow(const StampedPoint& point);
+
    private:
     std::vector<std::deque<StampedPoint> > laps_;
     bool got_begin_;
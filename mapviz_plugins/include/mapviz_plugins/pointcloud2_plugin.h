@@ -38,7 +38,10 @@
 
 #include <mapviz/mapviz_plugin.h>
 
+#include <boost/shared_ptr.hpp>
+
 // QT libraries
+#include <QGLShaderProgram>
 #include <QGLWidget>
 #include <QColor>
 #include <QMutex>
@@ -82,11 +85,106 @@ namespace mapviz_plugins
 
     void Transform();
 
+    bool SupportsAsyncCallbacks()
+    {
+      return true;
+    }
+
+    bool SupportsConflate()
+    {
+      return true;
+    }
+
+    size_t BufferedElements();
+
+    mapviz::MemoryStats MemoryUsage();
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
     QWidget* GetConfigWidget(QWidget* parent);
 
+    /**
+     * Reads the field described by feature_info from the point at data and
+     * converts it to a float.
+     */
+    static float PointFeature(const uint8_t* data, const FieldInfo& feature_info);
+
+    /**
+     * Decodes the x, y and z fields of num_points points into interleaved
+     * coordinates and returns a box that contains them.  Large clouds are
+     * decoded in parallel.
+     */
+    static mapviz::BoundingBox DecodePositions(
+        const uint8_t* data,
+        size_t num_points,
+        uint32_t point_step,
+        const FieldInfo& x,
+        const FieldInfo& y,
+        const FieldInfo& z,
+        float* positions);
+
+    /**
+     * Decodes one field of num_points points to floats.  Large clouds are
+     * decoded in parallel.
+     */
+    static void DecodeField(
+        const uint8_t* data,
+        size_t num_points,
+        uint32_t point_step,
+        const FieldInfo& field,
+        float* values);
+
+    /**
+     * The extent of the values of a field and a histogram of them over that
+     * extent, which is used to estimate percentiles.  NaNs and infinities are
+     * ignored.
+     */
+    struct ValueSummary
+    {
+      ValueSummary();
+
+      /**
+       * Adds the values summarized by other.  If the extents differ, both
+       * histograms are rebinned to the combined extent.
+       */
+      void Merge(const ValueSummary& other);
+
+      /**
+       * Estimates the value that the given fraction of the values are less
+       * than or equal to.
+       */
+      float Percentile(double fraction) const;
+
+      float min;
+      float max;
+      uint64_t count;
+      std::vector<uint64_t> histogram;
+    };
+
+    /**
+     * Summarizes num_values values.  Large clouds are summarized in
+     * parallel.
+     */
+    static ValueSummary SummarizeValues(const float* values, size_t num_values);
+
+    /**
+     * Maps a value normalized to [0, 1] to a color, either along the hue
+     * circle or by interpolating between min_color and max_color.
+     */
+    static QColor MapColor(float val, bool rainbow, const QColor& min_color, const QColor& max_color);
+
+    /**
+     * Fills palette with size RGBA colors that MapColor() maps [0, 1] to, for
+     * the lookup texture that the color shader samples.
+     */
+    static void MakePalette(
+        bool rainbow,
+        const QColor& min_color,
+        const QColor& max_color,
+        size_t size,
+        std::vector<uint8_t>& palette);
+
   protected:
     void PrintError(const std::string& message);
     void PrintInfo(const std::string& message);
@@ -103,38 +201,94 @@ namespace mapviz_plugins
     void BufferSizeChanged(int value);
     void UseRainbowChanged(int check_state);
     void UseAutomaxminChanged(int check_state);
+    void AutomaxminClipChanged(double value);
     void UpdateColors();
     void DrawIcon();
     void ResetTransformedPointClouds();
     void ClearPointClouds();
     void SetSubscription(bool subscribe);
+    void Resubscribe();
+    void ProcessPendingScans();
 
   private:
-    struct StampedPoint
+    // An OpenGL buffer object and the number of bytes last uploaded to it
+    struct VertexBuffer
     {
-      tf::Point point;
-      std::vector<float> features;
+      VertexBuffer() : id(0), size(0), dirty(true) {}
+
+      GLuint id;
+      size_t size;
+      bool dirty;
     };
 
     struct Scan
     {
       ros::Time stamp;
       QColor color;
-      std::vector<StampedPoint> points;
+      // The message is kept so that another field can be decoded when the
+      // color transformer changes.
+      sensor_msgs::PointCloud2ConstPtr msg;
+      // Interleaved xyz coordinates of the points in the source frame
+      std::vector<float> positions;
+      // Values of the field the points are colored by, if any
+      std::vector<float> values;
+      std::string value_field;
+      ValueSummary value_summary;
       std::string source_frame;
       bool transformed;
+      // Transform from the source frame to the target frame
+      mapviz::PointTransformer transformer;
+      // Bounds of the points in the source and target frames
+      mapviz::BoundingBox source_bounds;
+      mapviz::BoundingBox bounds;
       std::map<std::string, FieldInfo> new_features;
 
+      // Target frame xy coordinates of the points; only used if the transform
+      // can't be applied by OpenGL.  These and the colors are released once
+      // they have been uploaded to the buffer objects.
       std::vector<float> gl_point;
       std::vector<uint8_t> gl_color;
-      GLuint point_vbo;
-      GLuint color_vbo;
+      bool colored;
+      // True if the values are mapped to colors by the color shader instead
+      // of on the CPU into gl_color
+      bool shaded;
+      // Coordinates per vertex in point_vbo: 3 if it holds positions, or 2
+      // if it holds gl_point
+      int point_components;
+      VertexBuffer point_vbo;
+      VertexBuffer color_vbo;
+      VertexBuffer value_vbo;
+    };
+
+    // The color settings from the config widget
+    struct ColorSettings
+    {
+      int color_transformer;
+      bool use_rainbow;
+      bool unpack_rgb;
+      QColor min_color;
+      QColor max_color;
     };
 
-    float PointFeature(const uint8_t*, const FieldInfo&);
     void PointCloud2Callback(const sensor_msgs::PointCloud2ConstPtr& scan);
-    QColor CalculateColor(const StampedPoint& point);
+    void UpdateFeatures(const std::map<std::string, FieldInfo>& features);
+    static void DecodeValues(Scan& scan, const std::string& field);
+    QColor CalculateColor(float val);
+    void UpdateScanValues(Scan& scan, const std::string& field);
+    void UpdateScanColors(Scan& scan, const std::string& field);
+    void UpdateValueRange(const std::string& field);
+    void RetireValues(const Scan& scan);
+    std::string ColorField();
+    bool UseShader(const std::string& field);
+    void UpdateColorSettings();
+    bool BindShader();
+    void ReleaseShader();
     void UpdateMinMaxWidgets();
+    static mapviz::MemoryStats ScanMemoryUsage(const Scan& scan);
+    void ReleaseBuffers(Scan& scan);
+
+    template <class T>
+    static void UploadBuffer(VertexBuffer& buffer, std::vector<T>& data, bool release);
 
     Ui::PointCloud2_config ui_;
     QWidget* config_widget_;
@@ -145,14 +299,14 @@ namespace mapviz_plugins
     double min_value_;
     size_t point_size_;
     size_t buffer_size_;
-    bool new_topic_;
     bool has_message_;
     size_t num_of_feats_;
     bool need_new_list_;
     std::string saved_color_transformer_;
     bool need_minmax_;
-    std::vector<double> max_;
-    std::vector<double> min_;
+    // Fraction of the values at each end that the automatic range leaves
+    // out, so that a few outliers don't wash out the colors
+    double automaxmin_clip_;
     // Use a list instead of a deque for scans to facilitate removing
     // timed-out scans in the middle of the list in case I ever re-implement
     // decay time (evenator)
@@ -160,6 +314,39 @@ namespace mapviz_plugins
     ros::Subscriber pc2_sub_;
 
     QMutex scan_mutex_;
+
+    // Buffer objects of scans that were removed outside of Draw(), which
+    // deletes them once the OpenGL context is current.  Guarded by
+    // scan_mutex_.
+    std::vector<GLuint> released_buffers_;
+
+    // Summaries of the values of scans that have been removed from scans_,
+    // by field, so that the automatic range still covers them.  Guarded by
+    // scan_mutex_.
+    std::map<std::string, ValueSummary> retired_values_;
+
+    // Scans are colored in Transform(), which runs off the GUI thread, so
+    // the color settings are copied from the widgets on the GUI thread
+    // whenever they change.  Guarded by scan_mutex_.
+    ColorSettings color_settings_;
+
+    // Maps the values of the color field to colors on the GPU through a
+    // lookup texture, so that changing the color settings doesn't touch the
+    // points.  If shaders aren't available the points are colored on the
+    // CPU instead.
+    boost::shared_ptr<QGLShaderProgram> shader_;
+    bool shader_supported_;
+    int value_attribute_;
+    GLuint palette_texture_;
+    bool palette_dirty_;
+
+    // Scans that have been decoded by the callback thread but not yet
+    // picked up by the GUI thread.
+    std::deque<Scan> pending_scans_;
+    // Name of the field selected in the color transformer, or empty for a
+    // flat color; this is the only field the callback decodes.
+    std::string color_field_;
+    QMutex pending_mutex_;
   };
 }
 
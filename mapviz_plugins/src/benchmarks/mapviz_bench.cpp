@@ -0,0 +1,706 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+// Loads mapviz plugins into an offscreen canvas, feeds them synthetic messages
+// and reports how well they keep up, without a ROS master or a visible window.
+//
+// roscpp can't set up subscriptions without a master, so messages are handed
+// straight to the plugins' callback queues with MapvizPlugin::DeliverMessage()
+// instead of being published.  The tile map only learns the origin of the
+// local frame, and so only draws anything, if a master is running.  Rendering
+// needs an OpenGL context, so an X server is still required, but a virtual
+// one works, e.g.:
+//
+//   xvfb-run -s "-screen 0 1920x1080x24" rosrun mapviz_plugins mapviz_bench \
+//       --plugin pointcloud2:200000:10 --plugin laserscan --duration 20
+//
+// Options:
+//   --plugin TYPE[:SIZE[:RATE]]  Adds a plugin that receives RATE messages per
+//                                second with SIZE elements each.  TYPE is one
+//                                of pointcloud2, laserscan, marker,
+//                                occupancy_grid, path or tile_map.
+//   --duration SECONDS           Time to measure for (10)
+//   --warmup SECONDS             Time to run before measuring (1)
+//   --fps FPS                    Frames to render per second (30)
+//   --width PIXELS               Width of the canvas (1280)
+//   --height PIXELS              Height of the canvas (720)
+//   --scale METERS               Meters per pixel (0.1)
+//   --output FILE                Writes the results to FILE instead of stdout
+//
+// The results are written as JSON so that they can be compared between
+// releases.
+
+#include <GL/glut.h>
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Boost libraries
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+// QT libraries
+#include <QApplication>
+#include <QImage>
+
+// ROS libraries
+#include <geometry_msgs/PoseStamped.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <nav_msgs/Path.h>
+#include <pluginlib/class_loader.h>
+#include <ros/master.h>
+#include <ros/ros.h>
+#include <ros/serialization.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <swri_transform_util/transform_manager.h>
+#include <tf/transform_listener.h>
+#include <topic_tools/shape_shifter.h>
+#include <visualization_msgs/MarkerArray.h>
+
+#include <mapviz/map_canvas.h>
+#include <mapviz/mapviz_plugin.h>
+#include <mapviz/stopwatch.h>
+#include <mapviz/transform_cache.h>
+
+#include "synthetic_messages.h"
+
+namespace
+{
+  const char* FRAME_ID = "map";
+
+  /**
+   * Delivers synthetic messages to one plugin.
+   */
+  class MessageSource
+  {
+  public:
+    MessageSource(const mapviz::MapvizPluginPtr& plugin, const std::string& topic) :
+      plugin_(plugin),
+      topic_(topic),
+      published_(0)
+    {
+    }
+    virtual ~MessageSource() {}
+
+    virtual void Publish() = 0;
+
+    uint64_t Published() const { return published_; }
+
+  protected:
+    template <class M>
+    void Publish(const boost::shared_ptr<M>& message)
+    {
+      message->header.stamp = ros::Time::now();
+      message->header.frame_id = FRAME_ID;
+      Deliver(boost::shared_ptr<const M>(message));
+    }
+
+    template <class M>
+    void Deliver(const boost::shared_ptr<const M>& message)
+    {
+      if (plugin_->DeliverMessage(topic_, message))
+      {
+        published_++;
+      }
+      else if (published_ == 0)
+      {
+        ROS_ERROR("%s is not subscribed to %s.", plugin_->Name().c_str(), topic_.c_str());
+      }
+    }
+
+    mapviz::MapvizPluginPtr plugin_;
+    std::string topic_;
+    uint64_t published_;
+    mapviz_plugins::SyntheticMessageGenerator generator_;
+  };
+  typedef boost::shared_ptr<MessageSource> MessageSourcePtr;
+
+  class PointCloud2Source : public MessageSource
+  {
+  public:
+    PointCloud2Source(const mapviz::MapvizPluginPtr& plugin, const std::string& topic, int size) :
+      MessageSource(plugin, topic),
+      size_(size)
+    {
+      mapviz_plugins::ParseSyntheticFields("intensity", fields_);
+    }
+
+    void Publish()
+    {
+      boost::shared_ptr<sensor_msgs::PointCloud2> cloud = boost::make_shared<sensor_msgs::PointCloud2>();
+      generator_.MakePointCloud2(size_, fields_, *cloud);
+      MessageSource::Publish(cloud);
+    }
+
+  private:
+    int size_;
+    std::vector<mapviz_plugins::SyntheticField> fields_;
+  };
+
+  class LaserScanSource : public MessageSource
+  {
+  public:
+    LaserScanSource(const mapviz::MapvizPluginPtr& plugin, const std::string& topic, int size) :
+      MessageSource(plugin, topic),
+      size_(size)
+    {
+    }
+
+    void Publish()
+    {
+      boost::shared_ptr<sensor_msgs::LaserScan> scan = boost::make_shared<sensor_msgs::LaserScan>();
+      generator_.MakeLaserScan(size_, *scan);
+      MessageSource::Publish(scan);
+    }
+
+  private:
+    int size_;
+  };
+
+  class MarkerSource : public MessageSource
+  {
+  public:
+    MarkerSource(const mapviz::MapvizPluginPtr& plugin, const std::string& topic, int size) :
+      MessageSource(plugin, topic),
+      size_(size)
+    {
+      types_.push_back(visualization_msgs::Marker::CUBE);
+    }
+
+    void Publish()
+    {
+      boost::shared_ptr<visualization_msgs::MarkerArray> markers =
+          boost::make_shared<visualization_msgs::MarkerArray>();
+      generator_.MakeMarkerArray(size_, types_, 0.0, 0, "mapviz_bench", *markers);
+      for (size_t i = 0; i < markers->markers.size(); i++)
+      {
+        markers->markers[i].header.stamp = ros::Time::now();
+        markers->markers[i].header.frame_id = FRAME_ID;
+      }
+
+      // The marker plugin subscribes to any message type, so it gets the
+      // serialized message, just as roscpp would deliver it.
+      typedef visualization_msgs::MarkerArray MarkerArray;
+      std::vector<uint8_t> buffer(ros::serialization::serializationLength(*markers));
+      ros::serialization::OStream out(buffer.data(), static_cast<uint32_t>(buffer.size()));
+      ros::serialization::serialize(out, *markers);
+
+      boost::shared_ptr<topic_tools::ShapeShifter> message = boost::make_shared<topic_tools::ShapeShifter>();
+      ros::serialization::IStream in(buffer.data(), static_cast<uint32_t>(buffer.size()));
+      message->read(in);
+      message->morph(ros::message_traits::MD5Sum<MarkerArray>::value(),
+                     ros::message_traits::DataType<MarkerArray>::value(),
+                     ros::message_traits::Definition<MarkerArray>::value(),
+                     "");
+      Deliver(boost::shared_ptr<const topic_tools::ShapeShifter>(message));
+    }
+
+  private:
+    int size_;
+    std::vector<int32_t> types_;
+  };
+
+  class OccupancyGridSource : public MessageSource
+  {
+  public:
+    OccupancyGridSource(const mapviz::MapvizPluginPtr& plugin, const std::string& topic, int size) :
+      MessageSource(plugin, topic),
+      side_(std::max(1, static_cast<int>(std::sqrt(static_cast<double>(size)))))
+    {
+    }
+
+    void Publish()
+    {
+      boost::shared_ptr<nav_msgs::OccupancyGrid> grid = boost::make_shared<nav_msgs::OccupancyGrid>();
+      generator_.MakeOccupancyGrid(side_, *grid);
+      MessageSource::Publish(grid);
+    }
+
+  private:
+    int side_;
+  };
+
+  class PathSource : public MessageSource
+  {
+  public:
+    PathSource(const mapviz::MapvizPluginPtr& plugin, const std::string& topic, int size) :
+      MessageSource(plugin, topic),
+      size_(size)
+    {
+    }
+
+    void Publish()
+    {
+      boost::shared_ptr<nav_msgs::Path> path = boost::make_shared<nav_msgs::Path>();
+      generator_.MakePath(size_, FRAME_ID, *path);
+      MessageSource::Publish(path);
+    }
+
+  private:
+    int size_;
+  };
+
+  struct PluginSpec
+  {
+    std::string type;
+    int size;
+    double rate;
+  };
+
+  struct BenchPlugin
+  {
+    PluginSpec spec;
+    mapviz::MapvizPluginPtr plugin;
+    MessageSourcePtr source;
+    ros::WallTime next_publish;
+  };
+
+  int DefaultSize(const std::string& type)
+  {
+    if (type == "pointcloud2")
+    {
+      return 100000;
+    }
+    else if (type == "laserscan")
+    {
+      return 1080;
+    }
+    else if (type == "occupancy_grid")
+    {
+      return 1000000;
+    }
+    return 1000;
+  }
+
+  bool ParsePluginSpec(const std::string& text, PluginSpec& spec)
+  {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true)
+    {
+      size_t end = text.find(':', start);
+      parts.push_back(text.substr(start, end - start));
+      if (end == std::string::npos)
+      {
+        break;
+      }
+      start = end + 1;
+    }
+
+    spec.type = parts[0];
+    spec.size = parts.size() > 1 ? std::atoi(parts[1].c_str()) : DefaultSize(spec.type);
+    spec.rate = parts.size() > 2 ? std::atof(parts[2].c_str()) : 10.0;
+    return spec.size > 0 && spec.rate >= 0.0;
+  }
+
+  void WriteSummary(FILE* file, const char* name, const mapviz::StopwatchSummary& summary)
+  {
+    fprintf(file, "\"%s\": {\"count\": %lu, \"avg\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+                  "\"p99\": %.4f, \"p99.9\": %.4f, \"max\": %.4f}",
+            name,
+            static_cast<unsigned long>(summary.count),
+            summary.avg_ms,
+            summary.p50_ms,
+            summary.p90_ms,
+            summary.p99_ms,
+            summary.p999_ms,
+            summary.max_ms);
+  }
+
+  // Reads a value in kB from /proc/self/status, e.g. VmRSS or VmHWM.
+  long ReadProcessMemory(const std::string& key)
+  {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+      if (line.compare(0, key.size() + 1, key + ":") == 0)
+      {
+        return std::atol(line.c_str() + key.size() + 1);
+      }
+    }
+    return -1;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  QApplication app(argc, argv);
+  glutInit(&argc, argv);
+  ros::init(argc, argv, "mapviz_bench",
+            ros::init_options::AnonymousName | ros::init_options::NoRosout);
+
+  std::vector<PluginSpec> specs;
+  double duration = 10.0;
+  double warmup = 1.0;
+  double fps = 30.0;
+  int width = 1280;
+  int height = 720;
+  double scale = 0.1;
+  std::string output;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--plugin" && has_value)
+    {
+      PluginSpec spec;
+      if (!ParsePluginSpec(argv[++i], spec))
+      {
+        fprintf(stderr, "Invalid plugin: %s\n", argv[i]);
+        return 1;
+      }
+      specs.push_back(spec);
+    }
+    else if (arg == "--duration" && has_value)
+    {
+      duration = std::atof(argv[++i]);
+    }
+    else if (arg == "--warmup" && has_value)
+    {
+      warmup = std::atof(argv[++i]);
+    }
+    else if (arg == "--fps" && has_value)
+    {
+      fps = std::atof(argv[++i]);
+    }
+    else if (arg == "--width" && has_value)
+    {
+      width = std::atoi(argv[++i]);
+    }
+    else if (arg == "--height" && has_value)
+    {
+      height = std::atoi(argv[++i]);
+    }
+    else if (arg == "--scale" && has_value)
+    {
+      scale = std::atof(argv[++i]);
+    }
+    else if (arg == "--output" && has_value)
+    {
+      output = argv[++i];
+    }
+    else
+    {
+      fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+      return 1;
+    }
+  }
+
+  if (specs.empty())
+  {
+    PluginSpec spec;
+    ParsePluginSpec("pointcloud2", spec);
+    specs.push_back(spec);
+  }
+  if (fps <= 0.0)
+  {
+    fprintf(stderr, "Invalid frame rate: %f\n", fps);
+    return 1;
+  }
+
+  // Keep the results on stdout readable.
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn))
+  {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+
+  // Don't wait for a master that isn't there when the plugins subscribe;
+  // their messages are delivered directly.
+  ros::master::setRetryTimeout(ros::WallDuration(0.1));
+  ros::NodeHandle node("~");
+
+  boost::shared_ptr<tf::TransformListener> tf = boost::make_shared<tf::TransformListener>();
+  swri_transform_util::TransformManagerPtr tf_manager =
+      boost::make_shared<swri_transform_util::TransformManager>();
+  tf_manager->Initialize(tf);
+  mapviz::TransformCachePtr transform_cache = boost::make_shared<mapviz::TransformCache>(tf_manager);
+
+  // The canvas is never shown; it only needs a native window for its OpenGL
+  // context.
+  mapviz::MapCanvas canvas;
+  canvas.winId();
+  canvas.setFixedSize(width, height);
+  canvas.InitializeTf(tf);
+  canvas.SetTransformCache(transform_cache);
+  canvas.SetFixedFrame(FRAME_ID);
+  canvas.SetTargetFrame(FRAME_ID);
+  canvas.SetViewScale(scale);
+
+  // The tile map needs to know where the local frame is.
+  ros::Publisher origin_pub = node.advertise<geometry_msgs::PoseStamped>("/local_xy_origin", 1, true);
+  geometry_msgs::PoseStamped origin;
+  origin.header.frame_id = FRAME_ID;
+  origin.pose.position.x = -97.5;
+  origin.pose.position.y = 29.5;
+  origin.pose.orientation.w = 1.0;
+  origin_pub.publish(origin);
+
+  pluginlib::ClassLoader<mapviz::MapvizPlugin> loader("mapviz", "mapviz::MapvizPlugin");
+  std::vector<BenchPlugin> plugins;
+  for (size_t i = 0; i < specs.size(); i++)
+  {
+    BenchPlugin bench;
+    bench.spec = specs[i];
+
+    const std::string& type = bench.spec.type;
+    std::string topic = "/mapviz_bench/" + type + std::to_string(i);
+    if (type != "pointcloud2" && type != "laserscan" && type != "marker" &&
+        type != "occupancy_grid" && type != "path" && type != "tile_map")
+    {
+      fprintf(stderr, "Unsupported plugin type: %s\n", type.c_str());
+      return 1;
+    }
+
+    try
+    {
+      bench.plugin = loader.createInstance("mapviz_plugins/" + type);
+    }
+    catch (const pluginlib::PluginlibException& e)
+    {
+      fprintf(stderr, "Failed to load mapviz_plugins/%s: %s\n", type.c_str(), e.what());
+      return 1;
+    }
+
+    bench.plugin->GetConfigWidget(NULL);
+    bench.plugin->SetTransformCache(transform_cache);
+    bench.plugin->Initialize(tf, tf_manager, &canvas);
+    bench.plugin->SetType("mapviz_plugins/" + type);
+    bench.plugin->SetName(type + std::to_string(i));
+    bench.plugin->SetNode(node);
+    bench.plugin->SetVisible(true);
+    bench.plugin->SetDrawOrder(static_cast<int>(i));
+
+    if (type == "pointcloud2")
+    {
+      bench.source = boost::make_shared<PointCloud2Source>(bench.plugin, topic, bench.spec.size);
+    }
+    else if (type == "laserscan")
+    {
+      bench.source = boost::make_shared<LaserScanSource>(bench.plugin, topic, bench.spec.size);
+    }
+    else if (type == "marker")
+    {
+      bench.source = boost::make_shared<MarkerSource>(bench.plugin, topic, bench.spec.size);
+    }
+    else if (type == "occupancy_grid")
+    {
+      bench.source = boost::make_shared<OccupancyGridSource>(bench.plugin, topic, bench.spec.size);
+    }
+    else if (type == "path")
+    {
+      bench.source = boost::make_shared<PathSource>(bench.plugin, topic, bench.spec.size);
+    }
+
+    if (bench.source)
+    {
+      YAML::Node config;
+      config["topic"] = topic;
+      bench.plugin->LoadConfig(config, "");
+    }
+
+    bench.plugin->SetTargetFrame(FRAME_ID);
+    canvas.AddPlugin(bench.plugin, -1);
+    plugins.push_back(bench);
+  }
+  canvas.ReorderDisplays();
+
+  mapviz::Stopwatch meas_render;
+  ros::WallTime start = ros::WallTime::now();
+  ros::WallTime measure_start = start + ros::WallDuration(warmup);
+  ros::WallTime end = measure_start + ros::WallDuration(duration);
+  ros::WallDuration frame_period(1.0 / fps);
+  ros::WallTime next_frame = start;
+  for (size_t i = 0; i < plugins.size(); i++)
+  {
+    plugins[i].next_publish = start;
+  }
+
+  std::vector<uint64_t> published_at_start(plugins.size(), 0);
+  uint64_t frames = 0;
+  bool measuring = false;
+  QImage image;
+  while (ros::ok())
+  {
+    ros::WallTime now = ros::WallTime::now();
+    if (!measuring && now >= measure_start)
+    {
+      // Discard everything measured while warming up.
+      measuring = true;
+      canvas.CollectMeasurements();
+      meas_render.nextWindow();
+      for (size_t i = 0; i < plugins.size(); i++)
+      {
+        plugins[i].plugin->CollectMeasurements();
+        published_at_start[i] = plugins[i].source ? plugins[i].source->Published() : 0;
+      }
+      frames = 0;
+    }
+    if (now >= end)
+    {
+      break;
+    }
+
+    ros::WallTime next_event = next_frame;
+    for (size_t i = 0; i < plugins.size(); i++)
+    {
+      BenchPlugin& bench = plugins[i];
+      if (!bench.source || bench.spec.rate <= 0.0)
+      {
+        continue;
+      }
+      if (now >= bench.next_publish)
+      {
+        bench.source->Publish();
+        bench.next_publish += ros::WallDuration(1.0 / bench.spec.rate);
+        if (bench.next_publish < now)
+        {
+          // Publishing alone can't keep up with the rate.
+          bench.next_publish = now;
+        }
+      }
+      next_event = std::min(next_event, bench.next_publish);
+    }
+
+    ros::spinOnce();
+    for (size_t i = 0; i < plugins.size(); i++)
+    {
+      plugins[i].plugin->ProcessCallbacks();
+    }
+    app.processEvents();
+
+    if (ros::WallTime::now() >= next_frame)
+    {
+      ros::WallTime frame_start = ros::WallTime::now();
+      if (!canvas.RenderOffscreen(&image))
+      {
+        fprintf(stderr, "Failed to render a frame.\n");
+        return 1;
+      }
+      meas_render.record(ros::WallTime::now() - frame_start);
+      frames++;
+
+      next_frame += frame_period;
+      if (next_frame < ros::WallTime::now())
+      {
+        next_frame = ros::WallTime::now();
+      }
+      next_event = std::min(next_event, next_frame);
+    }
+
+    ros::WallDuration wait = std::min(next_event, end) - ros::WallTime::now();
+    if (wait > ros::WallDuration(0.0))
+    {
+      wait.sleep();
+    }
+  }
+
+  mapviz::MapCanvas::Measurements canvas_meas = canvas.CollectMeasurements();
+
+  FILE* file = stdout;
+  if (!output.empty())
+  {
+    file = fopen(output.c_str(), "w");
+    if (!file)
+    {
+      fprintf(stderr, "Failed to open %s\n", output.c_str());
+      return 1;
+    }
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"duration_s\": %.3f,\n", duration);
+  fprintf(file, "  \"width\": %d,\n", width);
+  fprintf(file, "  \"height\": %d,\n", height);
+  fprintf(file, "  \"target_fps\": %.3f,\n", fps);
+  fprintf(file, "  \"frames\": {\"count\": %lu, \"fps\": %.3f, ",
+          static_cast<unsigned long>(frames), frames / duration);
+  WriteSummary(file, "render_ms", meas_render.nextSummary());
+  fprintf(file, ", ");
+  WriteSummary(file, "paint_ms", canvas_meas.frame);
+  fprintf(file, ", ");
+  WriteSummary(file, "transform_ms", canvas_meas.transform);
+  fprintf(file, "},\n");
+  fprintf(file, "  \"memory\": {\"rss_kb\": %ld, \"peak_rss_kb\": %ld, \"render_cache_gpu_bytes\": %lu},\n",
+          ReadProcessMemory("VmRSS"), ReadProcessMemory("VmHWM"),
+          static_cast<unsigned long>(canvas_meas.render_caches.gpu_bytes));
+  fprintf(file, "  \"plugins\": [");
+  for (size_t i = 0; i < plugins.size(); i++)
+  {
+    BenchPlugin& bench = plugins[i];
+    mapviz::MapvizPlugin::Measurements meas = bench.plugin->CollectMeasurements();
+    uint64_t published = bench.source ? bench.source->Published() - published_at_start[i] : 0;
+
+    fprintf(file, "%s\n    {\"type\": \"%s\", \"size\": %d, \"rate\": %.3f, ",
+            i == 0 ? "" : ",", bench.spec.type.c_str(), bench.spec.size, bench.spec.rate);
+    fprintf(file, "\"published\": %lu, \"callbacks\": %lu, \"callbacks_per_s\": %.3f, \"dropped_total\": %lu, ",
+            static_cast<unsigned long>(published),
+            static_cast<unsigned long>(meas.callbacks.count),
+            meas.callbacks.count / duration,
+            static_cast<unsigned long>(bench.plugin->DroppedMessages()));
+    fprintf(file, "\"buffered_elements\": %lu, \"cpu_bytes\": %lu, \"gpu_bytes\": %lu, ",
+            static_cast<unsigned long>(bench.plugin->BufferedElements()),
+            static_cast<unsigned long>(meas.memory.cpu_bytes),
+            static_cast<unsigned long>(meas.memory.gpu_bytes));
+    WriteSummary(file, "callback_ms", meas.callbacks);
+    fprintf(file, ", ");
+    WriteSummary(file, "transform_ms", meas.transform);
+    fprintf(file, ", ");
+    WriteSummary(file, "draw_ms", meas.draw);
+    fprintf(file, ", ");
+    WriteSummary(file, "receive_latency_ms", meas.receive_latency);
+    fprintf(file, ", ");
+    WriteSummary(file, "display_latency_ms", meas.display_latency);
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n  ]\n}\n");
+
+  if (file != stdout)
+  {
+    fclose(file);
+  }
+
+  for (size_t i = 0; i < plugins.size(); i++)
+  {
+    canvas.RemovePlugin(plugins[i].plugin);
+  }
+  plugins.clear();
+
+  return 0;
+}
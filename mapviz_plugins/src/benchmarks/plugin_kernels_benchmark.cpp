@@ -0,0 +1,316 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+// Microbenchmarks of the per-point and per-pixel inner loops of the plugins
+// that process large messages: PointCloud2 field decoding and coloring,
+// LaserScan conversion, OccupancyGrid palette mapping and the disparity
+// color map.
+//
+// Usage: plugin_kernels_benchmark [--filter=...] [--min_time=...]
+//                                 [--repetitions=...] [--json=...]
+
+#include <mapviz/benchmark.h>
+
+#include <mapviz_plugins/disparity_plugin.h>
+#include <mapviz_plugins/laserscan_plugin.h>
+#include <mapviz_plugins/occupancy_grid_plugin.h>
+#include <mapviz_plugins/pointcloud2_plugin.h>
+
+// C++ standard libraries
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// ROS libraries
+#include <sensor_msgs/PointField.h>
+
+namespace
+{
+  typedef mapviz_plugins::PointCloud2Plugin::FieldInfo FieldInfo;
+
+  // Layout of a typical lidar point: x, y, z, intensity, ring, time.
+  const uint32_t POINT_STEP = 32;
+
+  FieldInfo MakeField(uint8_t datatype, uint32_t offset)
+  {
+    FieldInfo info;
+    info.datatype = datatype;
+    info.offset = offset;
+    return info;
+  }
+
+  void BenchmarkPointCloud2(mapviz::BenchmarkRunner& runner, size_t num_points)
+  {
+    const std::string suffix = "/" + std::to_string(num_points);
+
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> distribution(-50.0f, 50.0f);
+    std::vector<uint8_t> data(num_points * POINT_STEP);
+    for (size_t i = 0; i < num_points; i++)
+    {
+      uint8_t* point = &data[i * POINT_STEP];
+      float xyzi[4] = {
+          distribution(generator),
+          distribution(generator),
+          distribution(generator) * 0.1f,
+          std::abs(distribution(generator)) * 2.0f};
+      uint16_t ring = static_cast<uint16_t>(i % 64);
+      double time = i * 1e-6;
+      memcpy(point, xyzi, sizeof(xyzi));
+      memcpy(point + 16, &ring, sizeof(ring));
+      memcpy(point + 24, &time, sizeof(time));
+    }
+
+    std::vector<FieldInfo> fields;
+    fields.push_back(MakeField(sensor_msgs::PointField::FLOAT32, 0));
+    fields.push_back(MakeField(sensor_msgs::PointField::FLOAT32, 4));
+    fields.push_back(MakeField(sensor_msgs::PointField::FLOAT32, 8));
+    fields.push_back(MakeField(sensor_msgs::PointField::FLOAT32, 12));
+    fields.push_back(MakeField(sensor_msgs::PointField::UINT16, 16));
+    fields.push_back(MakeField(sensor_msgs::PointField::FLOAT64, 24));
+
+    std::vector<float> values(num_points);
+    const char* field_names[] = {"float32", "uint16", "float64"};
+    const size_t field_indices[] = {3, 4, 5};
+    for (size_t f = 0; f < 3; f++)
+    {
+      const FieldInfo& field = fields[field_indices[f]];
+      runner.Run(std::string("PointCloud2/PointFeature/") + field_names[f] + suffix, num_points, [&]()
+      {
+        const uint8_t* ptr = &data[0];
+        for (size_t i = 0; i < num_points; i++, ptr += POINT_STEP)
+        {
+          values[i] = mapviz_plugins::PointCloud2Plugin::PointFeature(ptr, field);
+        }
+        mapviz::DoNotOptimize(values[0]);
+      });
+    }
+
+    // The type-specialized kernels the callback decodes with.  At 2M points
+    // and 20 Hz, decoding and coloring a cloud has to fit in 50 ms.
+    std::vector<float> positions(num_points * 3);
+    runner.Run("PointCloud2/DecodePositions" + suffix, num_points, [&]()
+    {
+      mapviz::BoundingBox bounds = mapviz_plugins::PointCloud2Plugin::DecodePositions(
+          &data[0], num_points, POINT_STEP, fields[0], fields[1], fields[2], &positions[0]);
+      mapviz::DoNotOptimize(bounds);
+      mapviz::DoNotOptimize(positions[0]);
+    });
+    for (size_t f = 0; f < 3; f++)
+    {
+      const FieldInfo& field = fields[field_indices[f]];
+      runner.Run(std::string("PointCloud2/DecodeField/") + field_names[f] + suffix, num_points, [&]()
+      {
+        mapviz_plugins::PointCloud2Plugin::DecodeField(&data[0], num_points, POINT_STEP, field, &values[0]);
+        mapviz::DoNotOptimize(values[0]);
+      });
+    }
+
+    // The extent and histogram that the automatic color range is derived
+    // from.
+    runner.Run("PointCloud2/SummarizeValues" + suffix, num_points, [&]()
+    {
+      mapviz_plugins::PointCloud2Plugin::ValueSummary summary =
+          mapviz_plugins::PointCloud2Plugin::SummarizeValues(&values[0], num_points);
+      mapviz::DoNotOptimize(summary.count);
+    });
+
+    // What the callback used to do: every field of every point is decoded
+    // into a vector per point.
+    std::vector<std::vector<float> > features(num_points);
+    runner.Run("PointCloud2/DecodeAllFields" + suffix, num_points, [&]()
+    {
+      const uint8_t* ptr = &data[0];
+      for (size_t i = 0; i < num_points; i++, ptr += POINT_STEP)
+      {
+        std::vector<float>& point = features[i];
+        point.resize(fields.size());
+        for (size_t count = 0; count < fields.size(); count++)
+        {
+          point[count] = mapviz_plugins::PointCloud2Plugin::PointFeature(ptr, fields[count]);
+        }
+      }
+      mapviz::DoNotOptimize(features[0][0]);
+    });
+
+    // Normalizing by the min and max and mapping to a color, as in
+    // CalculateColor().
+    const uint8_t* ptr = &data[0];
+    for (size_t i = 0; i < num_points; i++, ptr += POINT_STEP)
+    {
+      values[i] = mapviz_plugins::PointCloud2Plugin::PointFeature(ptr, fields[3]);
+    }
+    const float min_value = 0.0f;
+    const float max_value = 100.0f;
+    const QColor min_color(Qt::black);
+    const QColor max_color(Qt::white);
+    std::vector<QColor> colors(num_points);
+    for (int rainbow = 0; rainbow < 2; rainbow++)
+    {
+      runner.Run(std::string("PointCloud2/CalculateColor/") + (rainbow ? "rainbow" : "interpolate") + suffix,
+                 num_points, [&]()
+      {
+        for (size_t i = 0; i < num_points; i++)
+        {
+          float val = (values[i] - min_value) / (max_value - min_value);
+          val = std::max(0.0f, std::min(val, 1.0f));
+          colors[i] = mapviz_plugins::PointCloud2Plugin::MapColor(val, rainbow, min_color, max_color);
+        }
+        mapviz::DoNotOptimize(colors[0]);
+      });
+    }
+  }
+
+  void BenchmarkLaserScan(mapviz::BenchmarkRunner& runner, size_t num_beams)
+  {
+    const std::string suffix = "/" + std::to_string(num_beams);
+
+    sensor_msgs::LaserScan msg;
+    msg.angle_min = -2.35619f;
+    msg.angle_increment = 4.71239f / num_beams;
+    msg.range_min = 0.1f;
+    msg.range_max = 30.0f;
+    msg.ranges.resize(num_beams);
+    msg.intensities.resize(num_beams);
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> distribution(0.0f, 35.0f);
+    for (size_t i = 0; i < num_beams; i++)
+    {
+      msg.ranges[i] = distribution(generator);
+      msg.intensities[i] = distribution(generator) * 100.0f;
+    }
+
+    std::vector<double> cos_table;
+    std::vector<double> sin_table;
+    runner.Run("LaserScan/ComputeTrigTables" + suffix, num_beams, [&]()
+    {
+      mapviz_plugins::LaserScanPlugin::ComputeTrigTables(
+          msg.angle_min, msg.angle_increment, num_beams, cos_table, sin_table);
+      mapviz::DoNotOptimize(cos_table[0]);
+    });
+
+    std::vector<mapviz_plugins::LaserScanPlugin::StampedPoint> points;
+    runner.Run("LaserScan/ConvertRanges" + suffix, num_beams, [&]()
+    {
+      points.clear();
+      points.reserve(num_beams);
+      mapviz_plugins::LaserScanPlugin::ConvertRanges(msg, cos_table, sin_table, points);
+      mapviz::DoNotOptimize(points[0]);
+    });
+  }
+
+  void BenchmarkOccupancyGrid(mapviz::BenchmarkRunner& runner, size_t size, size_t update_size)
+  {
+    typedef mapviz_plugins::OccupancyGridPlugin::Palette Palette;
+
+    Palette palette;
+    for (size_t i = 0; i < 256; i++)
+    {
+      palette[i * 4] = i;
+      palette[i * 4 + 1] = 255 - i;
+      palette[i * 4 + 2] = i / 2;
+      palette[i * 4 + 3] = 255;
+    }
+
+    // Mostly free space with some obstacles and unknown cells, like a real map.
+    std::mt19937 generator(0);
+    std::discrete_distribution<int> distribution({80, 15, 5});
+    const int8_t cell_values[] = {0, 100, -1};
+    std::vector<int8_t> grid(size * size);
+    for (size_t i = 0; i < grid.size(); i++)
+    {
+      grid[i] = cell_values[distribution(generator)];
+    }
+
+    // The texture is the next power of two, as in Callback().
+    size_t texture_size = 2;
+    while (texture_size < size)
+    {
+      texture_size <<= 1;
+    }
+    std::vector<uchar> raw(texture_size * texture_size);
+    std::vector<uchar> color(texture_size * texture_size * 4);
+
+    runner.Run("OccupancyGrid/ColorizeCells/" + std::to_string(size) + "x" + std::to_string(size),
+               size * size, [&]()
+    {
+      mapviz_plugins::OccupancyGridPlugin::ColorizeCells(
+          &grid[0], size, size, size, texture_size, palette, &raw[0], &color[0]);
+      mapviz::DoNotOptimize(color[0]);
+    });
+
+    // A costmap update in the middle of the map, as in CallbackUpdate().
+    size_t offset = (size - update_size) / 2 * (texture_size + 1);
+    runner.Run("OccupancyGrid/ColorizeCells/update/" + std::to_string(update_size) + "x" +
+               std::to_string(update_size), update_size * update_size, [&]()
+    {
+      mapviz_plugins::OccupancyGridPlugin::ColorizeCells(
+          &grid[0], update_size, update_size, update_size, texture_size, palette,
+          &raw[offset], &color[offset * 4]);
+      mapviz::DoNotOptimize(color[0]);
+    });
+  }
+
+  void BenchmarkDisparity(mapviz::BenchmarkRunner& runner, int width, int height)
+  {
+    cv::Mat disparity(height, width, CV_32FC1);
+    cv::randu(disparity, cv::Scalar(-4.0f), cv::Scalar(132.0f));
+
+    cv::Mat_<cv::Vec3b> color;
+    runner.Run("Disparity/ColorizeDisparity/" + std::to_string(width) + "x" + std::to_string(height),
+               static_cast<size_t>(width) * height, [&]()
+    {
+      mapviz_plugins::DisparityPlugin::ColorizeDisparity(disparity, 0.0f, 128.0f, color);
+      mapviz::DoNotOptimize(color.data);
+    });
+  }
+}
+
+int main(int argc, char **argv)
+{
+  mapviz::BenchmarkRunner runner(argc, argv);
+
+  BenchmarkPointCloud2(runner, 100000);
+  BenchmarkPointCloud2(runner, 2000000);
+
+  BenchmarkLaserScan(runner, 1081);
+  BenchmarkLaserScan(runner, 16384);
+
+  BenchmarkOccupancyGrid(runner, 1000, 100);
+  BenchmarkOccupancyGrid(runner, 4000, 400);
+
+  BenchmarkDisparity(runner, 640, 480);
+  BenchmarkDisparity(runner, 1280, 720);
+
+  return runner.Finish();
+}
@@ -0,0 +1,640 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+// Publishes synthetic sensor data at configurable rates and sizes so that
+// mapviz can be tested under a reproducible load, e.g. to find the rate at
+// which a plugin saturates on a given machine.  Combine it with mapviz's
+// profiling output (~print_profile_data) or its telemetry.
+//
+//   rosrun mapviz_plugins stress_publisher _pointcloud2/size:=500000 _ramp/period:=10
+//
+// Every stream type has these parameters, prefixed with the stream name
+// (e.g. ~pointcloud2/rate):
+//   rate      Messages per second; 0 disables the stream
+//   size      Elements per message (see below)
+//   topics    Number of topics to publish the stream on (1); with more than
+//             one, the topics are numbered, e.g. points_0, points_1...
+//   topic     Name of the topic
+//   frame_id  Frame of the messages; by default the streams are spread over
+//             the leaves of the TF tree
+//
+// Streams and their size parameters:
+//   pointcloud2     Points per cloud; ~pointcloud2/fields adds fields besides
+//                   x, y and z, e.g. "intensity:float32,ring:uint16"
+//   laserscan       Beams per scan
+//   marker          Markers per MarkerArray; ~marker/types is a list of marker
+//                   types such as "cube,sphere,line_strip,text_view_facing",
+//                   ~marker/lifetime their lifetime in seconds and
+//                   ~marker/points the points of line strips, lists and points
+//   occupancy_grid  Cells per side of the grid; ~occupancy_grid/update_rate and
+//                   ~occupancy_grid/update_size configure the updates
+//                   published on the "_updates" topic
+//   path            Poses per path
+//   odometry        Unused
+//   image           Width of the image; ~image/height and ~image/encoding
+//
+// Other parameters:
+//   ~frame_id        Root frame of the TF tree ("map")
+//   ~area_size       Size of the square the data is spread over in meters (100)
+//   ~seed            Seed of the random data (0)
+//   ~pool_size       Number of distinct messages per stream, which are
+//                    generated up front and published in turn (4)
+//   ~tf/depth        Depth of the TF tree below the root frame (2)
+//   ~tf/branching    Children of every frame in the TF tree (2)
+//   ~tf/rate         Rate of the TF tree in Hz (50)
+//   ~tf/moving       Whether the frames of the tree move (true)
+//   ~ramp/period     If positive, the rates of all streams are multiplied by
+//                    ~ramp/factor (2.0) every period seconds, up to
+//                    ~ramp/max_rate (10000)
+//   ~report_period   Seconds between reports of the achieved rates (5)
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Boost libraries
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+// ROS libraries
+#include <ros/ros.h>
+#include <tf/transform_broadcaster.h>
+
+#include "synthetic_messages.h"
+
+namespace
+{
+  template <class M>
+  void SetHeader(M& message, const ros::Time& stamp, const std::string& frame_id)
+  {
+    message.header.stamp = stamp;
+    message.header.frame_id = frame_id;
+  }
+
+  void SetHeader(visualization_msgs::MarkerArray& message, const ros::Time& stamp, const std::string& frame_id)
+  {
+    for (size_t i = 0; i < message.markers.size(); i++)
+    {
+      SetHeader(message.markers[i], stamp, frame_id);
+    }
+  }
+
+  /**
+   * One topic that messages are published on at a fixed rate.
+   */
+  class Stream
+  {
+  public:
+    Stream(const std::string& name, double rate) :
+      name_(name),
+      rate_(rate),
+      published_(0),
+      bytes_(0),
+      last_published_(0),
+      last_bytes_(0)
+    {
+    }
+    virtual ~Stream() {}
+
+    void Start(ros::NodeHandle& node)
+    {
+      timer_ = node.createWallTimer(ros::WallDuration(1.0 / rate_), &Stream::TimerCallback, this);
+    }
+
+    double Rate() const { return rate_; }
+
+    void SetRate(double rate)
+    {
+      rate_ = rate;
+      timer_.setPeriod(ros::WallDuration(1.0 / rate_));
+    }
+
+    void Report(double elapsed)
+    {
+      double rate = (published_ - last_published_) / elapsed;
+      double bandwidth = (bytes_ - last_bytes_) / elapsed / 1e6;
+      ROS_INFO("%-40s %9.1f Hz (target %.1f)  %9.2f MB/s",
+               name_.c_str(), rate, rate_, bandwidth);
+      last_published_ = published_;
+      last_bytes_ = bytes_;
+    }
+
+  protected:
+    virtual uint64_t Publish(const ros::Time& stamp) = 0;
+
+    std::string name_;
+
+  private:
+    void TimerCallback(const ros::WallTimerEvent&)
+    {
+      bytes_ += Publish(ros::Time::now());
+      published_++;
+    }
+
+    double rate_;
+    ros::WallTimer timer_;
+
+    uint64_t published_;
+    uint64_t bytes_;
+    uint64_t last_published_;
+    uint64_t last_bytes_;
+  };
+  typedef boost::shared_ptr<Stream> StreamPtr;
+
+  /**
+   * Publishes copies of a pool of pregenerated messages in turn, so that
+   * generating random data doesn't limit the rate.
+   */
+  template <class M>
+  class PooledStream : public Stream
+  {
+  public:
+    PooledStream(
+        ros::NodeHandle& node,
+        const std::string& topic,
+        double rate,
+        const std::string& frame_id,
+        const std::vector<M>& pool) :
+      Stream(topic, rate),
+      frame_id_(frame_id),
+      pool_(pool),
+      next_(0)
+    {
+      publisher_ = node.advertise<M>(topic, 10);
+      for (size_t i = 0; i < pool_.size(); i++)
+      {
+        SetHeader(pool_[i], ros::Time(), frame_id_);
+        sizes_.push_back(ros::serialization::serializationLength(pool_[i]));
+      }
+    }
+
+  protected:
+    uint64_t Publish(const ros::Time& stamp)
+    {
+      size_t index = next_;
+      next_ = (next_ + 1) % pool_.size();
+
+      // Subscribers in the same process may still hold earlier messages, so
+      // every message published is a new copy.
+      boost::shared_ptr<M> message = boost::make_shared<M>(pool_[index]);
+      SetHeader(*message, stamp, frame_id_);
+      publisher_.publish(boost::shared_ptr<const M>(message));
+      return sizes_[index];
+    }
+
+  private:
+    ros::Publisher publisher_;
+    std::string frame_id_;
+    std::vector<M> pool_;
+    std::vector<uint64_t> sizes_;
+    size_t next_;
+  };
+
+  /**
+   * Publishes the odometry of a vehicle driving in a circle.
+   */
+  class OdometryStream : public Stream
+  {
+  public:
+    OdometryStream(
+        ros::NodeHandle& node,
+        const std::string& topic,
+        double rate,
+        const std::string& frame_id,
+        float area_size) :
+      Stream(topic, rate),
+      frame_id_(frame_id),
+      generator_(0, area_size),
+      start_(ros::Time::now())
+    {
+      publisher_ = node.advertise<nav_msgs::Odometry>(topic, 10);
+    }
+
+  protected:
+    uint64_t Publish(const ros::Time& stamp)
+    {
+      boost::shared_ptr<nav_msgs::Odometry> odometry = boost::make_shared<nav_msgs::Odometry>();
+      generator_.MakeOdometry((stamp - start_).toSec(), *odometry);
+      SetHeader(*odometry, stamp, frame_id_);
+      odometry->child_frame_id = "base_link";
+      publisher_.publish(boost::shared_ptr<const nav_msgs::Odometry>(odometry));
+      return ros::serialization::serializationLength(*odometry);
+    }
+
+  private:
+    ros::Publisher publisher_;
+    std::string frame_id_;
+    mapviz_plugins::SyntheticMessageGenerator generator_;
+    ros::Time start_;
+  };
+
+  struct StreamConfig
+  {
+    std::string topic;
+    double rate;
+    int size;
+    int topics;
+    std::vector<std::string> frame_ids;
+  };
+
+  /**
+   * Reads the common parameters of a stream.  Returns false if the stream is
+   * disabled.
+   */
+  bool ReadStreamConfig(
+      ros::NodeHandle& node,
+      const std::string& name,
+      const std::string& default_topic,
+      double default_rate,
+      int default_size,
+      const std::vector<std::string>& leaf_frames,
+      StreamConfig& config)
+  {
+    node.param(name + "/topic", config.topic, default_topic);
+    node.param(name + "/rate", config.rate, default_rate);
+    node.param(name + "/size", config.size, default_size);
+    node.param(name + "/topics", config.topics, 1);
+    if (config.rate <= 0.0 || config.topics <= 0)
+    {
+      return false;
+    }
+
+    config.frame_ids.clear();
+    std::string frame_id;
+    if (node.getParam(name + "/frame_id", frame_id))
+    {
+      config.frame_ids.push_back(frame_id);
+    }
+    else
+    {
+      config.frame_ids = leaf_frames;
+    }
+    return true;
+  }
+
+  std::string TopicName(const StreamConfig& config, int index)
+  {
+    if (config.topics == 1)
+    {
+      return config.topic;
+    }
+    return config.topic + "_" + std::to_string(index);
+  }
+
+  /**
+   * Spreads the topics of all streams over the frames.
+   */
+  std::string NextFrame(const StreamConfig& config, size_t& counter)
+  {
+    return config.frame_ids[counter++ % config.frame_ids.size()];
+  }
+
+  /**
+   * A tree of frames below the root frame that is broadcast on TF.
+   */
+  class TfTree
+  {
+  public:
+    TfTree(
+        const std::string& root,
+        int depth,
+        int branching,
+        bool moving) :
+      moving_(moving),
+      start_(ros::Time::now())
+    {
+      std::vector<std::string> parents(1, root);
+      for (int level = 1; level <= depth; level++)
+      {
+        std::vector<std::string> children;
+        for (size_t p = 0; p < parents.size(); p++)
+        {
+          for (int c = 0; c < branching; c++)
+          {
+            Frame frame;
+            frame.parent = parents[p];
+            frame.child = "stress_" + std::to_string(level) + "_" + std::to_string(children.size());
+            frame.offset = tf::Vector3(
+                std::cos(2.0 * M_PI * c / branching) * 2.0,
+                std::sin(2.0 * M_PI * c / branching) * 2.0,
+                0.0);
+            frames_.push_back(frame);
+            children.push_back(frame.child);
+          }
+        }
+        parents = children;
+      }
+      leaves_ = parents;
+    }
+
+    const std::vector<std::string>& Leaves() const { return leaves_; }
+
+    size_t Size() const { return frames_.size(); }
+
+    void Broadcast(const ros::WallTimerEvent&)
+    {
+      ros::Time now = ros::Time::now();
+      double yaw = moving_ ? 0.1 * (now - start_).toSec() : 0.0;
+      std::vector<tf::StampedTransform> transforms;
+      transforms.reserve(frames_.size());
+      for (size_t i = 0; i < frames_.size(); i++)
+      {
+        transforms.push_back(tf::StampedTransform(
+            tf::Transform(tf::createQuaternionFromYaw(yaw), frames_[i].offset),
+            now,
+            frames_[i].parent,
+            frames_[i].child));
+      }
+      broadcaster_.sendTransform(transforms);
+    }
+
+  private:
+    struct Frame
+    {
+      std::string parent;
+      std::string child;
+      tf::Vector3 offset;
+    };
+
+    bool moving_;
+    ros::Time start_;
+    std::vector<Frame> frames_;
+    std::vector<std::string> leaves_;
+    tf::TransformBroadcaster broadcaster_;
+  };
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "stress_publisher");
+  ros::NodeHandle node;
+  ros::NodeHandle priv("~");
+
+  std::string root_frame;
+  double area_size;
+  int seed;
+  int pool_size;
+  priv.param("frame_id", root_frame, std::string("map"));
+  priv.param("area_size", area_size, 100.0);
+  priv.param("seed", seed, 0);
+  priv.param("pool_size", pool_size, 4);
+  pool_size = std::max(1, pool_size);
+
+  int tf_depth;
+  int tf_branching;
+  double tf_rate;
+  bool tf_moving;
+  priv.param("tf/depth", tf_depth, 2);
+  priv.param("tf/branching", tf_branching, 2);
+  priv.param("tf/rate", tf_rate, 50.0);
+  priv.param("tf/moving", tf_moving, true);
+  TfTree tf_tree(root_frame, std::max(0, tf_depth), std::max(1, tf_branching), tf_moving);
+  ros::WallTimer tf_timer;
+  std::vector<std::string> leaf_frames = tf_tree.Leaves();
+  if (tf_tree.Size() > 0 && tf_rate > 0.0)
+  {
+    tf_timer = node.createWallTimer(ros::WallDuration(1.0 / tf_rate), &TfTree::Broadcast, &tf_tree);
+  }
+  else
+  {
+    leaf_frames.assign(1, root_frame);
+  }
+
+  mapviz_plugins::SyntheticMessageGenerator generator(seed, area_size);
+  std::vector<StreamPtr> streams;
+  StreamConfig config;
+  size_t frame_counter = 0;
+
+  if (ReadStreamConfig(priv, "pointcloud2", "stress/points", 10.0, 100000, leaf_frames, config))
+  {
+    std::string field_text;
+    priv.param("pointcloud2/fields", field_text, std::string("intensity"));
+    std::vector<mapviz_plugins::SyntheticField> fields;
+    if (!mapviz_plugins::ParseSyntheticFields(field_text, fields))
+    {
+      ROS_FATAL("Invalid point cloud fields: %s", field_text.c_str());
+      return 1;
+    }
+
+    std::vector<sensor_msgs::PointCloud2> pool(pool_size);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      generator.MakePointCloud2(config.size, fields, pool[i]);
+    }
+    for (int i = 0; i < config.topics; i++)
+    {
+      streams.push_back(boost::make_shared<PooledStream<sensor_msgs::PointCloud2> >(
+          node, TopicName(config, i), config.rate, NextFrame(config, frame_counter), pool));
+    }
+  }
+
+  if (ReadStreamConfig(priv, "laserscan", "stress/scan", 40.0, 1081, leaf_frames, config))
+  {
+    std::vector<sensor_msgs::LaserScan> pool(pool_size);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      generator.MakeLaserScan(config.size, pool[i]);
+    }
+    for (int i = 0; i < config.topics; i++)
+    {
+      streams.push_back(boost::make_shared<PooledStream<sensor_msgs::LaserScan> >(
+          node, TopicName(config, i), config.rate, NextFrame(config, frame_counter), pool));
+    }
+  }
+
+  if (ReadStreamConfig(priv, "marker", "stress/markers", 10.0, 1000, leaf_frames, config))
+  {
+    std::string type_text;
+    double lifetime;
+    int points;
+    priv.param("marker/types", type_text, std::string("cube,sphere,arrow,line_strip,text_view_facing"));
+    priv.param("marker/lifetime", lifetime, 0.0);
+    priv.param("marker/points", points, 20);
+
+    std::vector<int32_t> types;
+    std::stringstream stream(type_text);
+    std::string type;
+    while (std::getline(stream, type, ','))
+    {
+      int32_t value = mapviz_plugins::MarkerTypeFromString(type);
+      if (value < 0)
+      {
+        ROS_FATAL("Invalid marker type: %s", type.c_str());
+        return 1;
+      }
+      types.push_back(value);
+    }
+
+    std::vector<visualization_msgs::MarkerArray> pool(pool_size);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      generator.MakeMarkerArray(config.size, types, lifetime, std::max(0, points), "stress", pool[i]);
+    }
+    for (int i = 0; i < config.topics; i++)
+    {
+      streams.push_back(boost::make_shared<PooledStream<visualization_msgs::MarkerArray> >(
+          node, TopicName(config, i), config.rate, NextFrame(config, frame_counter), pool));
+    }
+  }
+
+  if (ReadStreamConfig(priv, "occupancy_grid", "stress/map", 1.0, 1000, leaf_frames, config))
+  {
+    double update_rate;
+    int update_size;
+    priv.param("occupancy_grid/update_rate", update_rate, 10.0);
+    priv.param("occupancy_grid/update_size", update_size, 100);
+
+    std::vector<nav_msgs::OccupancyGrid> pool(pool_size);
+    std::vector<map_msgs::OccupancyGridUpdate> update_pool(pool_size);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      generator.MakeOccupancyGrid(config.size, pool[i]);
+    }
+    for (size_t i = 0; i < update_pool.size(); i++)
+    {
+      generator.MakeOccupancyGridUpdate(pool[0], std::max(1, update_size), update_pool[i]);
+    }
+    for (int i = 0; i < config.topics; i++)
+    {
+      std::string topic = TopicName(config, i);
+      std::string frame_id = NextFrame(config, frame_counter);
+      streams.push_back(boost::make_shared<PooledStream<nav_msgs::OccupancyGrid> >(
+          node, topic, config.rate, frame_id, pool));
+      if (update_rate > 0.0)
+      {
+        streams.push_back(boost::make_shared<PooledStream<map_msgs::OccupancyGridUpdate> >(
+            node, topic + "_updates", update_rate, frame_id, update_pool));
+      }
+    }
+  }
+
+  if (ReadStreamConfig(priv, "path", "stress/path", 5.0, 1000, leaf_frames, config))
+  {
+    std::vector<nav_msgs::Path> pool(pool_size);
+    for (int i = 0; i < config.topics; i++)
+    {
+      std::string frame_id = NextFrame(config, frame_counter);
+      for (size_t j = 0; j < pool.size(); j++)
+      {
+        generator.MakePath(config.size, frame_id, pool[j]);
+      }
+      streams.push_back(boost::make_shared<PooledStream<nav_msgs::Path> >(
+          node, TopicName(config, i), config.rate, frame_id, pool));
+    }
+  }
+
+  if (ReadStreamConfig(priv, "odometry", "stress/odom", 100.0, 1, leaf_frames, config))
+  {
+    for (int i = 0; i < config.topics; i++)
+    {
+      streams.push_back(boost::make_shared<OdometryStream>(
+          node, TopicName(config, i), config.rate, NextFrame(config, frame_counter), area_size));
+    }
+  }
+
+  if (ReadStreamConfig(priv, "image", "stress/image", 30.0, 640, leaf_frames, config))
+  {
+    int height;
+    std::string encoding;
+    priv.param("image/height", height, config.size * 3 / 4);
+    priv.param("image/encoding", encoding, std::string("rgb8"));
+
+    std::vector<sensor_msgs::Image> pool(pool_size);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+      generator.MakeImage(config.size, std::max(1, height), encoding, pool[i]);
+    }
+    for (int i = 0; i < config.topics; i++)
+    {
+      streams.push_back(boost::make_shared<PooledStream<sensor_msgs::Image> >(
+          node, TopicName(config, i), config.rate, NextFrame(config, frame_counter), pool));
+    }
+  }
+
+  if (streams.empty())
+  {
+    ROS_FATAL("All streams are disabled.");
+    return 1;
+  }
+
+  for (size_t i = 0; i < streams.size(); i++)
+  {
+    streams[i]->Start(node);
+  }
+  ROS_INFO("Publishing %zu streams and %zu TF frames.", streams.size(), tf_tree.Size());
+
+  double ramp_period;
+  double ramp_factor;
+  double ramp_max_rate;
+  double report_period;
+  priv.param("ramp/period", ramp_period, 0.0);
+  priv.param("ramp/factor", ramp_factor, 2.0);
+  priv.param("ramp/max_rate", ramp_max_rate, 10000.0);
+  priv.param("report_period", report_period, 5.0);
+
+  // Timers are serviced by a single thread, so the streams can be reported
+  // and ramped without locking.
+  ros::WallTime last_report = ros::WallTime::now();
+  ros::WallTimer report_timer;
+  if (report_period > 0.0)
+  {
+    report_timer = node.createWallTimer(ros::WallDuration(report_period),
+      [&](const ros::WallTimerEvent&)
+      {
+        ros::WallTime now = ros::WallTime::now();
+        double elapsed = (now - last_report).toSec();
+        last_report = now;
+        for (size_t i = 0; i < streams.size(); i++)
+        {
+          streams[i]->Report(elapsed);
+        }
+      });
+  }
+
+  ros::WallTimer ramp_timer;
+  if (ramp_period > 0.0 && ramp_factor > 0.0)
+  {
+    ramp_timer = node.createWallTimer(ros::WallDuration(ramp_period),
+      [&](const ros::WallTimerEvent&)
+      {
+        for (size_t i = 0; i < streams.size(); i++)
+        {
+          streams[i]->SetRate(std::min(ramp_max_rate, streams[i]->Rate() * ramp_factor));
+        }
+        ROS_INFO("Ramped the rates up by a factor of %.2f.", ramp_factor);
+      });
+  }
+
+  ros::spin();
+  return 0;
+}
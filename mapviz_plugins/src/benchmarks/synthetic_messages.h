@@ -0,0 +1,464 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+#ifndef MAPVIZ_PLUGINS_SYNTHETIC_MESSAGES_H_
+#define MAPVIZ_PLUGINS_SYNTHETIC_MESSAGES_H_
+
+// C++ standard libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ROS libraries
+#include <map_msgs/OccupancyGridUpdate.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <nav_msgs/Odometry.h>
+#include <nav_msgs/Path.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/image_encodings.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf/transform_datatypes.h>
+#include <visualization_msgs/MarkerArray.h>
+
+namespace mapviz_plugins
+{
+  /**
+   * An extra PointCloud2 field besides x, y and z.
+   */
+  struct SyntheticField
+  {
+    std::string name;
+    uint8_t datatype;
+  };
+
+  /**
+   * Returns the size in bytes of a sensor_msgs::PointField datatype, or 0 if
+   * the datatype is unknown.
+   */
+  inline uint32_t PointFieldSize(uint8_t datatype)
+  {
+    switch (datatype)
+    {
+      case sensor_msgs::PointField::INT8:
+      case sensor_msgs::PointField::UINT8:
+        return 1;
+      case sensor_msgs::PointField::INT16:
+      case sensor_msgs::PointField::UINT16:
+        return 2;
+      case sensor_msgs::PointField::INT32:
+      case sensor_msgs::PointField::UINT32:
+      case sensor_msgs::PointField::FLOAT32:
+        return 4;
+      case sensor_msgs::PointField::FLOAT64:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
+  /**
+   * Parses a comma separated list of NAME:TYPE fields, e.g.
+   * "intensity:float32,ring:uint16,time:float64".  TYPE defaults to float32.
+   */
+  inline bool ParseSyntheticFields(const std::string& text, std::vector<SyntheticField>& fields)
+  {
+    const char* type_names[] = {
+        "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64"};
+
+    fields.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+      if (item.empty())
+      {
+        continue;
+      }
+
+      SyntheticField field;
+      field.datatype = sensor_msgs::PointField::FLOAT32;
+      size_t colon = item.find(':');
+      field.name = item.substr(0, colon);
+      if (colon != std::string::npos)
+      {
+        std::string type = item.substr(colon + 1);
+        field.datatype = 0;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+          if (type == type_names[i])
+          {
+            field.datatype = i + 1;
+          }
+        }
+        if (field.datatype == 0)
+        {
+          return false;
+        }
+      }
+      fields.push_back(field);
+    }
+    return true;
+  }
+
+  /**
+   * Returns the visualization_msgs::Marker type with the given lowercase
+   * name, e.g. "cube" or "line_strip", or -1 if there is none.
+   */
+  inline int32_t MarkerTypeFromString(const std::string& name)
+  {
+    const char* names[] = {
+        "arrow", "cube", "sphere", "cylinder", "line_strip", "line_list",
+        "cube_list", "sphere_list", "points", "text_view_facing",
+        "mesh_resource", "triangle_list"};
+    for (int32_t i = 0; i < 12; i++)
+    {
+      if (name == names[i])
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * Generates messages filled with random but plausible data spread over a
+   * square of area_size meters around the origin.  The stamps and frames of
+   * the headers are left for the caller to fill in.
+   *
+   * The generator is seeded, so the same sequence of calls always produces
+   * the same messages.
+   */
+  class SyntheticMessageGenerator
+  {
+  public:
+    explicit SyntheticMessageGenerator(uint32_t seed = 0, float area_size = 100.0f) :
+      generator_(seed),
+      area_size_(area_size)
+    {
+    }
+
+    float Random(float min, float max)
+    {
+      return std::uniform_real_distribution<float>(min, max)(generator_);
+    }
+
+    float AreaSize() const { return area_size_; }
+
+    /**
+     * Makes an unorganized cloud of x, y and z followed by the extra fields.
+     */
+    void MakePointCloud2(
+        size_t num_points,
+        const std::vector<SyntheticField>& extra_fields,
+        sensor_msgs::PointCloud2& cloud)
+    {
+      cloud.fields.clear();
+      uint32_t offset = 0;
+      const char* xyz[] = {"x", "y", "z"};
+      for (size_t i = 0; i < 3 + extra_fields.size(); i++)
+      {
+        sensor_msgs::PointField field;
+        field.name = i < 3 ? xyz[i] : extra_fields[i - 3].name;
+        field.datatype = i < 3 ? sensor_msgs::PointField::FLOAT32 : extra_fields[i - 3].datatype;
+        field.offset = offset;
+        field.count = 1;
+        offset += PointFieldSize(field.datatype);
+        cloud.fields.push_back(field);
+      }
+
+      cloud.height = 1;
+      cloud.width = num_points;
+      cloud.point_step = offset;
+      cloud.row_step = cloud.point_step * cloud.width;
+      cloud.is_bigendian = false;
+      cloud.is_dense = true;
+      cloud.data.resize(cloud.row_step);
+
+      const float half = area_size_ / 2;
+      for (size_t i = 0; i < num_points; i++)
+      {
+        uint8_t* point = &cloud.data[i * cloud.point_step];
+        float position[3] = {Random(-half, half), Random(-half, half), Random(0.0f, 5.0f)};
+        memcpy(point, position, sizeof(position));
+        for (size_t f = 3; f < cloud.fields.size(); f++)
+        {
+          WriteField(point + cloud.fields[f].offset, cloud.fields[f].datatype, Random(0.0f, 255.0f));
+        }
+      }
+    }
+
+    void MakeLaserScan(size_t num_beams, sensor_msgs::LaserScan& scan)
+    {
+      scan.angle_min = -M_PI;
+      scan.angle_max = M_PI;
+      scan.angle_increment = 2.0 * M_PI / std::max(num_beams, static_cast<size_t>(1));
+      scan.range_min = 0.1;
+      scan.range_max = area_size_;
+      scan.ranges.resize(num_beams);
+      scan.intensities.resize(num_beams);
+      for (size_t i = 0; i < num_beams; i++)
+      {
+        scan.ranges[i] = Random(1.0f, area_size_ / 2);
+        scan.intensities[i] = Random(0.0f, 255.0f);
+      }
+    }
+
+    /**
+     * Makes count markers that cycle through the given types.  Markers made
+     * of points (line strips, lists and points) get points_per_marker
+     * points each.
+     */
+    void MakeMarkerArray(
+        size_t count,
+        const std::vector<int32_t>& types,
+        double lifetime,
+        size_t points_per_marker,
+        const std::string& ns,
+        visualization_msgs::MarkerArray& markers)
+    {
+      const float half = area_size_ / 2;
+      markers.markers.resize(count);
+      for (size_t i = 0; i < count; i++)
+      {
+        visualization_msgs::Marker& marker = markers.markers[i];
+        marker.ns = ns;
+        marker.id = static_cast<int32_t>(i);
+        marker.type = types.empty() ? visualization_msgs::Marker::CUBE : types[i % types.size()];
+        marker.action = visualization_msgs::Marker::ADD;
+        marker.lifetime = ros::Duration(lifetime);
+        marker.pose.position.x = Random(-half, half);
+        marker.pose.position.y = Random(-half, half);
+        marker.pose.orientation.w = 1.0;
+        marker.scale.x = 0.5;
+        marker.scale.y = 0.5;
+        marker.scale.z = 0.5;
+        marker.color.r = Random(0.0f, 1.0f);
+        marker.color.g = Random(0.0f, 1.0f);
+        marker.color.b = Random(0.0f, 1.0f);
+        marker.color.a = 1.0;
+
+        marker.points.clear();
+        marker.text.clear();
+        switch (marker.type)
+        {
+          case visualization_msgs::Marker::LINE_STRIP:
+          case visualization_msgs::Marker::LINE_LIST:
+          case visualization_msgs::Marker::CUBE_LIST:
+          case visualization_msgs::Marker::SPHERE_LIST:
+          case visualization_msgs::Marker::POINTS:
+          case visualization_msgs::Marker::TRIANGLE_LIST:
+          {
+            marker.scale.x = 0.1;
+            marker.scale.y = 0.1;
+            marker.points.resize(points_per_marker);
+            geometry_msgs::Point point;
+            for (size_t p = 0; p < points_per_marker; p++)
+            {
+              point.x += Random(-1.0f, 1.0f);
+              point.y += Random(-1.0f, 1.0f);
+              marker.points[p] = point;
+            }
+            break;
+          }
+          case visualization_msgs::Marker::TEXT_VIEW_FACING:
+            marker.text = "marker " + std::to_string(i);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    /**
+     * Makes a square grid with side cells per side that covers the area.
+     */
+    void MakeOccupancyGrid(size_t side, nav_msgs::OccupancyGrid& grid)
+    {
+      side = std::max(side, static_cast<size_t>(1));
+      grid.info.width = side;
+      grid.info.height = side;
+      grid.info.resolution = area_size_ / side;
+      grid.info.origin.position.x = -area_size_ / 2;
+      grid.info.origin.position.y = -area_size_ / 2;
+      grid.info.origin.orientation.w = 1.0;
+      grid.data.resize(side * side);
+      for (size_t i = 0; i < grid.data.size(); i++)
+      {
+        grid.data[i] = RandomCell();
+      }
+    }
+
+    /**
+     * Makes an update of a random side x side block of the grid.
+     */
+    void MakeOccupancyGridUpdate(
+        const nav_msgs::OccupancyGrid& grid,
+        size_t side,
+        map_msgs::OccupancyGridUpdate& update)
+    {
+      side = std::min(side, static_cast<size_t>(std::min(grid.info.width, grid.info.height)));
+      update.width = side;
+      update.height = side;
+      update.x = static_cast<int32_t>(Random(0.0f, static_cast<float>(grid.info.width - side)));
+      update.y = static_cast<int32_t>(Random(0.0f, static_cast<float>(grid.info.height - side)));
+      update.data.resize(side * side);
+      for (size_t i = 0; i < update.data.size(); i++)
+      {
+        update.data[i] = RandomCell();
+      }
+    }
+
+    /**
+     * Makes a random walk of num_poses poses.
+     */
+    void MakePath(size_t num_poses, const std::string& frame_id, nav_msgs::Path& path)
+    {
+      const float half = area_size_ / 2;
+      path.poses.resize(num_poses);
+      float x = 0.0f;
+      float y = 0.0f;
+      for (size_t i = 0; i < num_poses; i++)
+      {
+        x = std::max(-half, std::min(half, x + Random(-1.0f, 1.0f)));
+        y = std::max(-half, std::min(half, y + Random(-1.0f, 1.0f)));
+        path.poses[i].header.frame_id = frame_id;
+        path.poses[i].pose.position.x = x;
+        path.poses[i].pose.position.y = y;
+        path.poses[i].pose.orientation.w = 1.0;
+      }
+    }
+
+    /**
+     * Makes the odometry of a vehicle driving around a circle, time seconds
+     * after it started.
+     */
+    void MakeOdometry(double time, nav_msgs::Odometry& odometry)
+    {
+      const double radius = area_size_ / 4;
+      const double speed = 5.0;
+      double angle = speed * time / radius;
+      odometry.pose.pose.position.x = radius * std::cos(angle);
+      odometry.pose.pose.position.y = radius * std::sin(angle);
+      tf::quaternionTFToMsg(tf::createQuaternionFromYaw(angle + M_PI_2), odometry.pose.pose.orientation);
+      odometry.twist.twist.linear.x = speed;
+      odometry.twist.twist.angular.z = speed / radius;
+      for (size_t i = 0; i < 36; i += 7)
+      {
+        odometry.pose.covariance[i] = 0.25;
+        odometry.twist.covariance[i] = 0.01;
+      }
+    }
+
+    /**
+     * Makes an image of random pixels.  The encoding may be any 8 bit
+     * encoding, e.g. mono8, rgb8 or bgra8.
+     */
+    void MakeImage(uint32_t width, uint32_t height, const std::string& encoding, sensor_msgs::Image& image)
+    {
+      image.width = width;
+      image.height = height;
+      image.encoding = encoding;
+      image.is_bigendian = false;
+      image.step = width * sensor_msgs::image_encodings::numChannels(encoding);
+      image.data.resize(image.step * height);
+      std::uniform_int_distribution<int> distribution(0, 255);
+      for (size_t i = 0; i < image.data.size(); i++)
+      {
+        image.data[i] = static_cast<uint8_t>(distribution(generator_));
+      }
+    }
+
+  private:
+    int8_t RandomCell()
+    {
+      // Mostly free space with some obstacles and unknown cells, like a real
+      // map, so that the palette lookups aren't all the same.
+      float value = Random(0.0f, 1.0f);
+      if (value < 0.1f)
+      {
+        return -1;
+      }
+      if (value < 0.25f)
+      {
+        return static_cast<int8_t>(Random(50.0f, 100.0f));
+      }
+      return 0;
+    }
+
+    static void WriteField(uint8_t* data, uint8_t datatype, float value)
+    {
+      switch (datatype)
+      {
+        case sensor_msgs::PointField::INT8:
+          Write<int8_t>(data, value / 2);
+          break;
+        case sensor_msgs::PointField::UINT8:
+          Write<uint8_t>(data, value);
+          break;
+        case sensor_msgs::PointField::INT16:
+          Write<int16_t>(data, value);
+          break;
+        case sensor_msgs::PointField::UINT16:
+          Write<uint16_t>(data, value);
+          break;
+        case sensor_msgs::PointField::INT32:
+          Write<int32_t>(data, value);
+          break;
+        case sensor_msgs::PointField::UINT32:
+          Write<uint32_t>(data, value);
+          break;
+        case sensor_msgs::PointField::FLOAT32:
+          Write<float>(data, value);
+          break;
+        case sensor_msgs::PointField::FLOAT64:
+          Write<double>(data, value);
+          break;
+      }
+    }
+
+    template <class T>
+    static void Write(uint8_t* data, float value)
+    {
+      T typed = static_cast<T>(value);
+      memcpy(data, &typed, sizeof(T));
+    }
+
+    std::mt19937 generator_;
+    float area_size_;
+  };
+}
+
+#endif  // MAPVIZ_PLUGINS_SYNTHETIC_MESSAGES_H_
@@ -256,33 +256,40 @@ namespace mapviz_plugins
     disparity_ = *disparity;
 
     // Colormap and display the disparity image
-    float min_disparity = disparity->min_disparity;
-    float max_disparity = disparity->max_disparity;
-    float multiplier = 255.0f / (max_disparity - min_disparity);
-
     cv_bridge::CvImageConstPtr cv_disparity = 
       cv_bridge::toCvShare(disparity->image, disparity);
 
-    disparity_color_.create(disparity->image.height, disparity->image.width);
+    ColorizeDisparity(cv_disparity->image, disparity->min_disparity, disparity->max_disparity, disparity_color_);
+
+    last_width_ = 0;
+    last_height_ = 0;
 
-    for (int row = 0; row < disparity_color_.rows; row++)
+    has_image_ = true;
+  }
+
+  void DisparityPlugin::ColorizeDisparity(
+      const cv::Mat& disparity,
+      float min_disparity,
+      float max_disparity,
+      cv::Mat_<cv::Vec3b>& color)
+  {
+    float multiplier = 255.0f / (max_disparity - min_disparity);
+
+    color.create(disparity.rows, disparity.cols);
+
+    for (int row = 0; row < color.rows; row++)
     {
-      const float* d = cv_disparity->image.ptr<float>(row);
-      for (int col = 0; col < disparity_color_.cols; col++)
+      const float* d = disparity.ptr<float>(row);
+      for (int col = 0; col < color.cols; col++)
       {
         int index = static_cast<int>((d[col] - min_disparity) * multiplier + 0.5);
         index = std::min(255, std::max(0, index));
         // Fill as BGR
-        disparity_color_(row, col)[2] = COLOR_MAP[3*index + 0];
-        disparity_color_(row, col)[1] = COLOR_MAP[3*index + 1];
-        disparity_color_(row, col)[0] = COLOR_MAP[3*index + 2];
+        color(row, col)[2] = COLOR_MAP[3*index + 0];
+        color(row, col)[1] = COLOR_MAP[3*index + 1];
+        color(row, col)[0] = COLOR_MAP[3*index + 2];
       }
     }
-
-    last_width_ = 0;
-    last_height_ = 0;
-
-    has_image_ = true;
   }
 
   void DisparityPlugin::PrintError(const std::string& message)
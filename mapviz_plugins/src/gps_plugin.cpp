@@ -63,6 +63,8 @@ namespace mapviz_plugins
                      SLOT(SelectTopic()));
     QObject::connect(ui_.topic, SIGNAL(editingFinished()), this,
                      SLOT(TopicEdited()));
+    QObject::connect(this, SIGNAL(ConflateChanged(bool)), this,
+                     SLOT(Resubscribe()));
     QObject::connect(ui_.positiontolerance, SIGNAL(valueChanged(double)), this,
                      SLOT(PositionToleranceChanged(double)));
     QObject::connect(ui_.buffersize, SIGNAL(valueChanged(int)), this,
@@ -107,15 +109,20 @@ namespace mapviz_plugins
       has_message_ = false;
       PrintWarning("No messages received.");
 
-      gps_sub_.shutdown();
-
       topic_ = topic;
-      if (!topic.empty())
-      {
-        gps_sub_ = node_.subscribe(topic_, 10, &GpsPlugin::GPSFixCallback, this);
+      Resubscribe();
+    }
+  }
 
-        ROS_INFO("Subscribing to %s", topic_.c_str());
-      }
+  void GpsPlugin::Resubscribe()
+  {
+    gps_sub_.shutdown();
+
+    if (!topic_.empty())
+    {
+      gps_sub_ = Subscribe(topic_, SubscriberQueueSize(10), &GpsPlugin::GPSFixCallback, this);
+
+      ROS_INFO("Subscribing to %s", topic_.c_str());
     }
   }
 
@@ -157,7 +164,7 @@ namespace mapviz_plugins
 
   void GpsPlugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void GpsPlugin::PrintWarning(const std::string& message)
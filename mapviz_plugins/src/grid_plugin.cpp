@@ -39,6 +39,8 @@
 #include <QGLWidget>
 #include <QPalette>
 
+#include <mapviz/point_transformer.h>
+#include <mapviz/render_batch.h>
 #include <mapviz/select_frame_dialog.h>
 
 // Declare plugin
@@ -54,7 +56,10 @@ namespace mapviz_plugins
     size_(1),
     rows_(1),
     columns_(1),
-    transformed_(false)
+    transformed_(false),
+    lines_(mapviz::RenderBatch::LINES),
+    lines_dirty_(true),
+    lines_in_source_frame_(false)
   {
     ui_.setupUi(config_widget_);
 
@@ -212,40 +217,62 @@ namespace mapviz_plugins
     if (transformed_)
     {
       QColor color = ui_.color->color();
-      
-      glLineWidth(3);
-      glColor4d(color.redF(), color.greenF(), color.blueF(), alpha_);
-      glBegin(GL_LINES);
+      color.setAlphaF(alpha_);
+      if (lines_dirty_ || color != lines_color_)
+      {
+        UpdateLines(color);
+      }
 
-        std::list<tf::Point>::iterator transformed_left_it = transformed_left_points_.begin();
-        std::list<tf::Point>::iterator transformed_right_it = transformed_right_points_.begin();
-        for (; transformed_left_it != transformed_left_points_.end(); ++transformed_left_it)
-        {
-          glVertex2d(transformed_left_it->getX(), transformed_left_it->getY());
-          glVertex2d(transformed_right_it->getX(), transformed_right_it->getY());
+      const bool gl_transform = lines_in_source_frame_ && PushGLTransform(transformer_);
 
-          ++transformed_right_it;
-        }
+      lines_.Draw();
 
-        std::list<tf::Point>::iterator transformed_top_it = transformed_top_points_.begin();
-        std::list<tf::Point>::iterator transformed_bottom_it = transformed_bottom_points_.begin();
-        for (; transformed_top_it != transformed_top_points_.end(); ++transformed_top_it)
-        {
-          glVertex2d(transformed_top_it->getX(), transformed_top_it->getY());
-          glVertex2d(transformed_bottom_it->getX(), transformed_bottom_it->getY());
+      if (gl_transform)
+      {
+        PopGLTransform();
+      }
 
-          ++transformed_bottom_it;
-        }
+      PrintInfo("OK");
+    }
+  }
 
-      glEnd();
+  void GridPlugin::UpdateLines(const QColor& color)
+  {
+    // The lines are built in the grid frame if OpenGL applies the transform.
+    lines_in_source_frame_ = transformer_.IsRigid();
+    const std::list<tf::Point>& left = lines_in_source_frame_ ? left_points_ : transformed_left_points_;
+    const std::list<tf::Point>& right = lines_in_source_frame_ ? right_points_ : transformed_right_points_;
+    const std::list<tf::Point>& top = lines_in_source_frame_ ? top_points_ : transformed_top_points_;
+    const std::list<tf::Point>& bottom = lines_in_source_frame_ ? bottom_points_ : transformed_bottom_points_;
+
+    lines_.Clear();
+    lines_.SetSize(3);
+    lines_.SetColor(color);
+
+    std::list<tf::Point>::const_iterator left_it = left.begin();
+    std::list<tf::Point>::const_iterator right_it = right.begin();
+    for (; left_it != left.end() && right_it != right.end(); ++left_it, ++right_it)
+    {
+      lines_.AddVertex(left_it->getX(), left_it->getY());
+      lines_.AddVertex(right_it->getX(), right_it->getY());
+    }
 
-      PrintInfo("OK");
+    std::list<tf::Point>::const_iterator top_it = top.begin();
+    std::list<tf::Point>::const_iterator bottom_it = bottom.begin();
+    for (; top_it != top.end() && bottom_it != bottom.end(); ++top_it, ++bottom_it)
+    {
+      lines_.AddVertex(top_it->getX(), top_it->getY());
+      lines_.AddVertex(bottom_it->getX(), bottom_it->getY());
     }
+
+    lines_color_ = color;
+    lines_dirty_ = false;
   }
 
   void GridPlugin::RecalculateGrid()
   {
     transformed_ = false;
+    lines_dirty_ = true;
 
     left_points_.clear();
     right_points_.clear();
@@ -288,10 +315,28 @@ namespace mapviz_plugins
 
     if (GetTransform(ros::Time(), transform_))
     {
-      Transform(left_points_, transformed_left_points_);
-      Transform(right_points_, transformed_right_points_);
-      Transform(top_points_, transformed_top_points_);
-      Transform(bottom_points_, transformed_bottom_points_);
+      // Rigid transforms are applied by OpenGL when the grid is drawn, so the
+      // lines only have to be rebuilt if the transform can't be represented
+      // as a matrix.
+      mapviz::PointTransformer transformer(transform_);
+      if (!transformer.Equals(transformer_))
+      {
+        // The grid has moved, so the render cache is out of date.
+        RequestRedraw();
+      }
+      transformer_ = transformer;
+      if (!transformer_.IsRigid())
+      {
+        Transform(left_points_, transformed_left_points_);
+        Transform(right_points_, transformed_right_points_);
+        Transform(top_points_, transformed_top_points_);
+        Transform(bottom_points_, transformed_bottom_points_);
+        lines_dirty_ = true;
+      }
+      else if (!lines_in_source_frame_)
+      {
+        lines_dirty_ = true;
+      }
 
       transformed_ = true;
     }
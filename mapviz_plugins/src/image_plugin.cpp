@@ -311,6 +311,8 @@ namespace mapviz_plugins
 
   void ImagePlugin::imageCallback(const sensor_msgs::ImageConstPtr& image)
   {
+    RecordReceived(image->header.stamp);
+
     if (!has_message_)
     {
       initialized_ = true;
@@ -419,6 +421,16 @@ namespace mapviz_plugins
     PrintInfo("OK");
   }
 
+  mapviz::MemoryStats ImagePlugin::MemoryUsage()
+  {
+    size_t bytes = scaled_image_.total() * scaled_image_.elemSize();
+    if (cv_image_)
+    {
+      bytes += cv_image_->image.total() * cv_image_->image.elemSize();
+    }
+    return mapviz::MemoryStats(bytes, 0);
+  }
+
   void ImagePlugin::Draw(double x, double y, double scale)
   {
     // Calculate the correct offsets and dimensions
@@ -503,6 +515,10 @@ namespace mapviz_plugins
     glRasterPos2d(x_pos, y_pos);
 
     DrawIplImage(&scaled_image_);
+    if (has_image_)
+    {
+      RecordDrawn(image_.header.stamp);
+    }
 
     glPopMatrix();
 
@@ -672,7 +688,7 @@ namespace mapviz_plugins
 
   void ImagePlugin::SetNode(const ros::NodeHandle& node)
   {
-    node_ = node;
+    mapviz::MapvizPlugin::SetNode(node);
 
     // As soon as we have a node, we can find the available image transports
     // and add them to our combo box.
@@ -51,6 +51,8 @@
 #include <swri_transform_util/transform.h>
 #include <swri_yaml_util/yaml_util.h>
 
+#include <mapviz/point_transformer.h>
+#include <mapviz/render_batch.h>
 #include <mapviz/select_topic_dialog.h>
 
 // Declare plugin
@@ -93,6 +95,7 @@ namespace mapviz_plugins
     ui_.color_transformer->addItem(QString("X Axis"), QVariant(3));
     ui_.color_transformer->addItem(QString("Y Axis"), QVariant(4));
     ui_.color_transformer->addItem(QString("Z Axis"), QVariant(5));
+    UpdateColorSettings();
 
     QObject::connect(ui_.selecttopic,
         SIGNAL(clicked()),
@@ -102,6 +105,10 @@ namespace mapviz_plugins
         SIGNAL(editingFinished()),
         this,
         SLOT(TopicEdited()));
+    QObject::connect(this,
+        SIGNAL(ConflateChanged(bool)),
+        this,
+        SLOT(Resubscribe()));
     QObject::connect(ui_.alpha,
         SIGNAL(valueChanged(double)),
         this,
@@ -162,6 +169,10 @@ namespace mapviz_plugins
   void LaserScanPlugin::ClearHistory()
   {
     ROS_DEBUG("LaserScan::ClearHistory()");
+    {
+      QMutexLocker locker(&pending_mutex_);
+      pending_scans_.clear();
+    }
     scans_.clear();
   }
 
@@ -211,7 +222,7 @@ namespace mapviz_plugins
       bool has_intensity)
   {
     double val;
-    int color_transformer = ui_.color_transformer->currentIndex();
+    int color_transformer = color_settings_.color_transformer;
     if (color_transformer == COLOR_RANGE)
     {
       val = point.range;
@@ -234,12 +245,12 @@ namespace mapviz_plugins
     }
     else  // No intensity or  (color_transformer == COLOR_FLAT)
     {
-      return ui_.min_color->color();
+      return color_settings_.min_color;
     }
     if (max_value_ > min_value_)
       val = (val - min_value_) / (max_value_ - min_value_);
     val = std::max(0.0, std::min(val, 1.0));
-    if (ui_.use_rainbow->isChecked())
+    if (color_settings_.use_rainbow)
     {
       // Hue Interpolation
       int hue = static_cast<int>(val * 255);
@@ -247,8 +258,8 @@ namespace mapviz_plugins
     }
     else
     {
-      const QColor min_color = ui_.min_color->color();
-      const QColor max_color = ui_.max_color->color();
+      const QColor& min_color = color_settings_.min_color;
+      const QColor& max_color = color_settings_.max_color;
       // RGB Interpolation
       int red, green, blue;
       red = static_cast<int>(val * max_color.red()   + ((1.0 - val) * min_color.red()));
@@ -260,14 +271,83 @@ namespace mapviz_plugins
 
   void LaserScanPlugin::UpdateColors()
   {
+    UpdateColorSettings();
+    ColorScans();
+  }
+
+  void LaserScanPlugin::UpdateColorSettings()
+  {
+    color_settings_.color_transformer = ui_.color_transformer->currentIndex();
+    color_settings_.use_rainbow = ui_.use_rainbow->isChecked();
+    color_settings_.min_color = ui_.min_color->color();
+    color_settings_.max_color = ui_.max_color->color();
+  }
+
+  void LaserScanPlugin::ColorScans()
+  {
+    const bool z_color = color_settings_.color_transformer == COLOR_Z;
     std::deque<Scan>::iterator scan_it = scans_.begin();
     for (; scan_it != scans_.end(); ++scan_it)
     {
+      // Scans with rigid transforms are transformed by OpenGL, so their
+      // transformed points have to be computed before coloring them by z.
+      if (z_color && scan_it->transformed && scan_it->transformer.IsRigid())
+      {
+        scan_it->transformer.Transform(
+            scan_it->points,
+            &StampedPoint::point,
+            &StampedPoint::transformed_point);
+      }
+
       std::vector<StampedPoint>::iterator point_it = scan_it->points.begin();
       for (; point_it != scan_it->points.end(); point_it++)
       {
         point_it->color = CalculateColor(*point_it, scan_it->has_intensity);
       }
+      UpdateBatchColors(*scan_it);
+    }
+  }
+
+  void LaserScanPlugin::UpdateBatch(Scan& scan)
+  {
+    if (!scan.batch)
+    {
+      scan.batch = boost::make_shared<mapviz::RenderBatch>(mapviz::RenderBatch::POINTS);
+    }
+
+    // Points are added in their source frame if OpenGL applies the transform.
+    const bool gl_transform = scan.transformer.IsRigid();
+
+    scan.batch->Clear();
+    scan.batch->Reserve(scan.points.size());
+    for (const StampedPoint& point: scan.points)
+    {
+      QColor color = point.color;
+      color.setAlphaF(alpha_);
+      scan.batch->SetColor(color);
+      if (gl_transform)
+      {
+        scan.batch->AddVertex(point.point);
+      }
+      else
+      {
+        scan.batch->AddVertex(point.transformed_point.x(), point.transformed_point.y());
+      }
+    }
+  }
+
+  void LaserScanPlugin::UpdateBatchColors(Scan& scan)
+  {
+    if (!scan.batch || scan.batch->Size() != scan.points.size())
+    {
+      return;
+    }
+
+    for (size_t i = 0; i < scan.points.size(); i++)
+    {
+      QColor color = scan.points[i].color;
+      color.setAlphaF(alpha_);
+      scan.batch->SetVertexColor(i, color);
     }
   }
 
@@ -289,22 +369,28 @@ namespace mapviz_plugins
     if (topic != topic_)
     {
       initialized_ = false;
-      scans_.clear();
+      laserscan_sub_.shutdown();
+      ClearHistory();
       has_message_ = false;
       PrintWarning("No messages received.");
 
-      laserscan_sub_.shutdown();
-
       topic_ = topic;
-      if (!topic.empty())
-      {
-        laserscan_sub_ = node_.subscribe(topic_,
-                                         100,
-                                         &LaserScanPlugin::laserScanCallback,
-                                         this);
+      Resubscribe();
+    }
+  }
 
-        ROS_INFO("Subscribing to %s", topic_.c_str());
-      }
+  void LaserScanPlugin::Resubscribe()
+  {
+    laserscan_sub_.shutdown();
+
+    if (!topic_.empty())
+    {
+      laserscan_sub_ = Subscribe(topic_,
+                                 SubscriberQueueSize(100),
+                                 &LaserScanPlugin::laserScanCallback,
+                                 this);
+
+      ROS_INFO("Subscribing to %s", topic_.c_str());
     }
   }
 
@@ -348,16 +434,53 @@ namespace mapviz_plugins
           prev_angle_min_ = msg->angle_min;
           prev_increment_ = msg->angle_increment;
 
-          precomputed_cos_.resize( msg->ranges.size() );
-          precomputed_sin_.resize( msg->ranges.size() );
+          ComputeTrigTables(msg->angle_min, msg->angle_increment, msg->ranges.size(),
+                            precomputed_cos_, precomputed_sin_);
+      }
+  }
 
-          for (size_t i = 0; i < msg->ranges.size(); i++)
-          {
-              double angle = msg->angle_min + msg->angle_increment * i;
-              precomputed_cos_[i] = cos(angle);
-              precomputed_sin_[i] = sin(angle);
-          }
+  void LaserScanPlugin::ComputeTrigTables(
+      float angle_min,
+      float angle_increment,
+      size_t count,
+      std::vector<double>& cos_table,
+      std::vector<double>& sin_table)
+  {
+    cos_table.resize(count);
+    sin_table.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      double angle = angle_min + angle_increment * i;
+      cos_table[i] = cos(angle);
+      sin_table[i] = sin(angle);
+    }
+  }
+
+  void LaserScanPlugin::ConvertRanges(
+      const sensor_msgs::LaserScan& msg,
+      const std::vector<double>& cos_table,
+      const std::vector<double>& sin_table,
+      std::vector<StampedPoint>& points)
+  {
+    double x, y;
+    for (size_t i = 0; i < msg.ranges.size(); i++)
+    {
+      // Discard the point if it's out of range
+      if (msg.ranges[i] > msg.range_max || msg.ranges[i] < msg.range_min)
+      {
+        continue;
       }
+      StampedPoint point;
+      x = cos_table[i] * msg.ranges[i];
+      y = sin_table[i] * msg.ranges[i];
+      point.point = tf::Point(x, y, 0.0f);
+      point.range = msg.ranges[i];
+      if (i < msg.intensities.size())
+        point.intensity = msg.intensities[i];
+
+      points.push_back(point);
+    }
   }
 
   bool LaserScanPlugin::GetScanTransform(const Scan& scan, swri_transform_util::Transform& transform)
@@ -379,53 +502,58 @@ namespace mapviz_plugins
 
   void LaserScanPlugin::laserScanCallback(const sensor_msgs::LaserScanConstPtr& msg)
   {
-    if (!has_message_)
-    {
-      initialized_ = true;
-      has_message_ = true;
-    }
+    // This runs on the plugin's spinner thread, so it only converts the scan
+    // to points.  Transforming and coloring happen on the GUI thread after
+    // the scan is handed off in ProcessPendingScans().
 
     // Note that unlike some plugins, this one does not store nor rely on the
     // source_frame_ member variable.  This one can potentially store many
     // messages with different source frames, so we need to store and transform
     // them individually.
 
+    RecordReceived(msg->header.stamp);
+
     Scan scan;
     scan.stamp = msg->header.stamp;
     scan.color = QColor::fromRgbF(1.0f, 0.0f, 0.0f, 1.0f);
     scan.source_frame_ = msg->header.frame_id;
     scan.has_intensity = !msg->intensities.empty();
+    scan.transformed = false;
     scan.points.reserve( msg->ranges.size() );
 
-    double x, y;
     updatePreComputedTriginometic(msg);
+    ConvertRanges(*msg, precomputed_cos_, precomputed_sin_, scan.points);
 
-    swri_transform_util::Transform transform;
-    scan.transformed = GetScanTransform(scan, transform);
+    {
+      QMutexLocker locker(&pending_mutex_);
+      pending_scans_.push_back(std::move(scan));
+    }
+    QMetaObject::invokeMethod(this, "ProcessPendingScans", Qt::QueuedConnection);
+  }
 
-    for (size_t i = 0; i < msg->ranges.size(); i++)
+  void LaserScanPlugin::ProcessPendingScans()
+  {
+    std::deque<Scan> pending;
     {
-      // Discard the point if it's out of range
-      if (msg->ranges[i] > msg->range_max || msg->ranges[i] < msg->range_min)
-      {
-        continue;
-      }
-      StampedPoint point;
-      x = precomputed_cos_[i] * msg->ranges[i];
-      y = precomputed_sin_[i] * msg->ranges[i];
-      point.point = tf::Point(x, y, 0.0f);
-      point.range = msg->ranges[i];
-      if (i < msg->intensities.size())
-        point.intensity = msg->intensities[i];
+      QMutexLocker locker(&pending_mutex_);
+      pending.swap(pending_scans_);
+    }
 
-      if (scan.transformed)
-      {
-        point.transformed_point = transform * point.point;
-      }
-      point.color = CalculateColor(point, scan.has_intensity);
-      scan.points.push_back(point);
+    if (pending.empty())
+    {
+      return;
+    }
+
+    if (!has_message_)
+    {
+      initialized_ = true;
+      has_message_ = true;
+    }
+
+    for (Scan& scan: pending)
+    {
+      scans_.push_back(std::move(scan));
     }
-    scans_.push_back(scan);
 
     // If there are more items in the scan buffer than buffer_size_, remove them
     if (buffer_size_ > 0)
@@ -435,6 +563,8 @@ namespace mapviz_plugins
         scans_.pop_front();
       }
     }
+
+    RequestRedraw();
   }
 
   void LaserScanPlugin::PrintError(const std::string& message)
@@ -444,7 +574,7 @@ namespace mapviz_plugins
 
   void LaserScanPlugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void LaserScanPlugin::PrintWarning(const std::string& message)
@@ -470,32 +600,27 @@ namespace mapviz_plugins
 
   void LaserScanPlugin::Draw(double x, double y, double scale)
   {
-    glPointSize(point_size_);
-    glBegin(GL_POINTS);
-
     std::deque<Scan>::const_iterator scan_it = scans_.begin();
     while (scan_it != scans_.end())
     {
-      if (scan_it->transformed)
+      if (scan_it->transformed && scan_it->batch)
       {
-        std::vector<StampedPoint>::const_iterator point_it = scan_it->points.begin();
-        for (; point_it != scan_it->points.end(); ++point_it)
+        // Rigid transforms are applied by OpenGL so that the points can stay
+        // in their source frame.
+        const bool gl_transform = PushGLTransform(scan_it->transformer);
+
+        scan_it->batch->SetSize(point_size_);
+        scan_it->batch->Draw();
+        RecordDrawn(scan_it->stamp);
+
+        if (gl_transform)
         {
-          glColor4d(
-              point_it->color.redF(),
-              point_it->color.greenF(),
-              point_it->color.blueF(),
-              alpha_);
-          glVertex2d(
-              point_it->transformed_point.getX(),
-              point_it->transformed_point.getY());
+          PopGLTransform();
         }
       }
       ++scan_it;
     }
 
-    glEnd();
-
     PrintInfo("OK");
   }
 
@@ -518,6 +643,43 @@ namespace mapviz_plugins
     UpdateColors();
   }
 
+  mapviz::MemoryStats LaserScanPlugin::MemoryUsage()
+  {
+    mapviz::MemoryStats usage(
+        mapviz::HeapBytes(precomputed_cos_) + mapviz::HeapBytes(precomputed_sin_), 0);
+    for (const Scan& scan: scans_)
+    {
+      usage += ScanMemoryUsage(scan);
+    }
+
+    QMutexLocker locker(&pending_mutex_);
+    for (const Scan& scan: pending_scans_)
+    {
+      usage += ScanMemoryUsage(scan);
+    }
+    return usage;
+  }
+
+  mapviz::MemoryStats LaserScanPlugin::ScanMemoryUsage(const Scan& scan)
+  {
+    mapviz::MemoryStats usage(sizeof(Scan) + mapviz::HeapBytes(scan.points), 0);
+    if (scan.batch)
+    {
+      usage += scan.batch->MemoryUsage();
+    }
+    return usage;
+  }
+
+  size_t LaserScanPlugin::BufferedElements()
+  {
+    size_t points = 0;
+    for (const Scan& scan: scans_)
+    {
+      points += scan.points.size();
+    }
+    return points;
+  }
+
   void LaserScanPlugin::Transform()
   {
     std::deque<Scan>::iterator scan_it = scans_.begin();
@@ -532,11 +694,24 @@ namespace mapviz_plugins
           if ( GetScanTransform( scan, transform) )
           {
               scan.transformed = true;
+
+              // Rigid transforms are applied by OpenGL when the scan is
+              // drawn, so the points only have to be transformed here if
+              // the transform can't be represented as a matrix.
+              scan.transformer = mapviz::PointTransformer(transform);
+              if (!scan.transformer.IsRigid())
+              {
+                scan.transformer.Transform(
+                    scan.points,
+                    &StampedPoint::point,
+                    &StampedPoint::transformed_point);
+              }
               std::vector<StampedPoint>::iterator point_it = scan.points.begin();
               for (; point_it != scan.points.end(); ++point_it)
               {
-                  point_it->transformed_point = transform * point_it->point;
+                  point_it->color = CalculateColor(*point_it, scan.has_intensity);
               }
+              UpdateBatch(scan);
           }
           else{
               PrintError("No transform between " + scan.source_frame_ + " and " + target_frame_);
@@ -545,9 +720,9 @@ namespace mapviz_plugins
     }
     // Z color is based on transformed color, so it is dependent on the
     // transform
-    if (ui_.color_transformer->currentIndex() == COLOR_Z)
+    if (color_settings_.color_transformer == COLOR_Z)
     {
-      UpdateColors();
+      ColorScans();
     }
   }
 
@@ -679,6 +854,7 @@ namespace mapviz_plugins
   void LaserScanPlugin::AlphaEdited(double val)
   {
     alpha_ = std::max(0.0f, std::min((float)val, 1.0f));
+    UpdateColors();
   }
 
   void LaserScanPlugin::SaveConfig(YAML::Emitter& emitter,
@@ -29,6 +29,10 @@
 
 #include <mapviz_plugins/marker_plugin.h>
 
+#include <algorithm>
+
+#include <mapviz/point_transformer.h>
+#include <mapviz/render_batch.h>
 #include <mapviz/select_topic_dialog.h>
 
 #include <swri_math_util/constants.h>
@@ -112,7 +116,7 @@ namespace mapviz_plugins
       topic_ = topic;
       if (!topic.empty())
       {
-        marker_sub_ = node_.subscribe<topic_tools::ShapeShifter>(
+        marker_sub_ = Subscribe<topic_tools::ShapeShifter>(
             topic_, 100, &MarkerPlugin::handleMessage, this);
 
         ROS_INFO("Subscribing to %s", topic_.c_str());
@@ -125,7 +129,9 @@ namespace mapviz_plugins
     connected_ = true;
     if (IS_INSTANCE(msg, visualization_msgs::Marker))
     {
-      handleMarker(*(msg->instantiate<visualization_msgs::Marker>()));
+      visualization_msgs::MarkerConstPtr marker = msg->instantiate<visualization_msgs::Marker>();
+      RecordReceived(marker->header.stamp);
+      handleMarker(*marker);
     }
     else if (IS_INSTANCE(msg, visualization_msgs::MarkerArray))
     {
@@ -170,6 +176,8 @@ namespace mapviz_plugins
       markerData.scale_z = static_cast<float>(marker.scale.z);
       markerData.transformed = true;
       markerData.source_frame = marker.header.frame_id;
+      markerData.batch_dirty = true;
+      markerData.batch_in_source_frame = false;
 
       if (marker_visible_.emplace(marker.ns, true).second)
       {
@@ -382,10 +390,15 @@ namespace mapviz_plugins
 
   void MarkerPlugin::handleMarkerArray(const visualization_msgs::MarkerArray &markers)
   {
+    // Marker arrays don't have a header of their own, so the newest marker
+    // stands in for the array when measuring latency.
+    ros::Time newest;
     for (unsigned int i = 0; i < markers.markers.size(); i++)
     {
+      newest = std::max(newest, markers.markers[i].header.stamp);
       handleMarker(markers.markers[i]);
     }
+    RecordReceived(newest);
   }
 
   void MarkerPlugin::PrintError(const std::string& message)
@@ -455,142 +468,140 @@ namespace mapviz_plugins
         continue;
       }
 
-      glColor4f(marker.color.r, marker.color.g, marker.color.b, marker.color.a);
-
-      if (marker.display_type == visualization_msgs::Marker::ARROW) {
-        if (marker.points.size() == 1) {
-          // If the marker only has one point, use scale_y as the arrow width.
-          glLineWidth(marker.scale_y);
-        }
-        else {
-          // If the marker has both start and end points explicitly specified, use
-          // scale_x as the shaft diameter.
-          glLineWidth(marker.scale_x);
-        }
-        glBegin(GL_LINES);
-
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
-
-          glVertex2d(
-            point.transformed_point.getX(),
-            point.transformed_point.getY());
-          glVertex2d(
-            point.transformed_arrow_point.getX(),
-            point.transformed_arrow_point.getY());
-          glVertex2d(
-            point.transformed_arrow_point.getX(),
-            point.transformed_arrow_point.getY());
-          glVertex2d(
-            point.transformed_arrow_left.getX(),
-            point.transformed_arrow_left.getY());
-          glVertex2d(
-            point.transformed_arrow_point.getX(),
-            point.transformed_arrow_point.getY());
-          glVertex2d(
-            point.transformed_arrow_right.getX(),
-            point.transformed_arrow_right.getY());
-        }
-
-        glEnd();
+      if (!marker.batch || !IsVisible(marker.bounds)) {
+        markerIter++;
+        continue;
       }
-      else if (marker.display_type == visualization_msgs::Marker::LINE_STRIP) {
-        glLineWidth(std::max(1.0f, marker.scale_x));
-        glBegin(GL_LINE_STRIP);
 
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
+      // Rigid transforms are applied by OpenGL so that the marker only has to
+      // be rebuilt when it changes.
+      const bool gl_transform =
+          marker.batch_in_source_frame && PushGLTransform(marker.transformer);
 
-          glVertex2d(
-            point.transformed_point.getX(),
-            point.transformed_point.getY());
-        }
+      marker.batch->Draw();
+      RecordDrawn(marker.stamp);
 
-        glEnd();
+      if (gl_transform) {
+        PopGLTransform();
       }
-      else if (marker.display_type == visualization_msgs::Marker::LINE_LIST) {
-        glLineWidth(std::max(1.0f, marker.scale_x));
-        glBegin(GL_LINES);
 
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
+      markerIter++;
+      PrintInfo("OK");
+    }
+  }
 
-          glVertex2d(
-            point.transformed_point.getX(),
-            point.transformed_point.getY());
-        }
+  void MarkerPlugin::UpdateBatch(MarkerData& marker, bool source_frame)
+  {
+    if (!marker.batch)
+    {
+      marker.batch = boost::make_shared<mapviz::RenderBatch>();
+    }
+    mapviz::RenderBatch& batch = *marker.batch;
+    batch.Clear();
+
+    // In the marker's frame, points are relative to its pose and OpenGL
+    // applies the rest of the transform; otherwise they are already in the
+    // target frame.
+    auto position = [source_frame](const StampedPoint& point) {
+      return source_frame ? point.point : point.transformed_point;
+    };
+
+    if (marker.display_type == visualization_msgs::Marker::ARROW) {
+      batch.SetPrimitive(mapviz::RenderBatch::LINES);
+      if (marker.points.size() == 1) {
+        // If the marker only has one point, use scale_y as the arrow width.
+        batch.SetSize(marker.scale_y);
+      }
+      else {
+        // If the marker has both start and end points explicitly specified, use
+        // scale_x as the shaft diameter.
+        batch.SetSize(marker.scale_x);
+      }
 
-        glEnd();
+      for (const auto &point : marker.points) {
+        batch.SetColor(point.color.r, point.color.g, point.color.b, point.color.a);
+        batch.AddVertex(point.transformed_point.getX(), point.transformed_point.getY());
+        batch.AddVertex(point.transformed_arrow_point.getX(), point.transformed_arrow_point.getY());
+        batch.AddVertex(point.transformed_arrow_point.getX(), point.transformed_arrow_point.getY());
+        batch.AddVertex(point.transformed_arrow_left.getX(), point.transformed_arrow_left.getY());
+        batch.AddVertex(point.transformed_arrow_point.getX(), point.transformed_arrow_point.getY());
+        batch.AddVertex(point.transformed_arrow_right.getX(), point.transformed_arrow_right.getY());
+      }
+    }
+    else if (marker.display_type == visualization_msgs::Marker::LINE_STRIP ||
+      marker.display_type == visualization_msgs::Marker::LINE_LIST ||
+      marker.display_type == visualization_msgs::Marker::POINTS ||
+      marker.display_type == visualization_msgs::Marker::TRIANGLE_LIST) {
+      if (marker.display_type == visualization_msgs::Marker::LINE_STRIP) {
+        batch.SetPrimitive(mapviz::RenderBatch::LINE_STRIP);
+      }
+      else if (marker.display_type == visualization_msgs::Marker::LINE_LIST) {
+        batch.SetPrimitive(mapviz::RenderBatch::LINES);
       }
       else if (marker.display_type == visualization_msgs::Marker::POINTS) {
-        glPointSize(std::max(1.0f, marker.scale_x));
-        glBegin(GL_POINTS);
-
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
-
-          glVertex2d(
-            point.transformed_point.getX(),
-            point.transformed_point.getY());
-        }
-
-        glEnd();
+        batch.SetPrimitive(mapviz::RenderBatch::POINTS);
       }
-      else if (marker.display_type == visualization_msgs::Marker::TRIANGLE_LIST) {
-        glBegin(GL_TRIANGLES);
-
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
-
-          glVertex2d(
-            point.transformed_point.getX(),
-            point.transformed_point.getY());
-        }
-
-        glEnd();
+      else {
+        batch.SetPrimitive(mapviz::RenderBatch::TRIANGLES);
       }
-      else if (marker.display_type == visualization_msgs::Marker::CYLINDER ||
-        marker.display_type == visualization_msgs::Marker::SPHERE ||
-        marker.display_type == visualization_msgs::Marker::SPHERE_LIST) {
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
-
-          glBegin(GL_TRIANGLE_FAN);
-
-
-          double marker_x = point.transformed_point.getX();
-          double marker_y = point.transformed_point.getY();
+      batch.SetSize(std::max(1.0f, marker.scale_x));
 
-          glVertex2d(marker_x, marker_y);
-
-          for (int32_t i = 0; i <= 360; i += 10) {
-            double radians = static_cast<double>(i) * static_cast<double>(swri_math_util::_deg_2_rad);
-            // Spheres may be specified w/ only one scale value
-            if (marker.scale_y == 0.0) {
-              marker.scale_y = marker.scale_x;
-            }
-            glVertex2d(
-              marker_x + std::sin(radians) * marker.scale_x,
-              marker_y + std::cos(radians) * marker.scale_y);
-          }
+      batch.Reserve(marker.points.size());
+      for (const auto &point : marker.points) {
+        const tf::Point p = position(point);
+        batch.SetColor(point.color.r, point.color.g, point.color.b, point.color.a);
+        batch.AddVertex(p.getX(), p.getY(), source_frame ? p.getZ() : 0.0);
+      }
+    }
+    else if (marker.display_type == visualization_msgs::Marker::CYLINDER ||
+      marker.display_type == visualization_msgs::Marker::SPHERE ||
+      marker.display_type == visualization_msgs::Marker::SPHERE_LIST) {
+      // Spheres may be specified w/ only one scale value
+      if (marker.scale_y == 0.0) {
+        marker.scale_y = marker.scale_x;
+      }
 
-          glEnd();
+      // Each circle is a fan of triangles around its center.
+      batch.SetPrimitive(mapviz::RenderBatch::TRIANGLES);
+      for (const auto &point : marker.points) {
+        const tf::Point p = position(point);
+        const double marker_x = p.getX();
+        const double marker_y = p.getY();
+        const double marker_z = source_frame ? p.getZ() : 0.0;
+
+        batch.SetColor(point.color.r, point.color.g, point.color.b, point.color.a);
+        for (int32_t i = 0; i < 360; i += 10) {
+          double radians = static_cast<double>(i) * static_cast<double>(swri_math_util::_deg_2_rad);
+          double next_radians = static_cast<double>(i + 10) * static_cast<double>(swri_math_util::_deg_2_rad);
+          batch.AddVertex(marker_x, marker_y, marker_z);
+          batch.AddVertex(
+            marker_x + std::sin(radians) * marker.scale_x,
+            marker_y + std::cos(radians) * marker.scale_y,
+            marker_z);
+          batch.AddVertex(
+            marker_x + std::sin(next_radians) * marker.scale_x,
+            marker_y + std::cos(next_radians) * marker.scale_y,
+            marker_z);
         }
       }
-      else if (marker.display_type == visualization_msgs::Marker::CUBE ||
-        marker.display_type == visualization_msgs::Marker::CUBE_LIST) {
-        glBegin(GL_TRIANGLE_FAN);
-        for (const auto &point : marker.points) {
-          glColor4f(point.color.r, point.color.g, point.color.b, point.color.a);
-
-          glVertex2d(point.transformed_point.getX(), point.transformed_point.getY());
+    }
+    else if (marker.display_type == visualization_msgs::Marker::CUBE ||
+      marker.display_type == visualization_msgs::Marker::CUBE_LIST) {
+      // The corners form a fan of triangles around the first one.
+      batch.SetPrimitive(mapviz::RenderBatch::TRIANGLES);
+      for (size_t i = 1; i + 1 < marker.points.size(); i++) {
+        const StampedPoint* corners[] = {
+          &marker.points.front(), &marker.points[i], &marker.points[i + 1]};
+        for (const StampedPoint* corner : corners) {
+          const tf::Point p = position(*corner);
+          batch.SetColor(corner->color.r, corner->color.g, corner->color.b, corner->color.a);
+          batch.AddVertex(p.getX(), p.getY(), source_frame ? p.getZ() : 0.0);
         }
-        glEnd();
       }
-
-      markerIter++;
-      PrintInfo("OK");
     }
+
+    marker.batch_in_source_frame = source_frame;
+    marker.batch_dirty = false;
   }
 
   void MarkerPlugin::Paint(QPainter* painter, double x, double y, double scale)
@@ -641,6 +652,38 @@ namespace mapviz_plugins
     painter->restore();
   }
 
+  mapviz::MemoryStats MarkerPlugin::MemoryUsage()
+  {
+    // Each entry of the map is a node with the key, the data and a pointer,
+    // plus a bucket pointer.
+    const size_t node_size = sizeof(std::pair<const MarkerId, MarkerData>) + 2 * sizeof(void*);
+
+    mapviz::MemoryStats usage;
+    for (auto markerIter = markers_.begin(); markerIter != markers_.end(); ++markerIter)
+    {
+      const MarkerData& marker = markerIter->second;
+      usage.cpu_bytes += node_size +
+          mapviz::HeapBytes(marker.points) +
+          mapviz::HeapBytes(marker.text) +
+          mapviz::HeapBytes(marker.source_frame);
+      if (marker.batch)
+      {
+        usage += marker.batch->MemoryUsage();
+      }
+    }
+    return usage;
+  }
+
+  size_t MarkerPlugin::BufferedElements()
+  {
+    size_t points = 0;
+    for (auto markerIter = markers_.begin(); markerIter != markers_.end(); ++markerIter)
+    {
+      points += markerIter->second.points.size();
+    }
+    return points;
+  }
+
   void MarkerPlugin::Transform()
   {
     for (auto markerIter = markers_.begin(); markerIter != markers_.end(); ++markerIter)
@@ -657,14 +700,37 @@ namespace mapviz_plugins
           // Points for the ARROW marker type are stored a bit differently
           // than other types, so they have their own special transform case.
           transformArrow(marker, transform);
+          UpdateBatch(marker, false);
         }
         else
         {
-          for (auto &point : marker.points)
+          // Rigid transforms are applied by OpenGL when the marker is drawn,
+          // so the marker only has to be rebuilt if it changed or the
+          // transform can't be represented as a matrix.
+          marker.transformer = mapviz::PointTransformer(transform, marker.local_transform);
+          if (marker.transformer.IsRigid())
           {
-            point.transformed_point = transform * (marker.local_transform * point.point);
+            if (marker.batch_dirty || !marker.batch_in_source_frame)
+            {
+              UpdateBatch(marker, true);
+            }
+          }
+          else
+          {
+            marker.transformer.Transform(
+                marker.points,
+                &StampedPoint::point,
+                &StampedPoint::transformed_point);
+            UpdateBatch(marker, false);
           }
         }
+
+        if (marker.batch)
+        {
+          marker.bounds = marker.batch_in_source_frame ?
+              marker.transformer.TransformBounds(marker.batch->Bounds()) :
+              marker.batch->Bounds();
+        }
       }
       else
       {
@@ -698,11 +764,15 @@ namespace mapviz_plugins
       marker_sub_.shutdown();
       if (!topic_.empty())
       {
-        marker_sub_ = node_.subscribe<topic_tools::ShapeShifter>(
+        marker_sub_ = Subscribe<topic_tools::ShapeShifter>(
             topic_, 100, &MarkerPlugin::handleMessage, this);
       }
     }
     connected_ = new_connected;
+
+    // Expired items are only removed when drawing, so make sure that happens
+    // even if no new messages arrive.
+    RequestRedraw();
   }
 }
 
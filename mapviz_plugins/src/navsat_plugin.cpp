@@ -64,6 +64,8 @@ namespace mapviz_plugins
                      SLOT(SelectTopic()));
     QObject::connect(ui_.topic, SIGNAL(editingFinished()), this,
                      SLOT(TopicEdited()));
+    QObject::connect(this, SIGNAL(ConflateChanged(bool)), this,
+                     SLOT(Resubscribe()));
     QObject::connect(ui_.positiontolerance, SIGNAL(valueChanged(double)), this,
                      SLOT(PositionToleranceChanged(double)));
     QObject::connect(ui_.buffersize, SIGNAL(valueChanged(int)), this,
@@ -102,19 +104,25 @@ namespace mapviz_plugins
       has_message_ = false;
       PrintWarning("No messages received.");
 
-      navsat_sub_.shutdown();
       topic_ = topic;
-      if (!topic.empty())
-      {
-        navsat_sub_ = node_.subscribe(topic_, 10, &NavSatPlugin::NavSatFixCallback, this);
+      Resubscribe();
+    }
+  }
 
-        ROS_INFO("Subscribing to %s", topic_.c_str());
-      }
+  void NavSatPlugin::Resubscribe()
+  {
+    navsat_sub_.shutdown();
+
+    if (!topic_.empty())
+    {
+      navsat_sub_ = Subscribe(topic_, SubscriberQueueSize(10), &NavSatPlugin::NavSatFixCallback, this);
+
+      ROS_INFO("Subscribing to %s", topic_.c_str());
     }
   }
 
   void NavSatPlugin::NavSatFixCallback(
-      const sensor_msgs::NavSatFixConstPtr navsat)
+      const sensor_msgs::NavSatFixConstPtr& navsat)
   {
     if (!tf_manager_->LocalXyUtil()->Initialized())
     {
@@ -147,7 +155,7 @@ namespace mapviz_plugins
 
   void NavSatPlugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void NavSatPlugin::PrintWarning(const std::string& message)
@@ -442,6 +442,10 @@ namespace mapviz_plugins
       }
     }
     connected_ = new_connected;
+
+    // Expired items are only removed when drawing, so make sure that happens
+    // even if no new messages arrive.
+    RequestRedraw();
   }
 }
 
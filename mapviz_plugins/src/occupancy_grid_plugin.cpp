@@ -245,10 +245,10 @@ namespace mapviz_plugins
 
     if (!topic.empty())
     {
-      grid_sub_   = node_.subscribe(topic, 10, &OccupancyGridPlugin::Callback, this);
+      grid_sub_   = Subscribe(topic, 10, &OccupancyGridPlugin::Callback, this);
       if( ui_.checkbox_update)
       {
-        update_sub_ = node_.subscribe(topic+ "_updates", 10, &OccupancyGridPlugin::CallbackUpdate, this);
+        update_sub_ = Subscribe(topic+ "_updates", 10, &OccupancyGridPlugin::CallbackUpdate, this);
       }
       ROS_INFO("Subscribing to %s", topic.c_str());
     }
@@ -261,7 +261,7 @@ namespace mapviz_plugins
 
     if( ui_.checkbox_update)
     {
-      update_sub_ = node_.subscribe(topic+ "_updates", 10, &OccupancyGridPlugin::CallbackUpdate, this);
+      update_sub_ = Subscribe(topic+ "_updates", 10, &OccupancyGridPlugin::CallbackUpdate, this);
     }
   }
 
@@ -357,7 +357,10 @@ namespace mapviz_plugins
 
   void OccupancyGridPlugin::Callback(const nav_msgs::OccupancyGridConstPtr& msg)
   {
+    RecordReceived(msg->header.stamp);
+
     grid_ = msg;
+    grid_stamp_ = msg->header.stamp;
     const int width  = grid_->info.width;
     const int height = grid_->info.height;
     initialized_ = true;
@@ -380,16 +383,10 @@ namespace mapviz_plugins
     raw_buffer_.resize(texture_size_*texture_size_, 0);
     color_buffer_.resize(texture_size_*texture_size_*CHANNELS, 0);
 
-    for (size_t row = 0; row < height; row++)
+    if (!grid_->data.empty())
     {
-      for (size_t col = 0; col < width; col++)
-      {
-        size_t index_src = (col + row*width);
-        size_t index_dst = (col + row*texture_size_);
-        uchar color = static_cast<uchar>( grid_->data[ index_src ] );
-        raw_buffer_[index_dst] = color;
-        memcpy( &color_buffer_[index_dst*CHANNELS], &palette[color*CHANNELS], CHANNELS);
-      }
+      ColorizeCells(&grid_->data[0], width, height, width, texture_size_, palette,
+                    &raw_buffer_[0], &color_buffer_[0]);
     }
 
     texture_x_ = static_cast<float>(width) / static_cast<float>(texture_size_);
@@ -399,24 +396,59 @@ namespace mapviz_plugins
     PrintInfo("Map received");
   }
 
+  mapviz::MemoryStats OccupancyGridPlugin::MemoryUsage()
+  {
+    mapviz::MemoryStats usage(mapviz::HeapBytes(raw_buffer_) + mapviz::HeapBytes(color_buffer_), 0);
+    if (grid_)
+    {
+      usage.cpu_bytes += mapviz::HeapBytes(grid_->data);
+    }
+    if (texture_id_ != 0)
+    {
+      usage.gpu_bytes += static_cast<size_t>(texture_size_) * texture_size_ * CHANNELS;
+    }
+    return usage;
+  }
+
+  void OccupancyGridPlugin::ColorizeCells(
+      const int8_t* src,
+      size_t width,
+      size_t height,
+      size_t src_stride,
+      size_t dst_stride,
+      const Palette& palette,
+      uchar* raw,
+      uchar* color)
+  {
+    for (size_t row = 0; row < height; row++)
+    {
+      for (size_t col = 0; col < width; col++)
+      {
+        size_t index_src = (col + row * src_stride);
+        size_t index_dst = (col + row * dst_stride);
+        uchar value = static_cast<uchar>( src[ index_src ] );
+        raw[index_dst] = value;
+        memcpy( &color[index_dst*CHANNELS], &palette[value*CHANNELS], CHANNELS);
+      }
+    }
+  }
+
   void OccupancyGridPlugin::CallbackUpdate(const map_msgs::OccupancyGridUpdateConstPtr &msg)
   {
     PrintInfo("Update Received");
+    RecordReceived(msg->header.stamp);
 
     if( initialized_ )
     {
+      grid_stamp_ = msg->header.stamp;
+
       const Palette& palette = (ui_.color_scheme->currentText() == "map") ?  map_palette_ : costmap_palette_;
 
-      for (size_t row = 0; row < msg->height; row++)
+      if (!msg->data.empty())
       {
-        for (size_t col = 0; col < msg->width; col++)
-        {
-          size_t index_src = (col + row * msg->width);
-          size_t index_dst = ( (col + msg->x) + (row + msg->y)*texture_size_);
-          uchar color = static_cast<uchar>( msg->data[ index_src ] );
-          raw_buffer_[index_dst] = color;
-          memcpy( &color_buffer_[index_dst*CHANNELS], &palette[color*CHANNELS], CHANNELS);
-        }
+        size_t offset = msg->x + msg->y * texture_size_;
+        ColorizeCells(&msg->data[0], msg->width, msg->height, msg->width, texture_size_, palette,
+                      &raw_buffer_[offset], &color_buffer_[offset * CHANNELS]);
       }
       updateTexture();
     }
@@ -476,6 +508,8 @@ namespace mapviz_plugins
 
       glBindTexture(GL_TEXTURE_2D, 0);
       glDisable(GL_TEXTURE_2D);
+
+      RecordDrawn(grid_stamp_);
     }
     glPopMatrix();
   }
@@ -488,6 +522,13 @@ namespace mapviz_plugins
     {
       if( GetTransform( source_frame_, ros::Time(0), transform) )
       {
+        // The grid has moved, so the render cache is out of date.
+        if (!transformed_ ||
+            transform.GetOrigin() != transform_.GetOrigin() ||
+            transform.GetOrientation() != transform_.GetOrientation())
+        {
+          RequestRedraw();
+        }
         transformed_ = true;
         transform_ = transform;
       }
@@ -73,6 +73,8 @@ namespace mapviz_plugins
                      SLOT(SelectTopic()));
     QObject::connect(ui_.topic, SIGNAL(editingFinished()), this,
                      SLOT(TopicEdited()));
+    QObject::connect(this, SIGNAL(ConflateChanged(bool)), this,
+                     SLOT(Resubscribe()));
     QObject::connect(ui_.positiontolerance, SIGNAL(valueChanged(double)), this,
                      SLOT(PositionToleranceChanged(double)));
     QObject::connect(ui_.buffersize, SIGNAL(valueChanged(int)), this,
@@ -121,22 +123,29 @@ namespace mapviz_plugins
       has_message_ = false;
       PrintWarning("No messages received.");
 
-      odometry_sub_.shutdown();
-
       topic_ = topic;
-      if (!topic.empty())
-      {
-        odometry_sub_ = node_.subscribe(
-                    topic_, 10, &OdometryPlugin::odometryCallback, this);
+      Resubscribe();
+    }
+  }
 
-        ROS_INFO("Subscribing to %s", topic_.c_str());
-      }
+  void OdometryPlugin::Resubscribe()
+  {
+    odometry_sub_.shutdown();
+
+    if (!topic_.empty())
+    {
+      odometry_sub_ = Subscribe(
+          topic_, SubscriberQueueSize(10), &OdometryPlugin::odometryCallback, this);
+
+      ROS_INFO("Subscribing to %s", topic_.c_str());
     }
   }
 
   void OdometryPlugin::odometryCallback(
-      const nav_msgs::OdometryConstPtr odometry)
+      const nav_msgs::OdometryConstPtr& odometry)
   {
+    RecordReceived(odometry->header.stamp);
+
     if (!has_message_)
     {
       initialized_ = true;
@@ -204,7 +213,7 @@ namespace mapviz_plugins
 
   void OdometryPlugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void OdometryPlugin::PrintWarning(const std::string& message)
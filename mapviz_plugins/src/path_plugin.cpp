@@ -101,7 +101,7 @@ namespace mapviz_plugins
       topic_ = topic;
       if (!topic.empty())
       {
-        path_sub_ = node_.subscribe(topic_, 1, &PathPlugin::pathCallback, this);
+        path_sub_ = Subscribe(topic_, 1, &PathPlugin::pathCallback, this);
 
         ROS_INFO("Subscribing to %s", topic_.c_str());
       }
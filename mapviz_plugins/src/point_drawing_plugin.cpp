@@ -70,6 +70,32 @@ namespace mapviz_plugins
     points_.clear();
   }
 
+  namespace
+  {
+    size_t PointMemoryUsage(const std::deque<PointDrawingPlugin::StampedPoint>& points)
+    {
+      size_t bytes = mapviz::HeapBytes(points);
+      for (const PointDrawingPlugin::StampedPoint& point: points)
+      {
+        bytes += mapviz::HeapBytes(point.source_frame) +
+            mapviz::HeapBytes(point.cov_points) +
+            mapviz::HeapBytes(point.transformed_cov_points);
+      }
+      return bytes;
+    }
+  }
+
+  mapviz::MemoryStats PointDrawingPlugin::MemoryUsage()
+  {
+    mapviz::MemoryStats usage = batch_.MemoryUsage();
+    usage.cpu_bytes += PointMemoryUsage(points_);
+    for (size_t i = 0; i < laps_.size(); i++)
+    {
+      usage.cpu_bytes += PointMemoryUsage(laps_[i]);
+    }
+    return usage;
+  }
+
   void PointDrawingPlugin::DrawIcon()
   {
     if (icon_)
@@ -278,6 +304,11 @@ namespace mapviz_plugins
       transformed &= DrawLines();
     }
 
+    if (cur_point_.transformed)
+    {
+      RecordDrawn(cur_point_.stamp);
+    }
+
     return transformed;
   }
 
@@ -315,34 +346,45 @@ namespace mapviz_plugins
   bool PointDrawingPlugin::DrawLines()
   {
     bool success = cur_point_.transformed;
-    glColor4d(color_.redF(), color_.greenF(), color_.blueF(), 1.0);
-    if (draw_style_ == LINES && points_.size()>0)
+
+    // Every point has its own transform, so the batch is rebuilt each frame.
+    batch_.Clear();
+    batch_.Reserve(points_.size() + 1);
+    batch_.SetColor(color_.redF(), color_.greenF(), color_.blueF(), 1.0);
+
+    // Points outside of the view can be left out individually, but a line
+    // strip needs all of its points to keep its segments connected.
+    const bool strip = draw_style_ == LINES && points_.size()>0;
+    if (strip)
     {
-      glLineWidth(3);
-      glBegin(GL_LINE_STRIP);
+      batch_.SetPrimitive(mapviz::RenderBatch::LINE_STRIP);
+      batch_.SetSize(3);
     }
     else
     {
-      glPointSize(6);
-      glBegin(GL_POINTS);
+      batch_.SetPrimitive(mapviz::RenderBatch::POINTS);
+      batch_.SetSize(6);
     }
 
     for (const auto& pt : points_)
     {
       success &= pt.transformed;
-      if (pt.transformed)
+      if (pt.transformed && (strip || IsVisible(pt.transformed_point)))
       {
-        glVertex2d(pt.transformed_point.getX(), pt.transformed_point.getY());
+        batch_.AddVertex(pt.transformed_point.getX(), pt.transformed_point.getY());
       }
     }
 
     if (cur_point_.transformed)
     {
-      glVertex2d(cur_point_.transformed_point.getX(),
-                 cur_point_.transformed_point.getY());
+      batch_.AddVertex(cur_point_.transformed_point.getX(),
+                       cur_point_.transformed_point.getY());
     }
 
-    glEnd();
+    if (IsVisible(batch_.Bounds()))
+    {
+      batch_.Draw();
+    }
 
     return success;
   }
@@ -371,20 +413,52 @@ namespace mapviz_plugins
       return false;
   }
 
+  bool PointDrawingPlugin::AddArrow(const StampedPoint& it)
+  {
+    if (it.transformed)
+    {
+      if (!IsVisible(it.transformed_point))
+      {
+        return true;
+      }
+
+      batch_.AddVertex(it.transformed_point.getX(),
+                       it.transformed_point.getY());
+
+      batch_.AddVertex(it.transformed_arrow_point.getX(),
+                       it.transformed_arrow_point.getY());
+
+      batch_.AddVertex(it.transformed_arrow_point.getX(),
+                       it.transformed_arrow_point.getY());
+      batch_.AddVertex(it.transformed_arrow_left.getX(),
+                       it.transformed_arrow_left.getY());
+
+      batch_.AddVertex(it.transformed_arrow_point.getX(),
+                       it.transformed_arrow_point.getY());
+      batch_.AddVertex(it.transformed_arrow_right.getX(),
+                       it.transformed_arrow_right.getY());
+      return true;
+    }
+    return false;
+  }
+
   bool PointDrawingPlugin::DrawArrows()
   {
     bool success = true;
-    glLineWidth(4);
-    glBegin(GL_LINES);
-    glColor4d(color_.redF(), color_.greenF(), color_.blueF(), 0.5);
+
+    batch_.Clear();
+    batch_.Reserve((points_.size() + 1) * 6);
+    batch_.SetPrimitive(mapviz::RenderBatch::LINES);
+    batch_.SetSize(4);
+    batch_.SetColor(color_.redF(), color_.greenF(), color_.blueF(), 0.5);
     for (const auto &pt : points_)
     {
-      success &= DrawArrow(pt);
+      success &= AddArrow(pt);
     }
 
-    success &= DrawArrow(cur_point_);
+    success &= AddArrow(cur_point_);
 
-    glEnd();
+    batch_.Draw();
 
     return success;
   }
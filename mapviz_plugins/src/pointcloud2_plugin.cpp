@@ -33,7 +33,9 @@
 // C++ standard libraries
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <limits>
 #include <vector>
 #include <map>
 
@@ -44,6 +46,8 @@
 #include <QColorDialog>
 #include <QDialog>
 #include <QGLWidget>
+#include <QThread>
+#include <QtConcurrentMap>
 
 // QT Autogenerated
 #include "ui_topic_select.h"
@@ -53,6 +57,7 @@
 #include <swri_transform_util/transform.h>
 #include <swri_yaml_util/yaml_util.h>
 
+#include <mapviz/point_transformer.h>
 #include <mapviz/select_topic_dialog.h>
 
 // Declare plugin
@@ -70,11 +75,15 @@ namespace mapviz_plugins
       min_value_(0.0),
       point_size_(3),
       buffer_size_(1),
-      new_topic_(true),
       has_message_(false),
       num_of_feats_(0),
       need_new_list_(true),
-      need_minmax_(false)
+      need_minmax_(false),
+      automaxmin_clip_(0.0),
+      shader_supported_(true),
+      value_attribute_(-1),
+      palette_texture_(0),
+      palette_dirty_(true)
   {
     ui_.setupUi(config_widget_);
 
@@ -93,6 +102,7 @@ namespace mapviz_plugins
     ui_.max_color->setColor(Qt::black);
     // Set color transformer choices
     ui_.color_transformer->addItem(QString("Flat Color"), QVariant(0));
+    UpdateColorSettings();
 
     QObject::connect(ui_.selecttopic,
                      SIGNAL(clicked()),
@@ -150,6 +160,10 @@ namespace mapviz_plugins
                      SIGNAL(stateChanged(int)),
                      this,
                      SLOT(UseAutomaxminChanged(int)));
+    QObject::connect(ui_.automaxmin_clip,
+                     SIGNAL(valueChanged(double)),
+                     this,
+                     SLOT(AutomaxminClipChanged(double)));
     QObject::connect(ui_.max_color,
                      SIGNAL(colorEdited(const QColor &)),
                      this,
@@ -166,6 +180,10 @@ namespace mapviz_plugins
                      SIGNAL(VisibleChanged(bool)),
                      this,
                      SLOT(SetSubscription(bool)));
+    QObject::connect(this,
+                     SIGNAL(ConflateChanged(bool)),
+                     this,
+                     SLOT(Resubscribe()));
 
     PrintInfo("Constructed PointCloud2Plugin");
   }
@@ -177,7 +195,7 @@ namespace mapviz_plugins
   void PointCloud2Plugin::ClearHistory()
   {
     ROS_DEBUG("PointCloud2Plugin::ClearHistory()");
-    scans_.clear();
+    ClearPointClouds();
   }
 
   void PointCloud2Plugin::DrawIcon()
@@ -220,15 +238,38 @@ namespace mapviz_plugins
     for (Scan& scan: scans_)
     {
       scan.transformed = false;
-      scan.gl_color.clear();
       scan.gl_point.clear();
     }
   }
 
   void PointCloud2Plugin::ClearPointClouds()
   {
-      QMutexLocker locker(&scan_mutex_);
-      scans_.clear();
+    {
+      QMutexLocker locker(&pending_mutex_);
+      pending_scans_.clear();
+    }
+    QMutexLocker locker(&scan_mutex_);
+    for (Scan& scan: scans_)
+    {
+      ReleaseBuffers(scan);
+    }
+    scans_.clear();
+    retired_values_.clear();
+  }
+
+  void PointCloud2Plugin::ReleaseBuffers(Scan& scan)
+  {
+    GLuint ids[] = {scan.point_vbo.id, scan.color_vbo.id, scan.value_vbo.id};
+    for (GLuint id: ids)
+    {
+      if (id != 0)
+      {
+        released_buffers_.push_back(id);
+      }
+    }
+    scan.point_vbo = VertexBuffer();
+    scan.color_vbo = VertexBuffer();
+    scan.value_vbo = VertexBuffer();
   }
 
   void PointCloud2Plugin::SetSubscription(bool subscribe)
@@ -237,41 +278,29 @@ namespace mapviz_plugins
 
     if (subscribe && !topic_.empty())
     {
-      pc2_sub_ = node_.subscribe(topic_, 10, &PointCloud2Plugin::PointCloud2Callback, this);
-      new_topic_ = true;
+      pc2_sub_ = Subscribe(topic_, SubscriberQueueSize(10), &PointCloud2Plugin::PointCloud2Callback, this);
       need_new_list_ = true;
-      max_.clear();
-      min_.clear();
+
+      QMutexLocker locker(&scan_mutex_);
+      retired_values_.clear();
     }
   }
 
-  QColor PointCloud2Plugin::CalculateColor(const StampedPoint& point)
+  void PointCloud2Plugin::Resubscribe()
   {
-    float val;
-    unsigned int color_transformer = static_cast<unsigned int>(ui_.color_transformer->currentIndex());
-    unsigned int transformer_index = color_transformer -1;
-    if (num_of_feats_ > 0 && color_transformer > 0)
-    {
-      val = point.features[transformer_index];
-      if (need_minmax_)
-      {
-        if (val > max_[transformer_index])
-        {
-          max_[transformer_index] = val;
-        }
+    SetSubscription(Visible());
+  }
 
-        if (val < min_[transformer_index])
-        {
-          min_[transformer_index] = val;
-        }
-      }
-    }
-    else  // No intensity or  (color_transformer == COLOR_FLAT)
+  QColor PointCloud2Plugin::CalculateColor(float val)
+  {
+    unsigned int color_transformer = static_cast<unsigned int>(color_settings_.color_transformer);
+    if (num_of_feats_ == 0 || color_transformer == 0)
     {
-      return ui_.min_color->color();
+      // No intensity or  (color_transformer == COLOR_FLAT)
+      return color_settings_.min_color;
     }
 
-    if (ui_.unpack_rgb->isChecked())
+    if (color_settings_.unpack_rgb)
     {
         uint8_t* pixelColor = reinterpret_cast<uint8_t*>(&val);
         return QColor(pixelColor[2], pixelColor[1], pixelColor[0], 255);
@@ -283,13 +312,34 @@ namespace mapviz_plugins
     }
     val = std::max(0.0f, std::min(val, 1.0f));
 
-    if (ui_.use_automaxmin->isChecked())
+    return MapColor(val, color_settings_.use_rainbow, color_settings_.min_color, color_settings_.max_color);
+  }
+
+  void PointCloud2Plugin::MakePalette(
+      bool rainbow,
+      const QColor& min_color,
+      const QColor& max_color,
+      size_t size,
+      std::vector<uint8_t>& palette)
+  {
+    palette.resize(size * 4);
+    for (size_t i = 0; i < size; i++)
     {
-      max_value_ = max_[transformer_index];
-      min_value_ = min_[transformer_index];
+      const QColor color = MapColor(static_cast<float>(i) / (size - 1), rainbow, min_color, max_color);
+      palette[i * 4] = static_cast<uint8_t>(color.red());
+      palette[i * 4 + 1] = static_cast<uint8_t>(color.green());
+      palette[i * 4 + 2] = static_cast<uint8_t>(color.blue());
+      palette[i * 4 + 3] = 255;
     }
+  }
 
-    if (ui_.use_rainbow->isChecked())
+  QColor PointCloud2Plugin::MapColor(
+      float val,
+      bool rainbow,
+      const QColor& min_color,
+      const QColor& max_color)
+  {
+    if (rainbow)
     {  // Hue Interpolation
 
       int hue = (int)(val * 255.0);
@@ -297,8 +347,6 @@ namespace mapviz_plugins
     }
     else
     {
-      const QColor min_color = ui_.min_color->color();
-      const QColor max_color = ui_.max_color->color();
       // RGB Interpolation
       int red, green, blue;
       red = (int)(val * max_color.red() + ((1.0 - val) * min_color.red()));
@@ -321,25 +369,160 @@ namespace mapviz_plugins
     return -1;
   }
 
+  void PointCloud2Plugin::DecodeValues(Scan& scan, const std::string& field)
+  {
+    scan.value_field = field;
+    scan.values.clear();
+    scan.value_summary = ValueSummary();
+
+    std::map<std::string, FieldInfo>::const_iterator feature = scan.new_features.find(field);
+    if (feature == scan.new_features.end() || !scan.msg || scan.msg->data.empty())
+    {
+      return;
+    }
+
+    const size_t num_points = scan.positions.size() / 3;
+    scan.values.resize(num_points);
+    DecodeField(&scan.msg->data.front(), num_points, scan.msg->point_step, feature->second, &scan.values[0]);
+    if (num_points > 0)
+    {
+      scan.value_summary = SummarizeValues(&scan.values[0], num_points);
+    }
+  }
+
+  void PointCloud2Plugin::UpdateScanValues(Scan& scan, const std::string& field)
+  {
+    // Only one field is decoded at a time, so a scan that was decoded for
+    // another color transformer has to be decoded again.
+    if (scan.value_field != field)
+    {
+      DecodeValues(scan, field);
+      scan.value_vbo.dirty = true;
+      scan.colored = false;
+    }
+  }
+
+  void PointCloud2Plugin::UpdateScanColors(Scan& scan, const std::string& field)
+  {
+    UpdateScanValues(scan, field);
+
+    scan.colored = true;
+    if (UseShader(field) && !scan.values.empty())
+    {
+      // The shader applies the color settings, so only the values are
+      // uploaded.
+      scan.shaded = true;
+      std::vector<uint8_t>().swap(scan.gl_color);
+      return;
+    }
+
+    const size_t num_points = scan.positions.size() / 3;
+    scan.shaded = false;
+    scan.color_vbo.dirty = true;
+    scan.gl_color.clear();
+    scan.gl_color.reserve(num_points * 4);
+    for (size_t i = 0; i < num_points; i++)
+    {
+      const QColor color = scan.values.empty() ? color_settings_.min_color : CalculateColor(scan.values[i]);
+      scan.gl_color.push_back( color.red());
+      scan.gl_color.push_back( color.green());
+      scan.gl_color.push_back( color.blue());
+      scan.gl_color.push_back( static_cast<uint8_t>(alpha_ * 255.0 ) );
+    }
+  }
+
+  void PointCloud2Plugin::UpdateValueRange(const std::string& field)
+  {
+    // Only the summaries of the scans are combined, so this doesn't depend
+    // on the number of points.
+    ValueSummary summary;
+    std::map<std::string, ValueSummary>::const_iterator retired = retired_values_.find(field);
+    if (retired != retired_values_.end())
+    {
+      summary = retired->second;
+    }
+    for (const Scan& scan: scans_)
+    {
+      if (scan.value_field == field)
+      {
+        summary.Merge(scan.value_summary);
+      }
+    }
+
+    if (summary.count == 0)
+    {
+      return;
+    }
+
+    if (automaxmin_clip_ > 0.0)
+    {
+      min_value_ = summary.Percentile(automaxmin_clip_);
+      max_value_ = summary.Percentile(1.0 - automaxmin_clip_);
+    }
+    else
+    {
+      min_value_ = summary.min;
+      max_value_ = summary.max;
+    }
+  }
+
+  void PointCloud2Plugin::RetireValues(const Scan& scan)
+  {
+    if (!scan.value_field.empty() && scan.value_summary.count > 0)
+    {
+      retired_values_[scan.value_field].Merge(scan.value_summary);
+    }
+  }
+
   void PointCloud2Plugin::UpdateColors()
   {
+    const std::string field = ColorField();
     {
       QMutexLocker locker(&scan_mutex_);
+      UpdateColorSettings();
+      palette_dirty_ = true;
+
+      if (need_minmax_)
+      {
+        for (Scan& scan: scans_)
+        {
+          UpdateScanValues(scan, field);
+        }
+        UpdateValueRange(field);
+      }
+
+      // Scans that are colored by the shader only have to be touched if
+      // they have to be decoded again.
       for (Scan& scan: scans_)
       {
-        scan.gl_color.clear();
-        scan.gl_color.reserve(scan.points.size()*4);
-        for (const StampedPoint& point: scan.points)
+        if (!scan.colored || !scan.shaded || scan.value_field != field || !UseShader(field))
         {
-          const QColor color = CalculateColor(point);
-          scan.gl_color.push_back( color.red());
-          scan.gl_color.push_back( color.green());
-          scan.gl_color.push_back( color.blue());
-          scan.gl_color.push_back( static_cast<uint8_t>(alpha_ * 255.0 ) );
+          UpdateScanColors(scan, field);
         }
       }
     }
-    canvas_->update();
+    RequestRedraw();
+  }
+
+  bool PointCloud2Plugin::UseShader(const std::string& field)
+  {
+    // Packed RGB values can't be unpacked by the shader.
+    return shader_supported_ && !field.empty() && !color_settings_.unpack_rgb;
+  }
+
+  void PointCloud2Plugin::UpdateColorSettings()
+  {
+    color_settings_.color_transformer = ui_.color_transformer->currentIndex();
+    color_settings_.use_rainbow = ui_.use_rainbow->isChecked();
+    color_settings_.unpack_rgb = ui_.unpack_rgb->isChecked();
+    color_settings_.min_color = ui_.min_color->color();
+    color_settings_.max_color = ui_.max_color->color();
+  }
+
+  std::string PointCloud2Plugin::ColorField()
+  {
+    QMutexLocker locker(&pending_mutex_);
+    return color_field_;
   }
 
   void PointCloud2Plugin::SelectTopic()
@@ -361,10 +544,7 @@ namespace mapviz_plugins
     if (topic != topic_)
     {
       initialized_ = false;
-      {
-        QMutexLocker locker(&scan_mutex_);
-        scans_.clear();
-      }
+      ClearPointClouds();
       has_message_ = false;
       PrintWarning("No messages received.");
 
@@ -394,65 +574,44 @@ namespace mapviz_plugins
       QMutexLocker locker(&scan_mutex_);
       while (scans_.size() > buffer_size_)
       {
+        RetireValues(scans_.front());
+        ReleaseBuffers(scans_.front());
         scans_.pop_front();
       }
     }
 
-    canvas_->update();
+    RequestRedraw();
   }
 
   void PointCloud2Plugin::PointSizeChanged(int value)
   {
     point_size_ = (size_t)value;
 
-    canvas_->update();
+    RequestRedraw();
   }
 
   void PointCloud2Plugin::PointCloud2Callback(const sensor_msgs::PointCloud2ConstPtr& msg)
   {
-    if (!has_message_)
-    {
-      initialized_ = true;
-      has_message_ = true;
-    }
+    // This runs on the plugin's spinner thread, so it only decodes the
+    // message.  Anything that needs Qt widgets, OpenGL or tf is done on the
+    // GUI thread after the scan is handed off in ProcessPendingScans().
 
     // Note that unlike some plugins, this one does not store nor rely on the
     // source_frame_ member variable.  This one can potentially store many
     // messages with different source frames, so we need to store and transform
     // them individually.
 
-    Scan scan;
-    {
-        // recycle already allocated memory, reusing an old scan
-      QMutexLocker locker(&scan_mutex_);
-      if (buffer_size_ > 0 )
-      {
-          if( scans_.size() >= buffer_size_)
-          {
-              scan = std::move( scans_.front() );
-          }
-          else{
-             glGenBuffers(1, &scan.color_vbo);
-             glGenBuffers(1, &scan.point_vbo);
-          }
-          while (scans_.size() >= buffer_size_)
-          {
-            scans_.pop_front();
-          }
-      }
-    }
+    RecordReceived(msg->header.stamp);
 
+    Scan scan;
     scan.stamp = msg->header.stamp;
     scan.color = QColor::fromRgbF(1.0f, 0.0f, 0.0f, 1.0f);
+    scan.msg = msg;
     scan.source_frame = msg->header.frame_id;
-    scan.transformed = true;
-
-    swri_transform_util::Transform transform;
-    if (!GetTransform(scan.source_frame, msg->header.stamp, transform))
-    {
-      scan.transformed = false;
-      PrintError("No transform between " + scan.source_frame + " and " + target_frame_);
-    }
+    scan.transformed = false;
+    scan.colored = false;
+    scan.shaded = false;
+    scan.point_components = 0;
 
     int32_t xi = findChannelIndex(msg, "x");
     int32_t yi = findChannelIndex(msg, "y");
@@ -463,117 +622,352 @@ namespace mapviz_plugins
       return;
     }
 
-    if (new_topic_)
+    for (size_t i = 0; i < msg->fields.size(); ++i)
     {
-      for (size_t i = 0; i < msg->fields.size(); ++i)
-      {
-        FieldInfo input;
-        std::string name = msg->fields[i].name;
+      FieldInfo input;
+      std::string name = msg->fields[i].name;
+
+      uint32_t offset_value = msg->fields[i].offset;
+      uint8_t datatype_value = msg->fields[i].datatype;
+      input.offset = offset_value;
+      input.datatype = datatype_value;
+      scan.new_features.insert(std::pair<std::string, FieldInfo>(name, input));
+    }
 
-        uint32_t offset_value = msg->fields[i].offset;
-        uint8_t datatype_value = msg->fields[i].datatype;
-        input.offset = offset_value;
-        input.datatype = datatype_value;
-        scan.new_features.insert(std::pair<std::string, FieldInfo>(name, input));
+    // Only the coordinates and the field the points are colored by are
+    // decoded; the other fields are read from the message if the color
+    // transformer changes.
+    if (!msg->data.empty() && msg->point_step > 0)
+    {
+      const size_t num_points = msg->data.size() / msg->point_step;
+      scan.positions.resize(num_points * 3);
+      if (num_points > 0)
+      {
+        scan.source_bounds = DecodePositions(
+            &msg->data.front(),
+            num_points,
+            msg->point_step,
+            scan.new_features[msg->fields[xi].name],
+            scan.new_features[msg->fields[yi].name],
+            scan.new_features[msg->fields[zi].name],
+            &scan.positions[0]);
       }
+    }
+    DecodeValues(scan, ColorField());
 
-      new_topic_ = false;
-      num_of_feats_ = scan.new_features.size();
+    {
+      QMutexLocker locker(&pending_mutex_);
+      pending_scans_.push_back( std::move(scan) );
+    }
+    QMetaObject::invokeMethod(this, "ProcessPendingScans", Qt::QueuedConnection);
+  }
 
-      max_.resize(num_of_feats_);
-      min_.resize(num_of_feats_);
+  void PointCloud2Plugin::ProcessPendingScans()
+  {
+    std::deque<Scan> pending;
+    {
+      QMutexLocker locker(&pending_mutex_);
+      pending.swap(pending_scans_);
+    }
 
-      int label = 1;
-      if (need_new_list_)
-      {
-        int new_feature_index = ui_.color_transformer->currentIndex();
-        std::map<std::string, FieldInfo>::const_iterator it;
-        for (it = scan.new_features.begin(); it != scan.new_features.end(); ++it)
-        {
-          ui_.color_transformer->removeItem(static_cast<int>(num_of_feats_));
-          num_of_feats_--;
-        }
+    if (pending.empty())
+    {
+      return;
+    }
+
+    if (!has_message_)
+    {
+      initialized_ = true;
+      has_message_ = true;
+    }
+
+    UpdateFeatures(pending.back().new_features);
 
-        for (it = scan.new_features.begin(); it != scan.new_features.end(); ++it)
+    {
+      QMutexLocker locker(&scan_mutex_);
+      for (Scan& scan: pending)
+      {
+        if (buffer_size_ > 0 && scans_.size() >= buffer_size_)
         {
-          std::string const field = it->first;
-          if (field == saved_color_transformer_)
+          // Recycle the buffer objects of the scan that is being evicted;
+          // they are filled again the next time the new scan is drawn.
+          scan.point_vbo = scans_.front().point_vbo;
+          scan.color_vbo = scans_.front().color_vbo;
+          scan.value_vbo = scans_.front().value_vbo;
+          scan.point_vbo.dirty = true;
+          scan.color_vbo.dirty = true;
+          scan.value_vbo.dirty = true;
+          RetireValues(scans_.front());
+          scans_.pop_front();
+          while (scans_.size() >= buffer_size_)
           {
-            // The very first time we see a new set of features, that means the
-            // plugin was just created; if we have a saved value, set the current
-            // index to that and clear the saved value.
-            new_feature_index = label;
-            saved_color_transformer_ = "";
+            RetireValues(scans_.front());
+            ReleaseBuffers(scans_.front());
+            scans_.pop_front();
           }
+        }
+        scans_.push_back( std::move(scan) );
+      }
+    }
+
+    // The new scans are transformed and colored in Transform(), which is
+    // called before they are drawn.
+    RequestRedraw();
+  }
 
-          ui_.color_transformer->addItem(QString::fromStdString(field), QVariant(label));
-          num_of_feats_++;
-          label++;
+  void PointCloud2Plugin::UpdateFeatures(const std::map<std::string, FieldInfo>& features)
+  {
+    num_of_feats_ = features.size();
+
+    int label = 1;
+    if (need_new_list_)
+    {
+      int new_feature_index = ui_.color_transformer->currentIndex();
+      std::map<std::string, FieldInfo>::const_iterator it;
+      for (it = features.begin(); it != features.end(); ++it)
+      {
+        ui_.color_transformer->removeItem(static_cast<int>(num_of_feats_));
+        num_of_feats_--;
+      }
 
+      for (it = features.begin(); it != features.end(); ++it)
+      {
+        std::string const field = it->first;
+        if (field == saved_color_transformer_)
+        {
+          // The very first time we see a new set of features, that means the
+          // plugin was just created; if we have a saved value, set the current
+          // index to that and clear the saved value.
+          new_feature_index = label;
+          saved_color_transformer_ = "";
         }
-        ui_.color_transformer->setCurrentIndex(new_feature_index);
-        need_new_list_ = false;
+
+        ui_.color_transformer->addItem(QString::fromStdString(field), QVariant(label));
+        num_of_feats_++;
+        label++;
+
       }
+      ui_.color_transformer->setCurrentIndex(new_feature_index);
+      need_new_list_ = false;
     }
+  }
 
-    if (!msg->data.empty())
+  namespace
+  {
+    // Clouds are decoded in parallel in chunks of at least this many points,
+    // so small clouds are decoded on the calling thread.
+    const size_t MIN_CHUNK_POINTS = 65536;
+
+    struct PointRange
     {
-      const uint8_t* ptr = &msg->data.front();
-      const uint32_t point_step = msg->point_step;
-      const uint32_t xoff = msg->fields[xi].offset;
-      const uint32_t yoff = msg->fields[yi].offset;
-      const uint32_t zoff = msg->fields[zi].offset;
-      const size_t num_points = msg->data.size() / point_step;
-      const size_t num_features = scan.new_features.size();
-      scan.points.resize(num_points);
+      size_t begin;
+      size_t end;
+      mapviz::BoundingBox bounds;
+    };
 
-      std::vector<FieldInfo> field_infos;
-      field_infos.reserve(num_features);
-      for (auto it = scan.new_features.begin(); it != scan.new_features.end(); ++it)
+    std::vector<PointRange> SplitPoints(size_t num_points)
+    {
+      const size_t max_chunks = static_cast<size_t>(std::max(1, QThread::idealThreadCount()));
+      const size_t chunks = std::min(max_chunks, std::max<size_t>(1, num_points / MIN_CHUNK_POINTS));
+      std::vector<PointRange> ranges(chunks);
+      for (size_t i = 0; i < chunks; i++)
       {
-        field_infos.push_back(it->second);
+        ranges[i].begin = num_points * i / chunks;
+        ranges[i].end = num_points * (i + 1) / chunks;
       }
+      return ranges;
+    }
 
-      scan.gl_point.clear();
-      scan.gl_point.reserve(num_points*2);
-      scan.gl_color.clear();
-      scan.gl_color.reserve(num_points*4);
+    template <class Function>
+    void ForEachRange(std::vector<PointRange>& ranges, Function function)
+    {
+      if (ranges.size() == 1)
+      {
+        function(ranges.front());
+      }
+      else
+      {
+        QtConcurrent::blockingMap(ranges, function);
+      }
+    }
 
-      for (size_t i = 0; i < num_points; i++, ptr += point_step)
+    // Reads a value that may not be aligned.  The memcpy compiles to a
+    // single load.
+    template <class T>
+    inline float Load(const uint8_t* ptr)
+    {
+      T value;
+      memcpy(&value, ptr, sizeof(T));
+      return static_cast<float>(value);
+    }
+
+    // The extent of the points in one range.  Points with NaN coordinates
+    // don't change it.
+    class RangeBounds
+    {
+    public:
+      RangeBounds() :
+        min_x_(std::numeric_limits<float>::max()),
+        min_y_(std::numeric_limits<float>::max()),
+        min_z_(std::numeric_limits<float>::max()),
+        max_x_(-std::numeric_limits<float>::max()),
+        max_y_(-std::numeric_limits<float>::max()),
+        max_z_(-std::numeric_limits<float>::max())
       {
-        float x = *reinterpret_cast<const float*>(ptr + xoff);
-        float y = *reinterpret_cast<const float*>(ptr + yoff);
-        float z = *reinterpret_cast<const float*>(ptr + zoff);
+      }
 
-        StampedPoint& point = scan.points[i];
-        point.point = tf::Point(x, y, z);
+      void Add(const float* xyz)
+      {
+        min_x_ = std::min(min_x_, xyz[0]);
+        min_y_ = std::min(min_y_, xyz[1]);
+        min_z_ = std::min(min_z_, xyz[2]);
+        max_x_ = std::max(max_x_, xyz[0]);
+        max_y_ = std::max(max_y_, xyz[1]);
+        max_z_ = std::max(max_z_, xyz[2]);
+      }
+
+      mapviz::BoundingBox Box() const
+      {
+        mapviz::BoundingBox box;
+        if (min_x_ <= max_x_ && min_y_ <= max_y_ && min_z_ <= max_z_)
+        {
+          box.Add(min_x_, min_y_, min_z_);
+          box.Add(max_x_, max_y_, max_z_);
+        }
+        return box;
+      }
 
-        point.features.resize(num_features);
+    private:
+      float min_x_;
+      float min_y_;
+      float min_z_;
+      float max_x_;
+      float max_y_;
+      float max_z_;
+    };
+
+    // Float32 coordinates that are next to each other, as in the clouds from
+    // most lidars and depth cameras, are copied with one fixed size memcpy.
+    void DecodePackedXYZ(const uint8_t* data, uint32_t point_step, uint32_t offset, PointRange& range, float* positions)
+    {
+      RangeBounds bounds;
+      const uint8_t* ptr = data + range.begin * point_step + offset;
+      float* xyz = positions + range.begin * 3;
+      for (size_t i = range.begin; i < range.end; i++, ptr += point_step, xyz += 3)
+      {
+        memcpy(xyz, ptr, 3 * sizeof(float));
+        bounds.Add(xyz);
+      }
+      range.bounds = bounds.Box();
+    }
 
-        for (int count=0; count < field_infos.size(); count++)
+    template <class T>
+    void DecodeXYZ(
+        const uint8_t* data,
+        uint32_t point_step,
+        uint32_t x_offset,
+        uint32_t y_offset,
+        uint32_t z_offset,
+        PointRange& range,
+        float* positions)
+    {
+      RangeBounds bounds;
+      const uint8_t* ptr = data + range.begin * point_step;
+      float* xyz = positions + range.begin * 3;
+      for (size_t i = range.begin; i < range.end; i++, ptr += point_step, xyz += 3)
+      {
+        xyz[0] = Load<T>(ptr + x_offset);
+        xyz[1] = Load<T>(ptr + y_offset);
+        xyz[2] = Load<T>(ptr + z_offset);
+        bounds.Add(xyz);
+      }
+      range.bounds = bounds.Box();
+    }
+
+    template <class T>
+    void DecodeFieldAs(const uint8_t* data, size_t num_points, uint32_t point_step, uint32_t offset, float* values)
+    {
+      std::vector<PointRange> ranges = SplitPoints(num_points);
+      ForEachRange(ranges, [=](PointRange& range)
+      {
+        const uint8_t* ptr = data + range.begin * point_step + offset;
+        for (size_t i = range.begin; i < range.end; i++, ptr += point_step)
         {
-          point.features[count] = PointFeature(ptr, field_infos[count]);
+          values[i] = Load<T>(ptr);
         }
-        if (scan.transformed)
+      });
+    }
+
+    // Number of bins in the histogram of a ValueSummary
+    const size_t HISTOGRAM_BINS = 1024;
+
+    inline float HistogramScale(float min, float max)
+    {
+      return max > min ? HISTOGRAM_BINS / (max - min) : 0.0f;
+    }
+
+    inline size_t HistogramBin(float value, float min, float scale)
+    {
+      const float bin = (value - min) * scale;
+      return bin < HISTOGRAM_BINS ? static_cast<size_t>(bin) : HISTOGRAM_BINS - 1;
+    }
+
+    // Adds the counts of summary to bins over [min, max], as if the values
+    // in each bin of summary were at the bin's center.
+    void Rebin(const PointCloud2Plugin::ValueSummary& summary, float min, float max, std::vector<uint64_t>& bins)
+    {
+      const float width = (summary.max - summary.min) / HISTOGRAM_BINS;
+      const float scale = HistogramScale(min, max);
+      for (size_t i = 0; i < HISTOGRAM_BINS; i++)
+      {
+        if (summary.histogram[i] > 0)
         {
-          const tf::Point transformed_point = transform * point.point;
-          scan.gl_point.push_back( transformed_point.getX() );
-          scan.gl_point.push_back( transformed_point.getY() );
+          bins[HistogramBin(summary.min + (i + 0.5f) * width, min, scale)] += summary.histogram[i];
         }
-        const QColor color = CalculateColor(point);
-        scan.gl_color.push_back( color.red());
-        scan.gl_color.push_back( color.green());
-        scan.gl_color.push_back( color.blue());
-        scan.gl_color.push_back( static_cast<uint8_t>(alpha_ * 255.0 ) );
       }
     }
 
+    // Subtracting a value from itself gives NaN for NaNs and infinities,
+    // which are left out of the summaries.
+    inline bool IsFinite(float value)
     {
-      QMutexLocker locker(&scan_mutex_);
-      scans_.push_back( std::move(scan) );
+      return value - value == 0.0f;
+    }
+
+    // The extent of the finite values in one range.  The values are split
+    // across independent lanes and the conditions are combined with &
+    // rather than &&, which keeps the loop free of branches so that the
+    // compiler can vectorize it.
+    void ValueExtent(const float* values, const PointRange& range, float& min, float& max)
+    {
+      const size_t LANES = 8;
+      float lane_min[LANES];
+      float lane_max[LANES];
+      std::fill(lane_min, lane_min + LANES, std::numeric_limits<float>::max());
+      std::fill(lane_max, lane_max + LANES, -std::numeric_limits<float>::max());
+
+      size_t i = range.begin;
+      for (; i + LANES <= range.end; i += LANES)
+      {
+        for (size_t lane = 0; lane < LANES; lane++)
+        {
+          const float value = values[i + lane];
+          const bool finite = IsFinite(value);
+          lane_min[lane] = (finite & (value < lane_min[lane])) ? value : lane_min[lane];
+          lane_max[lane] = (finite & (value > lane_max[lane])) ? value : lane_max[lane];
+        }
+      }
+      for (; i < range.end; i++)
+      {
+        const float value = values[i];
+        const bool finite = IsFinite(value);
+        lane_min[0] = (finite & (value < lane_min[0])) ? value : lane_min[0];
+        lane_max[0] = (finite & (value > lane_max[0])) ? value : lane_max[0];
+      }
+
+      min = *std::min_element(lane_min, lane_min + LANES);
+      max = *std::max_element(lane_max, lane_max + LANES);
     }
-    new_topic_ = true;
-    canvas_->update();
   }
 
   float PointCloud2Plugin::PointFeature(const uint8_t* data, const FieldInfo& feature_info)
@@ -602,6 +996,225 @@ namespace mapviz_plugins
     }
   }
 
+  mapviz::BoundingBox PointCloud2Plugin::DecodePositions(
+      const uint8_t* data,
+      size_t num_points,
+      uint32_t point_step,
+      const FieldInfo& x,
+      const FieldInfo& y,
+      const FieldInfo& z,
+      float* positions)
+  {
+    std::vector<PointRange> ranges = SplitPoints(num_points);
+
+    const bool same_type = x.datatype == y.datatype && x.datatype == z.datatype;
+    if (same_type && x.datatype == sensor_msgs::PointField::FLOAT32 &&
+        y.offset == x.offset + sizeof(float) && z.offset == y.offset + sizeof(float))
+    {
+      ForEachRange(ranges, [=](PointRange& range)
+      {
+        DecodePackedXYZ(data, point_step, x.offset, range, positions);
+      });
+    }
+    else if (same_type && x.datatype == sensor_msgs::PointField::FLOAT32)
+    {
+      ForEachRange(ranges, [=](PointRange& range)
+      {
+        DecodeXYZ<float>(data, point_step, x.offset, y.offset, z.offset, range, positions);
+      });
+    }
+    else if (same_type && x.datatype == sensor_msgs::PointField::FLOAT64)
+    {
+      ForEachRange(ranges, [=](PointRange& range)
+      {
+        DecodeXYZ<double>(data, point_step, x.offset, y.offset, z.offset, range, positions);
+      });
+    }
+    else
+    {
+      // Anything else is rare enough that it goes through the generic
+      // conversion.
+      ForEachRange(ranges, [=](PointRange& range)
+      {
+        RangeBounds bounds;
+        const uint8_t* ptr = data + range.begin * point_step;
+        float* xyz = positions + range.begin * 3;
+        for (size_t i = range.begin; i < range.end; i++, ptr += point_step, xyz += 3)
+        {
+          xyz[0] = PointFeature(ptr, x);
+          xyz[1] = PointFeature(ptr, y);
+          xyz[2] = PointFeature(ptr, z);
+          bounds.Add(xyz);
+        }
+        range.bounds = bounds.Box();
+      });
+    }
+
+    mapviz::BoundingBox bounds;
+    for (const PointRange& range: ranges)
+    {
+      bounds.Add(range.bounds);
+    }
+    return bounds;
+  }
+
+  void PointCloud2Plugin::DecodeField(
+      const uint8_t* data,
+      size_t num_points,
+      uint32_t point_step,
+      const FieldInfo& field,
+      float* values)
+  {
+    // The data type is only checked once per cloud, so that every type gets
+    // a loop that the compiler can unroll and vectorize.
+    switch (field.datatype)
+    {
+      case sensor_msgs::PointField::INT8:
+        DecodeFieldAs<int8_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::UINT8:
+        DecodeFieldAs<uint8_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::INT16:
+        DecodeFieldAs<int16_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::UINT16:
+        DecodeFieldAs<uint16_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::INT32:
+        DecodeFieldAs<int32_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::UINT32:
+        DecodeFieldAs<uint32_t>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::FLOAT32:
+        DecodeFieldAs<float>(data, num_points, point_step, field.offset, values);
+        break;
+      case sensor_msgs::PointField::FLOAT64:
+        DecodeFieldAs<double>(data, num_points, point_step, field.offset, values);
+        break;
+      default:
+        ROS_WARN("Unknown data type in point: %d", field.datatype);
+        std::fill(values, values + num_points, 0.0f);
+        break;
+    }
+  }
+
+  PointCloud2Plugin::ValueSummary::ValueSummary() :
+      min(std::numeric_limits<float>::max()),
+      max(-std::numeric_limits<float>::max()),
+      count(0),
+      histogram(HISTOGRAM_BINS, 0)
+  {
+  }
+
+  void PointCloud2Plugin::ValueSummary::Merge(const ValueSummary& other)
+  {
+    if (other.count == 0)
+    {
+      return;
+    }
+
+    if (count == 0)
+    {
+      *this = other;
+      return;
+    }
+
+    if (other.min == min && other.max == max)
+    {
+      for (size_t i = 0; i < HISTOGRAM_BINS; i++)
+      {
+        histogram[i] += other.histogram[i];
+      }
+    }
+    else
+    {
+      const float merged_min = std::min(min, other.min);
+      const float merged_max = std::max(max, other.max);
+      std::vector<uint64_t> merged(HISTOGRAM_BINS, 0);
+      Rebin(*this, merged_min, merged_max, merged);
+      Rebin(other, merged_min, merged_max, merged);
+      histogram.swap(merged);
+      min = merged_min;
+      max = merged_max;
+    }
+    count += other.count;
+  }
+
+  float PointCloud2Plugin::ValueSummary::Percentile(double fraction) const
+  {
+    if (count == 0)
+    {
+      return 0.0f;
+    }
+
+    // The values are assumed to be spread evenly within each bin.
+    const double target = fraction * count;
+    const double width = (static_cast<double>(max) - min) / HISTOGRAM_BINS;
+    double below = 0.0;
+    for (size_t i = 0; i < HISTOGRAM_BINS; i++)
+    {
+      if (histogram[i] > 0 && below + histogram[i] >= target)
+      {
+        return static_cast<float>(min + (i + (target - below) / histogram[i]) * width);
+      }
+      below += histogram[i];
+    }
+    return max;
+  }
+
+  PointCloud2Plugin::ValueSummary PointCloud2Plugin::SummarizeValues(const float* values, size_t num_values)
+  {
+    std::vector<PointRange> ranges = SplitPoints(num_values);
+    std::vector<ValueSummary> summaries(ranges.size());
+
+    // The extent is found first, so that every range is binned the same
+    // way and the histograms of the ranges can simply be added.
+    ForEachRange(ranges, [&](PointRange& range)
+    {
+      ValueSummary& summary = summaries[&range - &ranges.front()];
+      ValueExtent(values, range, summary.min, summary.max);
+    });
+
+    ValueSummary summary;
+    for (const ValueSummary& range_summary: summaries)
+    {
+      summary.min = std::min(summary.min, range_summary.min);
+      summary.max = std::max(summary.max, range_summary.max);
+    }
+    if (summary.min > summary.max)
+    {
+      // None of the values are finite.
+      return ValueSummary();
+    }
+
+    const float scale = HistogramScale(summary.min, summary.max);
+    ForEachRange(ranges, [&](PointRange& range)
+    {
+      ValueSummary& range_summary = summaries[&range - &ranges.front()];
+      for (size_t i = range.begin; i < range.end; i++)
+      {
+        const float value = values[i];
+        if (IsFinite(value))
+        {
+          range_summary.histogram[HistogramBin(value, summary.min, scale)]++;
+          range_summary.count++;
+        }
+      }
+    });
+
+    for (const ValueSummary& range_summary: summaries)
+    {
+      for (size_t i = 0; i < HISTOGRAM_BINS; i++)
+      {
+        summary.histogram[i] += range_summary.histogram[i];
+      }
+      summary.count += range_summary.count;
+    }
+    return summary;
+  }
+
   void PointCloud2Plugin::PrintError(const std::string& message)
   {
     PrintErrorHelper(ui_.status, message);
@@ -609,7 +1222,7 @@ namespace mapviz_plugins
 
   void PointCloud2Plugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void PointCloud2Plugin::PrintWarning(const std::string& message)
@@ -633,34 +1246,260 @@ namespace mapviz_plugins
     return true;
   }
 
+  template <class T>
+  void PointCloud2Plugin::UploadBuffer(VertexBuffer& buffer, std::vector<T>& data, bool release)
+  {
+    if (buffer.id == 0)
+    {
+      glGenBuffers(1, &buffer.id);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+
+    // Only reallocate the buffer if the amount of data changed.
+    size_t size = data.size() * sizeof(T);
+    if (size != buffer.size)
+    {
+      glBufferData(GL_ARRAY_BUFFER, size, data.data(), GL_STATIC_DRAW);
+      buffer.size = size;
+    }
+    else
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, size, data.data());
+    }
+    buffer.dirty = false;
+
+    if (release)
+    {
+      std::vector<T>().swap(data);
+    }
+  }
+
+  namespace
+  {
+    // Number of colors in the lookup texture; MapColor() can't produce more
+    // distinct hues than this.  This must match the vertex shader.
+    const size_t PALETTE_SIZE = 256;
+
+    const char* COLOR_VERTEX_SHADER =
+        "#version 120\n"
+        "attribute float value;\n"
+        "uniform float scale;\n"
+        "uniform float offset;\n"
+        "varying float coordinate;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+        "  float normalized = clamp(value * scale + offset, 0.0, 1.0);\n"
+        "  coordinate = (normalized * 255.0 + 0.5) / 256.0;\n"
+        "}\n";
+
+    const char* COLOR_FRAGMENT_SHADER =
+        "#version 120\n"
+        "uniform sampler1D palette;\n"
+        "uniform float alpha;\n"
+        "varying float coordinate;\n"
+        "void main()\n"
+        "{\n"
+        "  gl_FragColor = vec4(texture1D(palette, coordinate).rgb, alpha);\n"
+        "}\n";
+  }
+
+  bool PointCloud2Plugin::BindShader()
+  {
+    if (!shader_supported_)
+    {
+      return false;
+    }
+
+    if (!shader_)
+    {
+      shader_ = boost::make_shared<QGLShaderProgram>(canvas_->context());
+      if (!QGLShaderProgram::hasOpenGLShaderPrograms(canvas_->context()) ||
+          !shader_->addShaderFromSourceCode(QGLShader::Vertex, COLOR_VERTEX_SHADER) ||
+          !shader_->addShaderFromSourceCode(QGLShader::Fragment, COLOR_FRAGMENT_SHADER) ||
+          !shader_->link() ||
+          (value_attribute_ = shader_->attributeLocation("value")) < 0)
+      {
+        ROS_WARN("Point clouds will be colored on the CPU; the color shader is not available: %s",
+                 shader_->log().toStdString().c_str());
+        shader_.reset();
+        shader_supported_ = false;
+
+        // Color the scans on the CPU instead the next time they're
+        // transformed.
+        for (Scan& scan: scans_)
+        {
+          if (scan.shaded)
+          {
+            scan.colored = false;
+          }
+        }
+        RequestRedraw();
+        return false;
+      }
+    }
+
+    if (palette_texture_ == 0)
+    {
+      glGenTextures(1, &palette_texture_);
+      glBindTexture(GL_TEXTURE_1D, palette_texture_);
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      palette_dirty_ = true;
+    }
+    else
+    {
+      glBindTexture(GL_TEXTURE_1D, palette_texture_);
+    }
+
+    if (palette_dirty_)
+    {
+      std::vector<uint8_t> palette;
+      MakePalette(ui_.use_rainbow->isChecked(), ui_.min_color->color(), ui_.max_color->color(),
+                  PALETTE_SIZE, palette);
+      glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, PALETTE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette.data());
+      palette_dirty_ = false;
+    }
+
+    // Values are normalized the same way as in CalculateColor().
+    float scale = 1.0f;
+    float offset = 0.0f;
+    if (max_value_ > min_value_)
+    {
+      scale = static_cast<float>(1.0 / (max_value_ - min_value_));
+      offset = static_cast<float>(-min_value_) * scale;
+    }
+
+    shader_->bind();
+    shader_->setUniformValue("palette", 0);
+    shader_->setUniformValue("scale", scale);
+    shader_->setUniformValue("offset", offset);
+    shader_->setUniformValue("alpha", static_cast<GLfloat>(alpha_));
+    return true;
+  }
+
+  void PointCloud2Plugin::ReleaseShader()
+  {
+    shader_->release();
+    glBindTexture(GL_TEXTURE_1D, 0);
+  }
+
   void PointCloud2Plugin::Draw(double x, double y, double scale)
   {
     glPointSize(point_size_);
 
     glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
 
     {
       QMutexLocker locker(&scan_mutex_);
 
+      if (!released_buffers_.empty())
+      {
+        glDeleteBuffers(static_cast<GLsizei>(released_buffers_.size()), released_buffers_.data());
+        released_buffers_.clear();
+      }
+
+      bool shader_bound = false;
       for (Scan& scan: scans_)
       {
-        if (scan.transformed && !scan.gl_color.empty())
+        if (!scan.transformed || !scan.colored || !IsVisible(scan.bounds))
         {
-          glBindBuffer(GL_ARRAY_BUFFER, scan.point_vbo);  // coordinates
-          glBufferData(GL_ARRAY_BUFFER, scan.gl_point.size() * sizeof(float), scan.gl_point.data(), GL_STATIC_DRAW);
-          glVertexPointer( 2, GL_FLOAT, 0, 0);
+          continue;
+        }
 
-          glBindBuffer(GL_ARRAY_BUFFER, scan.color_vbo);  // color
-          glBufferData(GL_ARRAY_BUFFER, scan.gl_color.size() * sizeof(uint8_t), scan.gl_color.data(), GL_STATIC_DRAW);
-          glColorPointer( 4, GL_UNSIGNED_BYTE, 0, 0);
+        if (scan.shaded && !shader_bound)
+        {
+          if (!BindShader())
+          {
+            continue;
+          }
+          shader_bound = true;
+        }
+        else if (!scan.shaded && shader_bound)
+        {
+          ReleaseShader();
+          shader_bound = false;
+        }
 
-          glDrawArrays(GL_POINTS, 0, scan.gl_point.size() / 2 );
+        // The buffers are only uploaded when the scan's points or colors
+        // have changed.  The source frame positions and the values are kept
+        // in case the scan has to be transformed or colored again, but the
+        // transformed points and the colors aren't needed once they've been
+        // uploaded.
+        if (scan.point_vbo.dirty)
+        {
+          if (scan.point_components == 3)
+          {
+            UploadBuffer(scan.point_vbo, scan.positions, false);
+          }
+          else
+          {
+            UploadBuffer(scan.point_vbo, scan.gl_point, true);
+          }
         }
+        else
+        {
+          glBindBuffer(GL_ARRAY_BUFFER, scan.point_vbo.id);
+        }
+        glVertexPointer(scan.point_components, GL_FLOAT, 0, 0);
+
+        if (scan.shaded)
+        {
+          if (scan.value_vbo.dirty)
+          {
+            UploadBuffer(scan.value_vbo, scan.values, false);
+          }
+          else
+          {
+            glBindBuffer(GL_ARRAY_BUFFER, scan.value_vbo.id);
+          }
+          glVertexAttribPointer(value_attribute_, 1, GL_FLOAT, GL_FALSE, 0, 0);
+          glEnableVertexAttribArray(value_attribute_);
+        }
+        else
+        {
+          if (scan.color_vbo.dirty)
+          {
+            UploadBuffer(scan.color_vbo, scan.gl_color, true);
+          }
+          else
+          {
+            glBindBuffer(GL_ARRAY_BUFFER, scan.color_vbo.id);
+          }
+          glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+          glEnableClientState(GL_COLOR_ARRAY);
+        }
+
+        // Rigid transforms are applied by OpenGL so that the points can
+        // stay in their source frame.
+        const bool gl_transform = scan.point_components == 3 && PushGLTransform(scan.transformer);
+
+        glDrawArrays(GL_POINTS, 0, scan.positions.size() / 3 );
+        RecordDrawn(scan.stamp);
+
+        if (gl_transform)
+        {
+          PopGLTransform();
+        }
+
+        if (scan.shaded)
+        {
+          glDisableVertexAttribArray(value_attribute_);
+        }
+        else
+        {
+          glDisableClientState(GL_COLOR_ARRAY);
+        }
+      }
+
+      if (shader_bound)
+      {
+        ReleaseShader();
       }
     }
     glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     PrintInfo("OK");
@@ -685,11 +1524,86 @@ namespace mapviz_plugins
     UpdateColors();
   }
 
+  void PointCloud2Plugin::AutomaxminClipChanged(double value)
+  {
+    automaxmin_clip_ = value / 100.0;
+    UpdateColors();
+  }
+
+  mapviz::MemoryStats PointCloud2Plugin::MemoryUsage()
+  {
+    mapviz::MemoryStats usage;
+    {
+      QMutexLocker locker(&scan_mutex_);
+      for (const Scan& scan: scans_)
+      {
+        usage += ScanMemoryUsage(scan);
+      }
+    }
+    {
+      QMutexLocker locker(&pending_mutex_);
+      for (const Scan& scan: pending_scans_)
+      {
+        usage += ScanMemoryUsage(scan);
+      }
+    }
+    return usage;
+  }
+
+  mapviz::MemoryStats PointCloud2Plugin::ScanMemoryUsage(const Scan& scan)
+  {
+    mapviz::MemoryStats usage;
+    usage.cpu_bytes = sizeof(Scan) +
+        mapviz::HeapBytes(scan.positions) +
+        mapviz::HeapBytes(scan.values) +
+        mapviz::HeapBytes(scan.value_summary.histogram) +
+        mapviz::HeapBytes(scan.gl_point) +
+        mapviz::HeapBytes(scan.gl_color);
+    if (scan.msg)
+    {
+      usage.cpu_bytes += mapviz::HeapBytes(scan.msg->data);
+    }
+    usage.gpu_bytes = scan.point_vbo.size + scan.color_vbo.size + scan.value_vbo.size;
+    return usage;
+  }
+
+  size_t PointCloud2Plugin::BufferedElements()
+  {
+    QMutexLocker locker(&scan_mutex_);
+    size_t points = 0;
+    for (const Scan& scan: scans_)
+    {
+      points += scan.positions.size() / 3;
+    }
+    return points;
+  }
+
   void PointCloud2Plugin::Transform()
   {
+    const std::string field = ColorField();
+
     {
       QMutexLocker locker(&scan_mutex_);
 
+      if (need_minmax_)
+      {
+        // The automatic range has to include new scans before they are
+        // colored.
+        bool new_values = false;
+        for (Scan& scan: scans_)
+        {
+          if (!scan.colored)
+          {
+            UpdateScanValues(scan, field);
+            new_values = true;
+          }
+        }
+        if (new_values)
+        {
+          UpdateValueRange(field);
+        }
+      }
+
       bool was_using_latest_transforms = use_latest_transforms_;
       use_latest_transforms_ = false;
       for (Scan& scan: scans_)
@@ -699,32 +1613,50 @@ namespace mapviz_plugins
           swri_transform_util::Transform transform;
           if (GetTransform(scan.source_frame, scan.stamp, transform))
           {
-            scan.gl_point.clear();
-            scan.gl_point.reserve(scan.points.size()*2);
-
-            scan.transformed = true;
-            for (StampedPoint& point: scan.points)
+            // Rigid transforms are applied by OpenGL when the scan is drawn,
+            // so the points only have to be transformed here if the
+            // transform can't be represented as a matrix.
+            scan.transformer = mapviz::PointTransformer(transform);
+            if (scan.transformer.IsRigid())
+            {
+              // The positions only have to be uploaded again if the buffer
+              // held transformed points before.
+              std::vector<float>().swap(scan.gl_point);
+              if (scan.point_components != 3)
+              {
+                scan.point_components = 3;
+                scan.point_vbo.dirty = true;
+              }
+            }
+            else
             {
-              const tf::Point transformed_point = transform * point.point;
-              scan.gl_point.push_back( transformed_point.getX() );
-              scan.gl_point.push_back( transformed_point.getY() );
+              const size_t num_points = scan.positions.size() / 3;
+              scan.gl_point.resize(num_points * 2);
+              if (num_points > 0)
+              {
+                scan.transformer.TransformXYZToXY(&scan.positions[0], num_points, &scan.gl_point[0]);
+              }
+              scan.point_components = 2;
+              scan.point_vbo.dirty = true;
             }
+            scan.bounds = scan.transformer.TransformBounds(scan.source_bounds);
+
+            scan.transformed = true;
           }
           else
           {
-            ROS_WARN("Unable to get transform.");
+            PrintError("No transform between " + scan.source_frame + " and " + target_frame_);
             scan.transformed = false;
           }
         }
+
+        if (!scan.colored)
+        {
+          UpdateScanColors(scan, field);
+        }
       }
       use_latest_transforms_ = was_using_latest_transforms;
     }
-    // Z color is based on transformed color, so it is dependent on the
-    // transform
-    if (ui_.color_transformer->currentIndex() == COLOR_Z)
-    {
-      UpdateColors();
-    }
   }
 
   void PointCloud2Plugin::LoadConfig(const YAML::Node& node,
@@ -810,6 +1742,13 @@ namespace mapviz_plugins
       node["use_automaxmin"] >> use_automaxmin;
       ui_.use_automaxmin->setChecked(use_automaxmin);
     }
+
+    if (node["automaxmin_clip"])
+    {
+      double automaxmin_clip;
+      node["automaxmin_clip"] >> automaxmin_clip;
+      ui_.automaxmin_clip->setValue(automaxmin_clip);
+    }
     // UseRainbowChanged must be called *before* ColorTransformerChanged
     UseAutomaxminChanged(ui_.use_automaxmin->checkState());
     // ColorTransformerChanged will also update colors of all points
@@ -819,6 +1758,10 @@ namespace mapviz_plugins
   void PointCloud2Plugin::ColorTransformerChanged(int index)
   {
     ROS_DEBUG("Color transformer changed to %d", index);
+    {
+      QMutexLocker locker(&pending_mutex_);
+      color_field_ = index > 0 ? ui_.color_transformer->itemText(index).toStdString() : "";
+    }
     UpdateMinMaxWidgets();
     UpdateColors();
   }
@@ -835,6 +1778,7 @@ namespace mapviz_plugins
       ui_.min_max_color_widget->show();
       ui_.min_max_value_widget->hide();
       ui_.use_automaxmin->hide();
+      ui_.automaxmin_clip->hide();
       ui_.use_rainbow->hide();
     }
     else
@@ -845,6 +1789,7 @@ namespace mapviz_plugins
       ui_.min_max_color_widget->setVisible(!ui_.use_rainbow->isChecked());
       ui_.min_max_value_widget->setVisible(!ui_.use_automaxmin->isChecked());
       ui_.use_automaxmin->show();
+      ui_.automaxmin_clip->setVisible(ui_.use_automaxmin->isChecked());
       ui_.use_rainbow->show();
     }
 
@@ -860,6 +1805,7 @@ namespace mapviz_plugins
   void PointCloud2Plugin::AlphaEdited(double value)
   {
     alpha_ = std::max(0.0f, std::min((float)value, 1.0f));
+    UpdateColors();
   }
 
   void PointCloud2Plugin::SaveConfig(YAML::Emitter& emitter,
@@ -887,6 +1833,8 @@ namespace mapviz_plugins
       YAML::Value << ui_.use_rainbow->isChecked();
     emitter << YAML::Key << "use_automaxmin" <<
       YAML::Value << ui_.use_automaxmin->isChecked();
+    emitter << YAML::Key << "automaxmin_clip" <<
+      YAML::Value << ui_.automaxmin_clip->value();
     emitter << YAML::Key << "unpack_rgb" <<
       YAML::Value << ui_.unpack_rgb->isChecked();
   }
@@ -74,6 +74,8 @@ namespace mapviz_plugins
                      SLOT(SelectTopic()));
     QObject::connect(ui_.topic, SIGNAL(editingFinished()), this,
                      SLOT(TopicEdited()));
+    QObject::connect(this, SIGNAL(ConflateChanged(bool)), this,
+                     SLOT(Resubscribe()));
     QObject::connect(ui_.positiontolerance, SIGNAL(valueChanged(double)), this,
                      SLOT(PositionToleranceChanged(double)));
     QObject::connect(ui_.buffersize, SIGNAL(valueChanged(int)), this,
@@ -118,15 +120,20 @@ namespace mapviz_plugins
       has_message_ = false;
       PrintWarning("No messages received.");
 
-      pose_sub_.shutdown();
-
       topic_ = topic;
-      if (!topic.empty())
-      {
-        pose_sub_ = node_.subscribe(topic_, 10, &PosePlugin::PoseCallback, this);
+      Resubscribe();
+    }
+  }
 
-        ROS_INFO("Subscribing to %s", topic_.c_str());
-      }
+  void PosePlugin::Resubscribe()
+  {
+    pose_sub_.shutdown();
+
+    if (!topic_.empty())
+    {
+      pose_sub_ = Subscribe(topic_, SubscriberQueueSize(10), &PosePlugin::PoseCallback, this);
+
+      ROS_INFO("Subscribing to %s", topic_.c_str());
     }
   }
 
@@ -162,7 +169,7 @@ namespace mapviz_plugins
 
   void PosePlugin::PrintInfo(const std::string& message)
   {
-    PrintInfoHelper(ui_.status, message);
+    PrintInfoHelper(ui_.status, AppendDroppedMessages(message), 1.0);
   }
 
   void PosePlugin::PrintWarning(const std::string& message)
@@ -322,25 +322,65 @@ namespace mapviz_plugins
 
     if (draw_style_ == LINES)
     {
+      // Only draw the segments that cross the view.  The line strip is
+      // restarted after every gap so that no segments are added.
       glLineWidth(3);
-      glBegin(GL_LINE_STRIP);
+      bool drawing = false;
+      for (size_t i = 1; i < route.points.size(); i++)
+      {
+        const tf::Vector3& start = route.points[i - 1].position();
+        const tf::Vector3& end = route.points[i].position();
+
+        mapviz::BoundingBox segment;
+        segment.Add(start);
+        segment.Add(end);
+        if (!IsVisible(segment))
+        {
+          if (drawing)
+          {
+            glEnd();
+            drawing = false;
+          }
+          continue;
+        }
+
+        if (!drawing)
+        {
+          glBegin(GL_LINE_STRIP);
+          glVertex2d(start.x(), start.y());
+          drawing = true;
+        }
+        glVertex2d(end.x(), end.y());
+      }
+
+      if (drawing)
+      {
+        glEnd();
+      }
     }
     else
     {
       glPointSize(2);
       glBegin(GL_POINTS);
+      for (size_t i = 0; i < route.points.size(); i++)
+      {
+        if (IsVisible(route.points[i].position()))
+        {
+          glVertex2d(route.points[i].position().x(),
+                     route.points[i].position().y());
+        }
+      }
+      glEnd();
     }
-
-    for (size_t i = 0; i < route.points.size(); i++)
-    {
-      glVertex2d(route.points[i].position().x(),
-                 route.points[i].position().y());
-    }
-    glEnd();
   }
 
   void RoutePlugin::DrawRoutePoint(const sru::RoutePoint& point)
   {
+    if (!IsVisible(point.position()))
+    {
+      return;
+    }
+
     const double arrow_size = ui_.iconsize->value();
 
     tf::Vector3 v1(arrow_size, 0.0, 0.0);
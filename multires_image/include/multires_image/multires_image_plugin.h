@@ -68,6 +68,15 @@ namespace mapviz_plugins
 
     void Transform();
 
+    bool SupportsRenderCache()
+    {
+      return true;
+    }
+
+    bool NeedsRedraw();
+
+    mapviz::MemoryStats MemoryUsage();
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
@@ -100,8 +109,15 @@ namespace mapviz_plugins
     swri_transform_util::Transform transform_;
     swri_transform_util::Transform inverse_transform_;
 
+    // Transform from the image to the target frame, including the offset
+    mapviz::PointTransformer transformer_;
+
     bool transformed_;
 
+    // True if the tile corners are in the image frame and the transform is
+    // applied by OpenGL
+    bool tiles_in_source_frame_;
+
     void GetCenterPoint(double x, double y);
 
     boost::filesystem::path MakePathRelative(
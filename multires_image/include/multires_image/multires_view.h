@@ -33,6 +33,8 @@
 // QT libraries
 #include <QGLWidget>
 
+#include <mapviz/bounding_box.h>
+
 #include <multires_image/tile_set.h>
 #include <multires_image/tile_cache.h>
 
@@ -48,11 +50,26 @@ class MultiresView
 
     void SetView(double x, double y, double radius, double scale);
 
+    /**
+     * Sets the visible part of the image in the frame of the tiles.  Tiles
+     * outside of it are neither drawn nor loaded.
+     */
+    void SetVisibleBounds(const mapviz::BoundingBox& bounds) { m_visibleBounds = bounds; }
+
     void Draw();
 
+    /**
+     * Returns true if any of the tiles in the last drawn view were still
+     * being loaded.
+     */
+    bool IsLoading() const { return m_loading; }
+
     void Exit() { m_cache.Exit(); }
 
   private:
+    bool IsVisible(const multires_image::Tile* tile) const;
+    void DrawTile(multires_image::Tile* tile);
+
     multires_image::TileSet*   m_tiles;
     multires_image::TileCache  m_cache;
     int        m_currentLayer;
@@ -60,6 +77,8 @@ class MultiresView
     int        m_startColumn;
     int        m_endRow;
     int        m_endColumn;
+    bool       m_loading;
+    mapviz::BoundingBox m_visibleBounds;
 
     double min_scale_;
   };
@@ -68,6 +68,11 @@ namespace multires_image
     int Row() const { return m_row; }
     int Column() const { return m_column; }
 
+    const tf::Point& TopLeft() const { return m_top_left; }
+    const tf::Point& TopRight() const { return m_top_right; }
+    const tf::Point& BottomLeft() const { return m_bottom_left; }
+    const tf::Point& BottomRight() const { return m_bottom_right; }
+
     bool LoadImageToMemory(bool gl = true);
     void UnloadImage();
 
@@ -63,6 +63,8 @@ namespace multires_image
 
     void SetCurrentLayer(int layer) { m_currentLayer = layer; }
 
+    int64_t MemorySize() const { return m_memorySize; }
+
     void Exit();
 
   public Q_SLOTS:
@@ -30,6 +30,7 @@
 #include <multires_image/multires_image_plugin.h>
 
 // C++ standard libraries
+#include <algorithm>
 #include <cstdio>
 
 // QT libraries
@@ -56,7 +57,8 @@ namespace mapviz_plugins
     tile_set_(NULL),
     tile_view_(NULL),
     config_widget_(new QWidget()),
-    transformed_(false)
+    transformed_(false),
+    tiles_in_source_frame_(true)
   {
     ui_.setupUi(config_widget_);
 
@@ -131,6 +133,7 @@ namespace mapviz_plugins
       delete tile_set_;
       delete tile_view_;
       tile_set_ = new multires_image::TileSet(ui_.path->text().toStdString());
+      tiles_in_source_frame_ = true;
 
       if (tile_set_->Load())
       {
@@ -217,12 +220,48 @@ namespace mapviz_plugins
       GetCenterPoint(x, y);
       tile_view_->SetView(center_x_, center_y_, 1, scale);
 
+      // Bring the visible bounds into the frame of the tiles, undoing the
+      // user-specified offset first.
+      const mapviz::BoundingBox& visible = VisibleBounds();
+      mapviz::BoundingBox offset_bounds(
+          visible.MinX() - offset_x_, visible.MinY() - offset_y_,
+          visible.MaxX() - offset_x_, visible.MaxY() - offset_y_);
+      tile_view_->SetVisibleBounds(
+          mapviz::PointTransformer(inverse_transform_).TransformBounds(offset_bounds));
+
+      const bool gl_transform = tiles_in_source_frame_ && PushGLTransform(transformer_);
+
       tile_view_->Draw();
 
+      if (gl_transform)
+      {
+        PopGLTransform();
+      }
+
       PrintInfo("OK");
     }
   }
 
+  bool MultiresImagePlugin::NeedsRedraw()
+  {
+    // Tiles are loaded in the background, so keep drawing until all of the
+    // tiles in view are available.
+    return mapviz::MapvizPlugin::NeedsRedraw() ||
+        (tile_view_ != NULL && tile_view_->IsLoading());
+  }
+
+  mapviz::MemoryStats MultiresImagePlugin::MemoryUsage()
+  {
+    if (tile_view_ == NULL)
+    {
+      return mapviz::MemoryStats();
+    }
+
+    // Tile images are only held in memory until they have been uploaded, so
+    // the textures are nearly all of the memory used.
+    return mapviz::MemoryStats(0, static_cast<size_t>(std::max<int64_t>(0, tile_view_->Cache()->MemorySize())));
+  }
+
   void MultiresImagePlugin::Transform()
   {
     transformed_ = false;
@@ -230,13 +269,13 @@ namespace mapviz_plugins
     if (!loaded_)
       return;
 
-    if (!tf_manager_->GetTransform(target_frame_, source_frame_, transform_))
+    if (!LookupTransform(target_frame_, source_frame_, ros::Time(), transform_))
     {
       PrintError("Failed transform from " + source_frame_ + " to " + target_frame_);
       return;
     }
 
-    if (!tf_manager_->GetTransform(source_frame_, target_frame_, inverse_transform_))
+    if (!LookupTransform(source_frame_, target_frame_, ros::Time(), inverse_transform_))
     {
       PrintError("Failed inverse transform from " + target_frame_ + " to " + source_frame_);
       return;
@@ -248,19 +287,52 @@ namespace mapviz_plugins
                     tf::createIdentityQuaternion(),
                     tf::Vector3(offset_x_, offset_y_, 0.0)));
 
-    // Set relative positions of tile points based on tf transform
-    for (int i = 0; i < tile_set_->LayerCount(); i++)
+    // Rigid transforms are applied by OpenGL when the tiles are drawn, so
+    // the tile corners only have to be transformed here if the transform
+    // can't be represented as a matrix.
+    mapviz::PointTransformer transformer(offset, transform_);
+    if (!transformer.Equals(transformer_))
+    {
+      // The image has moved, so the render cache is out of date.
+      RequestRedraw();
+    }
+    transformer_ = transformer;
+    if (transformer_.IsRigid())
+    {
+      if (!tiles_in_source_frame_)
+      {
+        swri_transform_util::Transform identity;
+        for (int i = 0; i < tile_set_->LayerCount(); i++)
+        {
+          multires_image::TileSetLayer* layer = tile_set_->GetLayer(i);
+          for (int r = 0; r < layer->RowCount(); r++)
+          {
+            for (int c = 0; c < layer->ColumnCount(); c++)
+            {
+              layer->GetTile(c, r)->Transform(identity);
+            }
+          }
+        }
+        tiles_in_source_frame_ = true;
+      }
+    }
+    else
     {
-      multires_image::TileSetLayer* layer = tile_set_->GetLayer(i);
-      for (int r = 0; r < layer->RowCount(); r++)
+      // Set relative positions of tile points based on tf transform
+      for (int i = 0; i < tile_set_->LayerCount(); i++)
       {
-        for (int c = 0; c < layer->ColumnCount(); c++)
+        multires_image::TileSetLayer* layer = tile_set_->GetLayer(i);
+        for (int r = 0; r < layer->RowCount(); r++)
         {
-          multires_image::Tile* tile = layer->GetTile(c, r);
+          for (int c = 0; c < layer->ColumnCount(); c++)
+          {
+            multires_image::Tile* tile = layer->GetTile(c, r);
 
-          tile->Transform(transform_, offset);
+            tile->Transform(transform_, offset);
+          }
         }
       }
+      tiles_in_source_frame_ = false;
     }
 
     transformed_ = true;
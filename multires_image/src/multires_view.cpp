@@ -45,7 +45,9 @@ namespace mapviz_plugins
       m_startRow(0),
       m_startColumn(0),
       m_endRow(0),
-      m_endColumn(0)
+      m_endColumn(0),
+      m_loading(false),
+      m_visibleBounds(mapviz::BoundingBox::Infinite())
   {
     double top, left, bottom, right;
 
@@ -129,6 +131,8 @@ namespace mapviz_plugins
 
   void MultiresView::Draw()
   {
+    m_loading = false;
+
     glEnable(GL_TEXTURE_2D);
 
     glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
@@ -136,15 +140,7 @@ namespace mapviz_plugins
     // Always draw bottom layers
 
     multires_image::TileSetLayer* baseLayer = m_tiles->GetLayer(m_tiles->LayerCount() - 1);
-    multires_image::Tile* tile = baseLayer->GetTile(0, 0);
-    if (tile->TextureLoaded())
-    {
-      tile->Draw();
-    }
-    else
-    {
-      m_cache.Load(tile);
-    }
+    DrawTile(baseLayer->GetTile(0, 0));
 
     if(m_tiles->LayerCount() >= 2)
     {
@@ -153,15 +149,7 @@ namespace mapviz_plugins
       {
         for (int r = 0; r <  baseLayer->RowCount(); r++)
         {
-          multires_image::Tile* tile = baseLayer->GetTile(c, r);
-          if (tile->TextureLoaded())
-          {
-            tile->Draw();
-          }
-          else
-          {
-            m_cache.Load(tile);
-          }
+          DrawTile(baseLayer->GetTile(c, r));
         }
       }
     }
@@ -175,15 +163,7 @@ namespace mapviz_plugins
         {
           for (int r = m_startRow; r <= m_endRow; r++)
           {
-            multires_image::Tile* tile = layer->GetTile(c, r);
-            if (tile->TextureLoaded())
-            {
-              tile->Draw();
-            }
-            else
-            {
-              m_cache.Load(tile);
-            }
+            DrawTile(layer->GetTile(c, r));
           }
         }
       }
@@ -191,4 +171,33 @@ namespace mapviz_plugins
 
     glDisable(GL_TEXTURE_2D);
   }
+
+  bool MultiresView::IsVisible(const multires_image::Tile* tile) const
+  {
+    mapviz::BoundingBox bounds;
+    bounds.Add(tile->TopLeft());
+    bounds.Add(tile->TopRight());
+    bounds.Add(tile->BottomLeft());
+    bounds.Add(tile->BottomRight());
+    return m_visibleBounds.Intersects(bounds);
+  }
+
+  void MultiresView::DrawTile(multires_image::Tile* tile)
+  {
+    // Tiles that are out of view aren't drawn or loaded.
+    if (!IsVisible(tile))
+    {
+      return;
+    }
+
+    if (tile->TextureLoaded())
+    {
+      tile->Draw();
+    }
+    else
+    {
+      m_cache.Load(tile);
+      m_loading = true;
+    }
+  }
 }
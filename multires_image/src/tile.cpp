@@ -40,6 +40,7 @@
 #include <QFile>
 
 #include <swri_math_util/math_util.h>
+#include <mapviz/trace.h>
 
 namespace multires_image
 {
@@ -81,6 +82,7 @@ namespace multires_image
   {
     if (!m_failed)
     {
+      mapviz::TraceScope trace("tile_cache", "Load tile image");
       m_mutex.lock();
 
       try
@@ -140,6 +142,7 @@ namespace multires_image
   {
     if (!m_textureLoaded && !m_failed)
     {
+      mapviz::TraceScope trace("tile_cache", "Load tile texture");
       m_mutex.lock();
 
       try
@@ -30,6 +30,7 @@
 #ifndef TILE_MAP_IMAGE_CACHE_H_
 #define TILE_MAP_IMAGE_CACHE_H_
 
+#include <atomic>
 #include <string>
 #include <limits>
 
@@ -65,6 +66,14 @@ namespace tile_map
     void InitializeImage();
     void ClearImage();
 
+    /**
+     * The number of bytes used by the decoded image.  The image may still be
+     * loading on another thread, so this is recorded with SetMemorySize()
+     * once it is done instead of being read from the image.
+     */
+    size_t MemorySize() const { return memory_size_; }
+    void SetMemorySize(size_t bytes) { memory_size_ = bytes; }
+
     void AddFailure();
     bool Failed() const { return failed_; }
 
@@ -90,6 +99,7 @@ namespace tile_map
     int32_t failures_;
     bool failed_;
     uint64_t priority_;
+    std::atomic<size_t> memory_size_;
 
     mutable boost::shared_ptr<QImage> image_;
 
@@ -107,6 +117,11 @@ namespace tile_map
 
     ImagePtr GetImage(size_t uri_hash, const QString& uri, int32_t priority = 0);
 
+    /**
+     * Returns the memory used by the decoded images in the cache.
+     */
+    size_t MemoryUsage();
+
   public Q_SLOTS:
     void ProcessRequest(QString uri);
     void ProcessReply(QNetworkReply* reply);
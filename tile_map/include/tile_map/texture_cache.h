@@ -30,8 +30,11 @@
 #ifndef TILE_MAP_TEXTURE_CACHE_H_
 #define TILE_MAP_TEXTURE_CACHE_H_
 
+#include <atomic>
+
 #include <QCache>
 
+#include <mapviz/memory_stats.h>
 #include <tile_map/image_cache.h>
 
 namespace tile_map
@@ -39,13 +42,24 @@ namespace tile_map
   class Texture
   {
   public:
-    Texture(int32_t texture_id, size_t hash);
+    Texture(
+        int32_t texture_id,
+        size_t hash,
+        size_t memory_size = 0,
+        const boost::shared_ptr<std::atomic<size_t> >& memory_usage =
+            boost::shared_ptr<std::atomic<size_t> >());
     ~Texture();
 
     const int32_t id;
     const size_t url_hash;
+    // Bytes of GPU memory used by the texture
+    const size_t memory_size;
 
     bool failed;
+
+  private:
+    // Total memory of the textures created by a cache
+    boost::shared_ptr<std::atomic<size_t> > memory_usage_;
   };
   typedef boost::shared_ptr<Texture> TexturePtr;
 
@@ -59,10 +73,23 @@ namespace tile_map
 
     void Clear();
 
+    /**
+     * Returns the memory used by the decoded images waiting to be uploaded
+     * or kept for reuse, and the GPU memory used by all textures created by
+     * this cache that are still alive, including ones that have been
+     * evicted but are still being drawn.
+     */
+    mapviz::MemoryStats MemoryUsage() const
+    {
+      return mapviz::MemoryStats(image_cache_->MemoryUsage(), *memory_usage_);
+    }
+
   private:
     QCache<size_t, TexturePtr> cache_;
 
     ImageCachePtr image_cache_;
+
+    boost::shared_ptr<std::atomic<size_t> > memory_usage_;
   };
   typedef boost::shared_ptr<TextureCache> TextureCachePtr;
 }
@@ -71,6 +71,18 @@ namespace tile_map
 
     void Transform();
 
+    bool SupportsRenderCache()
+    {
+      return true;
+    }
+
+    bool NeedsRedraw();
+
+    mapviz::MemoryStats MemoryUsage()
+    {
+      return tile_map_.MemoryUsage();
+    }
+
     void LoadConfig(const YAML::Node& node, const std::string& path);
     void SaveConfig(YAML::Emitter& emitter, const std::string& path);
 
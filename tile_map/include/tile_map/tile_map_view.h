@@ -37,6 +37,8 @@
 #include <tile_map/tile_source.h>
 #include <tile_map/texture_cache.h>
 
+#include <mapviz/point_transformer.h>
+#include <mapviz/render_batch.h>
 #include <swri_transform_util/transform.h>
 
 namespace tile_map
@@ -55,7 +57,12 @@ namespace tile_map
     TexturePtr texture;
 
     std::vector<tf::Vector3> points;
+    // Only kept up to date if the transform can't be applied by OpenGL
     std::vector<tf::Vector3> points_t;
+
+    // Textured triangles of the tile; built from points if the transform is
+    // applied by OpenGL and from points_t otherwise
+    mapviz::RenderBatchPtr batch;
   };
 
   class TileMapView
@@ -69,7 +76,11 @@ namespace tile_map
 
     void SetTileSource(const boost::shared_ptr<TileSource>& tile_source);
 
-    void SetTransform(const swri_transform_util::Transform& transform);
+    /**
+     * Sets the transform from WGS84 to the target frame.  Returns true if the
+     * transform changed.
+     */
+    bool SetTransform(const swri_transform_util::Transform& transform);
 
     void SetView(
       double latitude,
@@ -80,12 +91,34 @@ namespace tile_map
 
     void Draw();
 
+    /**
+     * Returns true if any of the tiles in the last drawn view were still
+     * being downloaded.
+     */
+    bool IsLoading() const { return loading_; }
+
+    /**
+     * Returns the memory used by the tile images, textures and vertices.
+     */
+    mapviz::MemoryStats MemoryUsage() const;
+
+    /**
+     * Fills in the subdivision and the WGS84 grid points of tile x, y at the
+     * given zoom level.
+     */
+    static void GenerateTileVertices(int32_t level, int64_t x, int64_t y, Tile& tile);
+
   private:
     void DrawTiles(std::vector<Tile> &tiles ,int priority);
 
+    void UpdateBatch(Tile& tile);
+
+    void ClearBatches();
+
     boost::shared_ptr<TileSource> tile_source_;
 
     swri_transform_util::Transform transform_;
+    mapviz::PointTransformer transformer_;
 
     int32_t level_;
 
@@ -97,12 +130,14 @@ namespace tile_map
     int32_t width_;
     int32_t height_;
 
+    bool loading_;
+
     std::vector<Tile> tiles_;
     std::vector<Tile> precache_;
 
     TextureCachePtr tile_cache_;
 
-    void ToLatLon(int32_t level, double x, double y, double& latitude, double& longitude);
+    static void ToLatLon(int32_t level, double x, double y, double& latitude, double& longitude);
 
     void InitializeTile(int32_t level, int64_t x, int64_t y, Tile& tile, int priority);
   };
@@ -0,0 +1,75 @@
+// *****************************************************************************
+//
+// Copyright (c) 2020, Southwest Research Institute® (SwRI®)
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Southwest Research Institute® (SwRI®) nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// *****************************************************************************
+
+
+// Measures how long it takes to generate the grid points of map tiles, which
+// TileMapView::InitializeTile() does for every visible and precached tile
+// each time the view moves to a new tile.
+//
+// Usage: tile_map_view_benchmark [--filter=...] [--json=...]
+
+#include <mapviz/benchmark.h>
+#include <tile_map/tile_map_view.h>
+
+// C++ standard libraries
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+  mapviz::BenchmarkRunner runner(argc, argv);
+
+  // Low zoom levels are subdivided more finely to follow the curvature of the
+  // projection; from level 4 on every tile is a single quad.
+  const int32_t levels[] = {0, 2, 4, 18};
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++)
+  {
+    const int32_t level = levels[i];
+    const int64_t origin = (static_cast<int64_t>(1) << level) / 2;
+    const int64_t grid = level < 2 ? 1 : 5;
+    const size_t num_tiles = grid * grid;
+
+    std::vector<tile_map::Tile> tiles(num_tiles);
+    runner.Run("TileMapView::GenerateTileVertices/level_" + std::to_string(level),
+               num_tiles, [&]()
+    {
+      for (int64_t row = 0; row < grid; row++)
+      {
+        for (int64_t col = 0; col < grid; col++)
+        {
+          tile_map::TileMapView::GenerateTileVertices(
+              level, origin + col, origin + row, tiles[row * grid + col]);
+        }
+      }
+      mapviz::DoNotOptimize(tiles[0].points[0]);
+    });
+  }
+
+  return runner.Finish();
+}
@@ -31,6 +31,8 @@
 
 #include <boost/make_shared.hpp>
 
+#include <mapviz/trace.h>
+
 #include <QtAlgorithms>
 #include <QByteArray>
 #include <QList>
@@ -55,7 +57,8 @@ namespace tile_map
     loading_(false),
     failures_(0),
     failed_(false),
-    priority_(priority)
+    priority_(priority),
+    memory_size_(0)
   {
   }
 
@@ -70,6 +73,7 @@ namespace tile_map
 
   void Image::ClearImage()
   {
+    memory_size_ = 0;
     image_.reset();
   }
 
@@ -189,6 +193,27 @@ namespace tile_map
     return image;
   }
 
+  size_t ImageCache::MemoryUsage()
+  {
+    QMutexLocker lock(&cache_mutex_);
+
+    size_t bytes = 0;
+    QList<size_t> keys = cache_.keys();
+    for (int i = 0; i < keys.size(); i++)
+    {
+      // object() doesn't update the freshness of the image like take() does.
+      // The images themselves aren't touched, since they may be loading on
+      // the cache thread.
+      ImagePtr* image = cache_.object(keys[i]);
+      if (image && *image)
+      {
+        bytes += (*image)->MemorySize();
+      }
+    }
+
+    return bytes;
+  }
+
   void ImageCache::ProcessRequest(QString uri)
   {
     QNetworkRequest request;
@@ -217,6 +242,7 @@ namespace tile_map
     {
       if (reply->error() == QNetworkReply::NoError)
       {
+        mapviz::TraceScope trace("image_cache", "Decode image");
         QByteArray data = reply->readAll();
         image->InitializeImage();
         if (!image->GetImage()->loadFromData(data))
@@ -224,6 +250,10 @@ namespace tile_map
           image->ClearImage();
           image->AddFailure();
         }
+        else
+        {
+          image->SetMemorySize(image->GetImage()->byteCount());
+        }
       }
       else
       {
@@ -297,6 +327,7 @@ namespace tile_map
           size_t hash = image_cache_->uri_to_hash_map_[uri];
           if (uri.startsWith(QString("file:///")))
           {
+            mapviz::TraceScope trace("image_cache", "Load image file");
             image->InitializeImage();
             QString filepath = uri.replace(QString("file:///"), QString("/"));
             if (!image->GetImage()->load(filepath))
@@ -304,6 +335,10 @@ namespace tile_map
               image->ClearImage();
               image->AddFailure();
             }
+            else
+            {
+              image->SetMemorySize(image->GetImage()->byteCount());
+            }
 
             image_cache_->unprocessed_.remove(hash);
             image_cache_->uri_to_hash_map_.remove(uri);
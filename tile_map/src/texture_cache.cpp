@@ -44,12 +44,25 @@
 
 #include <swri_math_util/math_util.h>
 
+#include <mapviz/trace.h>
+
 namespace tile_map
 {
-  Texture::Texture(int32_t texture_id, size_t hash) :
+  Texture::Texture(
+      int32_t texture_id,
+      size_t hash,
+      size_t memory_size,
+      const boost::shared_ptr<std::atomic<size_t> >& memory_usage) :
     id(texture_id),
-    url_hash(hash)
+    url_hash(hash),
+    memory_size(memory_size),
+    failed(false),
+    memory_usage_(memory_usage)
   {
+    if (memory_usage_)
+    {
+      *memory_usage_ += memory_size;
+    }
   }
 
   Texture::~Texture()
@@ -61,11 +74,17 @@ namespace tile_map
     GLuint ids[1];
     ids[0] = id;
     glDeleteTextures(1, &ids[0]);
+
+    if (memory_usage_)
+    {
+      *memory_usage_ -= memory_size;
+    }
   }
 
   TextureCache::TextureCache(ImageCachePtr image_cache, size_t size) :
     cache_(size),
-    image_cache_(image_cache)
+    image_cache_(image_cache),
+    memory_usage_(boost::make_shared<std::atomic<size_t> >(0))
   {
 
   }
@@ -96,6 +115,7 @@ namespace tile_map
           // All of the OpenGL calls need to occur on the main thread and so
           // can't be done in the background.  The QImage calls could
           // potentially be done in a background thread by the image cache.
+          mapviz::TraceScope trace("texture_cache", "Upload tile texture");
           QImage qimage = *image_ptr;
 
           GLuint ids[1];
@@ -114,13 +134,14 @@ namespace tile_map
             return texture;
           }
 
-          texture_ptr = new TexturePtr(boost::make_shared<Texture>(ids[0], url_hash));
-          texture = *texture_ptr;
-
           float max_dim = std::max(qimage.width(), qimage.height());
           int32_t dimension = swri_math_util::Round(
             std::pow(2, std::ceil(std::log(max_dim) / std::log(2.0f))));
 
+          texture_ptr = new TexturePtr(boost::make_shared<Texture>(
+              ids[0], url_hash, static_cast<size_t>(dimension) * dimension * 4, memory_usage_));
+          texture = *texture_ptr;
+
           if (qimage.width() != dimension || qimage.height() != dimension)
           {
             qimage = qimage.scaled(dimension, dimension, Qt::IgnoreAspectRatio, Qt::FastTransformation);
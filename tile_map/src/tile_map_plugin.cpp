@@ -51,6 +51,8 @@
 #include <swri_transform_util/frames.h>
 #include <swri_yaml_util/yaml_util.h>
 
+#include <mapviz/render_cache.h>
+
 // Declare plugin
 #include <pluginlib/class_list_macros.h>
 PLUGINLIB_EXPORT_CLASS(tile_map::TileMapPlugin, mapviz::MapvizPlugin)
@@ -303,7 +305,7 @@ namespace tile_map
     }
 
     swri_transform_util::Transform to_wgs84;
-    if (tf_manager_->GetTransform(source_frame_, target_frame_, to_wgs84))
+    if (LookupTransform(source_frame_, target_frame_, ros::Time(), to_wgs84))
     {
       tf::Vector3 center(x, y, 0);
       center = to_wgs84 * center;
@@ -321,19 +323,36 @@ namespace tile_map
         last_scale_ = scale;
         last_width_ = canvas_->width();
         last_height_ = canvas_->height();
-        tile_map_.SetView(center.y(), center.x(), scale, canvas_->width(), canvas_->height());
+        // Cover the margin that the canvas renders around the view when the
+        // map is cached.
+        tile_map_.SetView(center.y(), center.x(), scale,
+                          canvas_->width() + 2 * mapviz::RenderCache::MARGIN,
+                          canvas_->height() + 2 * mapviz::RenderCache::MARGIN);
         ROS_DEBUG("TileMapPlugin::Draw: Successfully set view");
       }
       tile_map_.Draw();
     }
   }
 
+  bool TileMapPlugin::NeedsRedraw()
+  {
+    // Keep drawing while the tile source is initializing or tiles are still
+    // being downloaded so that they show up as soon as they are available.
+    return mapviz::MapvizPlugin::NeedsRedraw() ||
+        !tile_map_.IsReady() ||
+        tile_map_.IsLoading();
+  }
+
   void TileMapPlugin::Transform()
   {
     swri_transform_util::Transform to_target;
-    if (tf_manager_->GetTransform(target_frame_, source_frame_, to_target))
+    if (LookupTransform(target_frame_, source_frame_, ros::Time(), to_target))
     {
-      tile_map_.SetTransform(to_target);
+      if (tile_map_.SetTransform(to_target))
+      {
+        // The map has moved, so the render cache is out of date.
+        RequestRedraw();
+      }
       PrintInfo("OK");
     }
     else
@@ -50,7 +50,8 @@ namespace tile_map
   TileMapView::TileMapView() :
     level_(-1),
     width_(100),
-    height_(100)
+    height_(100),
+    loading_(false)
   {
     ImageCachePtr image_cache = boost::make_shared<ImageCache>("/tmp/tile_map");
     tile_cache_ = boost::make_shared<TextureCache>(image_cache);
@@ -72,16 +73,30 @@ namespace tile_map
     level_ = -1;
   }
 
-  void TileMapView::SetTransform(const swri_transform_util::Transform& transform)
+  bool TileMapView::SetTransform(const swri_transform_util::Transform& transform)
   {
     if (transform.GetOrigin() == transform_.GetOrigin() &&
         transform.GetOrientation() == transform_.GetOrientation())
     {
-      return;
+      return false;
     }
 
     transform_ = transform;
 
+    // Rigid transforms are applied by OpenGL when the tiles are drawn, so the
+    // tile corners only have to be transformed here if the transform can't be
+    // represented as a matrix.
+    const bool was_rigid = transformer_.IsRigid();
+    transformer_ = mapviz::PointTransformer(transform_);
+    if (transformer_.IsRigid())
+    {
+      if (!was_rigid)
+      {
+        ClearBatches();
+      }
+      return true;
+    }
+
     for (size_t i = 0; i < tiles_.size(); i++)
     {
       for (size_t j = 0; j < tiles_[i].points_t.size(); j++)
@@ -97,6 +112,9 @@ namespace tile_map
         precache_[i].points_t[j] = transform_ * precache_[i].points[j];
       }
     }
+
+    ClearBatches();
+    return true;
   }
 
   void TileMapView::SetView(
@@ -208,6 +226,26 @@ namespace tile_map
     }
   }
 
+  mapviz::MemoryStats TileMapView::MemoryUsage() const
+  {
+    mapviz::MemoryStats usage = tile_cache_->MemoryUsage();
+    const std::vector<Tile>* lists[] = {&tiles_, &precache_};
+    for (size_t i = 0; i < 2; i++)
+    {
+      const std::vector<Tile>& tiles = *lists[i];
+      usage.cpu_bytes += mapviz::HeapBytes(tiles);
+      for (size_t j = 0; j < tiles.size(); j++)
+      {
+        usage.cpu_bytes += mapviz::HeapBytes(tiles[j].points) + mapviz::HeapBytes(tiles[j].points_t);
+        if (tiles[j].batch)
+        {
+          usage += tiles[j].batch->MemoryUsage();
+        }
+      }
+    }
+    return usage;
+  }
+
   void TileMapView::DrawTiles(std::vector<Tile>& tiles, int priority)
   {
     for (size_t i = 0; i < tiles.size(); i++)
@@ -218,45 +256,81 @@ namespace tile_map
       {
         bool failed;
         texture = tile_cache_->GetTexture(tiles[i].url_hash, tiles[i].url, failed, priority);
+        if (!texture && !failed)
+        {
+          loading_ = true;
+        }
       }
 
       if (texture)
       {
-        glBindTexture(GL_TEXTURE_2D, texture->id);
+        if (!tiles[i].batch || tiles[i].batch->Empty())
+        {
+          UpdateBatch(tiles[i]);
+        }
 
-        glBegin(GL_TRIANGLES);
+        tiles[i].batch->SetTexture(texture->id);
+        tiles[i].batch->Draw();
+      }
+    }
+  }
 
-        glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+  void TileMapView::UpdateBatch(Tile& tile)
+  {
+    if (!tile.batch)
+    {
+      tile.batch = boost::make_shared<mapviz::RenderBatch>(mapviz::RenderBatch::TRIANGLES);
+    }
+    tile.batch->Clear();
+    tile.batch->Reserve(tile.subdiv_count * tile.subdiv_count * 6);
 
-        for (int32_t row = 0; row < tiles[i].subdiv_count; row++)
-        {
-          for (int32_t col = 0; col < tiles[i].subdiv_count; col++)
-          {
-            double u_0 = col * tiles[i].subwidth;
-            double v_0 = 1.0 - row * tiles[i].subwidth;
-            double u_1 = (col + 1.0) * tiles[i].subwidth;
-            double v_1 = 1.0 - (row + 1.0) * tiles[i].subwidth;
-
-            const tf::Vector3& tl = tiles[i].points_t[row * (tiles[i].subdiv_count + 1) + col];
-            const tf::Vector3& tr = tiles[i].points_t[row * (tiles[i].subdiv_count + 1) + col + 1];
-            const tf::Vector3& br = tiles[i].points_t[(row + 1) * (tiles[i].subdiv_count + 1) + col + 1];
-            const tf::Vector3& bl = tiles[i].points_t[(row + 1) * (tiles[i].subdiv_count + 1) + col];
-
-            // Triangle 1
-            glTexCoord2f(u_0, v_0); glVertex2d(tl.x(), tl.y());
-            glTexCoord2f(u_1, v_0); glVertex2d(tr.x(), tr.y());
-            glTexCoord2f(u_1, v_1); glVertex2d(br.x(), br.y());
-
-            // Triangle 2
-            glTexCoord2f(u_0, v_0); glVertex2d(tl.x(), tl.y());
-            glTexCoord2f(u_1, v_1); glVertex2d(br.x(), br.y());
-            glTexCoord2f(u_0, v_1); glVertex2d(bl.x(), bl.y());
-          }
-        }
+    const std::vector<tf::Vector3>& points =
+      transformer_.IsRigid() ? tile.points : tile.points_t;
 
-        glEnd();
+    for (int32_t row = 0; row < tile.subdiv_count; row++)
+    {
+      for (int32_t col = 0; col < tile.subdiv_count; col++)
+      {
+        double u_0 = col * tile.subwidth;
+        double v_0 = 1.0 - row * tile.subwidth;
+        double u_1 = (col + 1.0) * tile.subwidth;
+        double v_1 = 1.0 - (row + 1.0) * tile.subwidth;
+
+        const tf::Vector3& tl = points[row * (tile.subdiv_count + 1) + col];
+        const tf::Vector3& tr = points[row * (tile.subdiv_count + 1) + col + 1];
+        const tf::Vector3& br = points[(row + 1) * (tile.subdiv_count + 1) + col + 1];
+        const tf::Vector3& bl = points[(row + 1) * (tile.subdiv_count + 1) + col];
+
+        // Triangle 1
+        tile.batch->SetTexCoord(u_0, v_0); tile.batch->AddVertex(tl.x(), tl.y());
+        tile.batch->SetTexCoord(u_1, v_0); tile.batch->AddVertex(tr.x(), tr.y());
+        tile.batch->SetTexCoord(u_1, v_1); tile.batch->AddVertex(br.x(), br.y());
+
+        // Triangle 2
+        tile.batch->SetTexCoord(u_0, v_0); tile.batch->AddVertex(tl.x(), tl.y());
+        tile.batch->SetTexCoord(u_1, v_1); tile.batch->AddVertex(br.x(), br.y());
+        tile.batch->SetTexCoord(u_0, v_1); tile.batch->AddVertex(bl.x(), bl.y());
+      }
+    }
+  }
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+  void TileMapView::ClearBatches()
+  {
+    // Only the vertex data is cleared here since this may be called off of
+    // the GUI thread; the batches are rebuilt the next time they are drawn.
+    for (size_t i = 0; i < tiles_.size(); i++)
+    {
+      if (tiles_[i].batch)
+      {
+        tiles_[i].batch->Clear();
+      }
+    }
+
+    for (size_t i = 0; i < precache_.size(); i++)
+    {
+      if (precache_[i].batch)
+      {
+        precache_[i].batch->Clear();
       }
     }
   }
@@ -268,12 +342,29 @@ namespace tile_map
       return;
     }
 
+    loading_ = false;
+
+    double matrix[16];
+    const bool gl_transform = transformer_.GetGLMatrix(matrix);
+    if (gl_transform)
+    {
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix();
+      glMultMatrixd(matrix);
+    }
+
     glEnable(GL_TEXTURE_2D);
 
     DrawTiles( precache_, 0 );
     DrawTiles( tiles_, 10000 );
 
     glDisable(GL_TEXTURE_2D);
+
+    if (gl_transform)
+    {
+      glMatrixMode(GL_MODELVIEW);
+      glPopMatrix();
+    }
   }
 
   void TileMapView::ToLatLon(int32_t level, double x, double y, double& latitude, double& longitude)
@@ -285,20 +376,13 @@ namespace tile_map
     latitude = swri_math_util::_rad_2_deg * std::atan(0.5 * (std::exp(r) - std::exp(-r)));
   }
 
-  void TileMapView::InitializeTile(int32_t level, int64_t x, int64_t y, Tile& tile, int priority)
+  void TileMapView::GenerateTileVertices(int32_t level, int64_t x, int64_t y, Tile& tile)
   {
-    tile.url = tile_source_->GenerateTileUrl(level, x, y);
-
-    tile.url_hash = tile_source_->GenerateTileHash(level, x, y);
-
-    tile.level = level;
-
-    bool failed;
-    tile.texture = tile_cache_->GetTexture(tile.url_hash, tile.url, failed, priority);
-
     int32_t subdivs = std::max(0, 4 - level);
     tile.subwidth = 1.0 / (subdivs + 1.0);
     tile.subdiv_count = std::pow(2, subdivs);
+    tile.points.clear();
+    tile.points.reserve((tile.subdiv_count + 1) * (tile.subdiv_count + 1));
     for (int32_t row = 0; row <= tile.subdiv_count; row++)
     {
       for (int32_t col = 0; col <= tile.subdiv_count; col++)
@@ -308,11 +392,28 @@ namespace tile_map
         tile.points.push_back(tf::Vector3(t_lon, t_lat, 0));
       }
     }
+  }
+
+  void TileMapView::InitializeTile(int32_t level, int64_t x, int64_t y, Tile& tile, int priority)
+  {
+    tile.url = tile_source_->GenerateTileUrl(level, x, y);
+
+    tile.url_hash = tile_source_->GenerateTileHash(level, x, y);
+
+    tile.level = level;
+
+    bool failed;
+    tile.texture = tile_cache_->GetTexture(tile.url_hash, tile.url, failed, priority);
+
+    GenerateTileVertices(level, x, y, tile);
 
     tile.points_t = tile.points;
-    for (size_t i = 0; i < tile.points_t.size(); i++)
+    if (!transformer_.IsRigid())
     {
-      tile.points_t[i] = transform_ * tile.points_t[i];
+      for (size_t i = 0; i < tile.points_t.size(); i++)
+      {
+        tile.points_t[i] = transform_ * tile.points_t[i];
+      }
     }
   }
 }